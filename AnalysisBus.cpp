@@ -0,0 +1,443 @@
+#include "AnalysisBus.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include "DspKernels.h"
+#include "FrameProfiler.h"
+#include "PcmCache.h"
+
+AnalysisBus::Subscription::Subscription(int feeds) : feeds(feeds) { }
+
+bool AnalysisBus::Subscription::update() {
+    return spectrum.update();
+}
+
+const AnalysisBus::SpectrumFrame& AnalysisBus::Subscription::getSpectrum() const {
+    return spectrum.readBuffer();
+}
+
+AnalysisBus::AnalysisBus(AudioHandler& handler) : audioHandler(handler), fftSize(FFT_SIZE), bars(BARS), overlap(DEFAULT_OVERLAP), scale(DEFAULT_SCALE),
+    scheduler(FFT_SIZE, DEFAULT_OVERLAP, DEFAULT_SAMPLE_RATE) { }
+
+AnalysisBus::~AnalysisBus() {
+    if (analysis.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(workerMutex);
+            analyzing = false;
+            workerQuit = true;
+        }
+        workerWake.notify_all();
+        analysis.join();
+    }
+    stopSpectrogramBuild();
+    stopPeakBuild();
+}
+
+AudioHandler& AnalysisBus::getAudioHandler() {
+    return audioHandler;
+}
+
+const PlaybackClock& AnalysisBus::getClock() const {
+    return audioHandler.getClock();
+}
+
+void AnalysisBus::updateClock() {
+    // Views drawn in the same frame share one query of the audio driver.
+    if (sinceClockUpdate.getElapsedTime().asMicroseconds() < CLOCK_REFRESH_MICROSECONDS) {
+        return;
+    }
+    sinceClockUpdate.restart();
+    audioHandler.updateClock();
+}
+
+void AnalysisBus::loadFile(const std::string& filename) {
+    if (filename != file) {
+        stopSpectrogramBuild();
+        stopPeakBuild();
+        peaks.reset();
+        spectrogramFile.clear();
+        file = filename;
+    }
+    audioHandler.loadFile(filename);
+    scheduler.setSampleRate(audioHandler.getSampleRate());
+}
+
+std::shared_ptr<const PeakPyramid> AnalysisBus::getPeaks() const {
+    return peaks;
+}
+
+void AnalysisBus::setAnalysisOverlap(float overlap) {
+    this->overlap = overlap;
+    scheduler.configure(fftSize, overlap);
+    spectrogramFile.clear();
+}
+
+void AnalysisBus::setAnalysisSize(int fftSize, int bars) {
+    if (!SpectrumAnalyzer::isValid(fftSize, bars) || bars > MAX_BARS) {
+        throw std::runtime_error("Unsupported FFT size or bar count!");
+    }
+    this->fftSize = fftSize;
+    this->bars = bars;
+    scheduler.configure(fftSize, overlap);
+    spectrogramFile.clear();
+}
+
+void AnalysisBus::setBarScale(BandMapping::Scale scale) {
+    this->scale = scale;
+    spectrogramFile.clear();
+}
+
+int AnalysisBus::getBarCount() const {
+    return bars;
+}
+
+void AnalysisBus::warmUp() {
+    if (!analysis.joinable()) {
+        analysis = std::thread(AnalysisBus::analysisThread, std::ref(*this));
+    }
+}
+
+AnalysisBus::Subscription* AnalysisBus::subscribe(int feeds) {
+    warmUp();
+    if (feeds & Pitch) {
+        feeds |= Spectrum;
+        pitchSubscribers++;
+    }
+    if ((feeds & Spectrum) && spectrogramFile != file) {
+        startSpectrogramBuild();
+    }
+    if ((feeds & Peaks) && !peaks) {
+        startPeakBuild();
+    }
+
+    Subscription* subscription = new Subscription(feeds);
+    bool first;
+    {
+        std::lock_guard<std::mutex> lock(subscriberMutex);
+        first = subscribers.empty();
+        subscribers.emplace_back(subscription);
+    }
+    if ((feeds & Spectrum) && spectrumSubscribers++ == 0) {
+        {
+            std::lock_guard<std::mutex> lock(workerMutex);
+            analyzing = true;
+        }
+        workerWake.notify_all();
+    }
+    if (first) {
+        audioHandler.play();
+    }
+    return subscription;
+}
+
+void AnalysisBus::unsubscribe(Subscription* subscription) {
+    if (subscription->feeds & Pitch) {
+        pitchSubscribers--;
+    }
+    if ((subscription->feeds & Spectrum) && --spectrumSubscribers == 0) {
+        // The FFT thread finishes its hop and parks; the next loadFile() may then replace the samples.
+        std::unique_lock<std::mutex> lock(workerMutex);
+        analyzing = false;
+        workerWake.wait(lock, [this] { return !workerBusy; });
+    }
+
+    bool last;
+    {
+        std::lock_guard<std::mutex> lock(subscriberMutex);
+        subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [subscription](const std::unique_ptr<Subscription>& s) {
+            return s.get() == subscription;
+        }), subscribers.end());
+        last = subscribers.empty();
+    }
+    if (last) {
+        audioHandler.pause();
+    }
+}
+
+std::size_t AnalysisBus::getSubscriberCount() const {
+    std::lock_guard<std::mutex> lock(subscriberMutex);
+    return subscribers.size();
+}
+
+/**
+ * @brief The FFT thread: parked while no view wants spectra, analysing otherwise, until the bus is destroyed.
+ * The analyzer and the sample buffers are kept across runs and rebuilt only when the configuration changes.
+ * @param bus Reference to the AnalysisBus instance.
+ */
+void AnalysisBus::analysisThread(AnalysisBus& bus) {
+    FrameProfiler::setThreadName("fft");
+    // Warm the FFT plan and band weights for the current configuration before the first run.
+    Worker worker;
+    worker.analyzer = SpectrumAnalyzer::create(bus.fftSize, bus.bars, bus.scale, DEFAULT_SAMPLE_RATE);
+    worker.scale = bus.scale;
+    worker.sampleRate = DEFAULT_SAMPLE_RATE;
+
+    std::unique_lock<std::mutex> lock(bus.workerMutex);
+    while (true) {
+        bus.workerWake.wait(lock, [&bus] { return bus.workerQuit || bus.analyzing; });
+        if (bus.workerQuit) {
+            return;
+        }
+        bus.workerBusy = true;
+        lock.unlock();
+
+        analyzeRun(bus, worker);
+
+        lock.lock();
+        bus.workerBusy = false;
+        bus.workerWake.notify_all();
+    }
+}
+
+/**
+ * @brief Analyses the hops due by the playback clock and publishes them until no view wants spectra.
+ * @param bus Reference to the AnalysisBus instance.
+ * @param worker State of the previous run; the analyzer is rebuilt only if the configuration or rate changed.
+ */
+void AnalysisBus::analyzeRun(AnalysisBus& bus, Worker& worker) {
+    const PlaybackClock& clock = bus.audioHandler.getClock();
+    const unsigned int channels = clock.getChannelCount();
+    if (worker.analyzer->getFftSize() != bus.fftSize || worker.analyzer->getBarCount() != bus.bars
+        || worker.scale != bus.scale || worker.sampleRate != clock.getSampleRate()) {
+        worker.analyzer = SpectrumAnalyzer::create(bus.fftSize, bus.bars, bus.scale, clock.getSampleRate());
+        worker.scale = bus.scale;
+        worker.sampleRate = clock.getSampleRate();
+    }
+    SpectrumAnalyzer& analyzer = *worker.analyzer;
+    worker.interleaved.resize(static_cast<std::size_t>(bus.fftSize) * channels);
+    worker.samples.resize(bus.fftSize);
+    std::shared_ptr<const DecodedAudio> decoded = bus.audioHandler.getDecoded();
+    DownmixView mix = decoded ? decoded->getMix() : DownmixView();
+    sf::Uint64 sequence = 0;
+
+    bus.scheduler.reset();
+    // Reuses the buffers of the previous run when the configuration is unchanged.
+    worker.beats.configure(bus.bars, bus.scheduler.getHopSize(), clock.getSampleRate());
+    if (worker.pitch.getSampleRate() != clock.getSampleRate()) {
+        worker.pitch.configure(PitchAnalyzer::WINDOW_SIZE, clock.getSampleRate(), PITCH_HOP_FRAMES);
+    }
+    else {
+        worker.pitch.reset();
+    }
+    worker.pitchInterleaved.resize(static_cast<std::size_t>(PitchAnalyzer::WINDOW_SIZE) * channels);
+    worker.pitchSamples.resize(PitchAnalyzer::WINDOW_SIZE);
+    worker.havePitch = false;
+
+    while (bus.analyzing) {
+        // The clock is fed by the render loops; reading it never touches the audio driver.
+        if (!clock.isPlaying()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        sf::Uint64 playhead = clock.getFrame();
+        sf::Uint64 frameCount = clock.snapshot().frameCount;
+        sf::Uint64 hopFrame;
+
+        while (bus.scheduler.nextHop(playhead, hopFrame)) {
+            if (hopFrame + bus.fftSize > frameCount) {
+                continue;
+            }
+
+            // Precomputed column if the whole-file pass is done, live FFT otherwise.
+            const float* column = bus.spectrogram.isReady() ? bus.spectrogram.getColumn(hopFrame) : nullptr;
+            if (column) {
+                std::copy(column, column + bus.bars, worker.magnitudes.begin());
+            }
+            else {
+                {
+                    ScopedTimer timer(FrameProfiler::Decode);
+                    if (decoded) {
+                        // Mixed straight out of the shared samples.
+                        mix.read(hopFrame, bus.fftSize, worker.samples.data());
+                    }
+                    else {
+                        bus.audioHandler.readSamples(hopFrame * channels, worker.interleaved.data(), worker.interleaved.size());
+                        dsp::downmix(worker.interleaved.data(), worker.samples.data(), bus.fftSize, channels);
+                    }
+                }
+                ScopedTimer timer(FrameProfiler::Analysis);
+                analyzer.analyze(worker.samples.data(), worker.magnitudes.data());
+            }
+
+            // Beats are stamped at the centre of the window they were heard in.
+            worker.beats.process(worker.magnitudes.data(), hopFrame + bus.fftSize / 2);
+            sf::Uint64 windowEnd = hopFrame + bus.fftSize;
+            // A window behind the last one means the playhead was moved back.
+            if (bus.pitchSubscribers > 0 && windowEnd >= PitchAnalyzer::WINDOW_SIZE
+                && (!worker.havePitch || windowEnd >= worker.pitchFrame + PITCH_HOP_FRAMES || windowEnd < worker.pitchFrame)) {
+                analyzePitch(bus, worker, decoded ? &mix : nullptr, windowEnd);
+            }
+            bus.publish(worker, sequence++);
+        }
+
+        // Stay idle until the next hop; wake up at least every 10 ms to notice pause or the end of the run.
+        sf::Time idle = std::min(bus.scheduler.timeUntilNextHop(playhead), sf::milliseconds(10));
+        std::this_thread::sleep_for(std::chrono::microseconds(idle.asMicroseconds()));
+    }
+}
+
+/**
+ * @brief Reads the pitch window that ends at a frame and analyses it; runs on the FFT thread.
+ * @param bus Reference to the AnalysisBus instance.
+ * @param worker State of the run; its pitch analyzer is configured for the clock's rate.
+ * @param mix Mono mix of the decoded file, or nullptr if it is streamed.
+ * @param end Frame after the last sample of the window, at least the window size.
+ */
+void AnalysisBus::analyzePitch(AnalysisBus& bus, Worker& worker, const DownmixView* mix, sf::Uint64 end) {
+    const std::size_t windowSize = PitchAnalyzer::WINDOW_SIZE;
+    sf::Uint64 first = end - windowSize;
+    {
+        ScopedTimer timer(FrameProfiler::Decode);
+        if (mix) {
+            mix->read(first, windowSize, worker.pitchSamples.data());
+        }
+        else {
+            unsigned int channels = bus.audioHandler.getClock().getChannelCount();
+            bus.audioHandler.readSamples(first * channels, worker.pitchInterleaved.data(), worker.pitchInterleaved.size());
+            dsp::downmix(worker.pitchInterleaved.data(), worker.pitchSamples.data(), windowSize, channels);
+        }
+    }
+    ScopedTimer timer(FrameProfiler::Analysis);
+    worker.pitch.analyze(worker.pitchSamples.data());
+    worker.pitchFrame = end;
+    worker.havePitch = true;
+}
+
+/**
+ * @brief Copies the spectrum of one hop to every Spectrum subscriber; runs on the FFT thread.
+ */
+void AnalysisBus::publish(const Worker& worker, sf::Uint64 sequence) {
+    std::lock_guard<std::mutex> lock(subscriberMutex);
+    for (const std::unique_ptr<Subscription>& subscription : subscribers) {
+        if (subscription->feeds & Spectrum) {
+            SpectrumFrame& frame = subscription->spectrum.writeBuffer();
+            std::copy(worker.magnitudes.begin(), worker.magnitudes.begin() + bars, frame.magnitudes.begin());
+            frame.sequence = sequence;
+            frame.beats = worker.beats.getState();
+            if (subscription->feeds & Pitch) {
+                frame.pitch = worker.pitch.getFeatures();
+            }
+            subscription->spectrum.publish();
+        }
+    }
+}
+
+/**
+ * @brief Starts the whole-file spectrogram pass for the loaded file and the current configuration.
+ */
+void AnalysisBus::startSpectrogramBuild() {
+    stopSpectrogramBuild();
+    // The matrix of the previous file or configuration is unmapped here, with the FFT thread
+    // parked, before anything can wake it; until the new load() completes and marks the
+    // cache ready, it analyses live.
+    {
+        std::unique_lock<std::mutex> lock(workerMutex);
+        bool wasAnalyzing = analyzing;
+        analyzing = false;
+        workerWake.wait(lock, [this] { return !workerBusy; });
+        spectrogram.close();
+        analyzing = wasAnalyzing;
+    }
+    workerWake.notify_all();
+
+    spectrogramFile = file;
+    if (file.empty()) {
+        return;
+    }
+
+    std::string filename = file;
+    std::size_t hopSize = scheduler.getHopSize();
+    int fftSize = this->fftSize;
+    int bars = this->bars;
+    BandMapping::Scale scale = this->scale;
+    spectrogramBuild = std::async(std::launch::async, [this, filename, fftSize, hopSize, bars, scale]() {
+        return spectrogram.load(filename, fftSize, hopSize, bars, scale);
+    });
+}
+
+/**
+ * @brief Cancels a running whole-file spectrogram pass and waits for it to finish.
+ */
+void AnalysisBus::stopSpectrogramBuild() {
+    spectrogram.cancel();
+    if (spectrogramBuild.valid()) {
+        spectrogramBuild.wait();
+    }
+}
+
+/**
+ * @brief Takes the peak pyramid of the loaded file from the PcmCache, or builds and caches it
+ * in the background, so subscribe() never scans the file on the render thread.
+ */
+void AnalysisBus::startPeakBuild() {
+    stopPeakBuild();
+    if (file.empty()) {
+        return;
+    }
+    peaks = PcmCache::findPeaks(file);
+    if (peaks) {
+        return;
+    }
+
+    unsigned int channels = audioHandler.getChannelCount();
+    sf::Uint64 frames = audioHandler.getSampleCount() / channels;
+    std::shared_ptr<PeakPyramid> building = std::make_shared<PeakPyramid>();
+    building->reset(channels, frames);
+    peaks = building;
+
+    // Decoded and mapped files are summarized straight from the shared samples, streamed
+    // files by a separate decoder; either way the waveform fills in as the pass moves
+    // ahead of the playhead.
+    cancelPeakBuild = false;
+    std::string filename = file;
+    std::shared_ptr<const DecodedAudio> decoded = audioHandler.getDecoded();
+    peakBuild = std::async(std::launch::async, [this, filename, decoded, building, channels, frames]() {
+        FrameProfiler::setThreadName("peaks");
+        if (decoded) {
+            const sf::Int16* samples = decoded->getSamples();
+            for (sf::Uint64 frame = 0; frame < frames && !cancelPeakBuild; frame += PEAK_CHUNK_FRAMES) {
+                ScopedTimer timer(FrameProfiler::Analysis);
+                // Nothing is copied; the shared pointer keeps the samples alive.
+                std::size_t count = static_cast<std::size_t>(std::min<sf::Uint64>(PEAK_CHUNK_FRAMES, frames - frame));
+                building->append(samples + frame * channels, count);
+            }
+        }
+        else {
+            sf::InputSoundFile input;
+            if (!input.openFromFile(filename)) {
+                return;
+            }
+            std::vector<sf::Int16> chunk(PEAK_CHUNK_FRAMES * channels);
+            while (!cancelPeakBuild) {
+                std::size_t read;
+                {
+                    ScopedTimer timer(FrameProfiler::Decode);
+                    read = static_cast<std::size_t>(input.read(chunk.data(), chunk.size()));
+                }
+                {
+                    ScopedTimer timer(FrameProfiler::Analysis);
+                    building->append(chunk.data(), read / channels);
+                }
+                if (read < chunk.size()) {
+                    break;
+                }
+            }
+        }
+        building->finish();
+        if (!cancelPeakBuild) {
+            PcmCache::storePeaks(filename, building);
+        }
+    });
+}
+
+/**
+ * @brief Cancels a running background peak pass and waits for it to finish.
+ */
+void AnalysisBus::stopPeakBuild() {
+    cancelPeakBuild = true;
+    if (peakBuild.valid()) {
+        peakBuild.wait();
+    }
+}
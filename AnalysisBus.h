@@ -0,0 +1,255 @@
+#pragma once
+#include <SFML/System.hpp>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AnalysisScheduler.h"
+#include "AudioHandler.h"
+#include "BandMapping.h"
+#include "BeatTracker.h"
+#include "PeakPyramid.h"
+#include "PitchAnalyzer.h"
+#include "SpectrogramCache.h"
+#include "SpectrumAnalyzer.h"
+#include "TripleBuffer.h"
+
+/**
+ * @class AnalysisBus
+ * @brief Playback and analysis shared by any number of visualizers.
+ *
+ * The bus loads a file once, refreshes the playback clock once per frame however many
+ * views ask, and runs a single FFT thread whose spectra are published to every subscriber.
+ * It also owns the peak pyramid of the file, which waveform views query directly.
+ *
+ * Views subscribe in begin() and unsubscribe in end(). Playback starts with the first
+ * subscriber and pauses with the last, and the FFT thread only runs while someone wants
+ * spectra, so Bars and Wave side by side cost one decode and one FFT per hop.
+ *
+ * Every spectrum also goes through a BeatTracker, so subscribers can follow onsets and
+ * beats, e.g. to drive lighting, by comparing the beat frames with the playback clock.
+ * While a Pitch subscriber is present, a PitchAnalyzer also runs on a longer window
+ * ending with the current hop, every PITCH_HOP_FRAMES, and adds pitch, chroma, chord and
+ * key to the spectra.
+ *
+ * All member functions are called from the render thread; the FFT thread is internal.
+ */
+class AnalysisBus {
+public:
+    static constexpr int FFT_SIZE = 512;       ///< Default size for FFT calculations.
+    static constexpr int BARS = 128;           ///< Default number of bars.
+    static constexpr int MAX_BARS = SpectrumAnalyzer::MAX_FFT_SIZE / 2 + 1; ///< Most bars a SpectrumFrame can hold: one per bin of the largest FFT.
+    static constexpr BandMapping::Scale DEFAULT_SCALE = BandMapping::Log; ///< Default spacing of the bars.
+
+    /**
+     * @brief What a subscriber receives; combine with |.
+     */
+    enum Feed {
+        Spectrum = 1,   ///< A SpectrumFrame per FFT hop.
+        Peaks = 2,      ///< The peak pyramid of the file, from getPeaks().
+        Pitch = 4       ///< Pitch features in each SpectrumFrame; implies Spectrum.
+    };
+
+    /**
+     * @brief One analysed spectrum, as published to every subscriber.
+     */
+    struct SpectrumFrame {
+        std::array<float, MAX_BARS> magnitudes; ///< Magnitudes for each bar; the first getBarCount() are used.
+        sf::Uint64 sequence;                    ///< Number of the frame, counted from the start of the run.
+        BeatTracker::State beats;               ///< Onsets and beats up to this hop, as playback clock frames.
+        PitchAnalyzer::Features pitch;          ///< Features of the newest pitch window; only filled for Pitch subscribers.
+    };
+
+    /**
+     * @class Subscription
+     * @brief A view's end of the bus, returned by subscribe() and valid until unsubscribe().
+     */
+    class Subscription {
+    public:
+        /**
+         * @brief Takes the newest spectrum, if any. Only call from the subscriber's render thread.
+         * @return True if getSpectrum() now refers to a spectrum that was not seen before.
+         */
+        bool update();
+
+        /**
+         * @brief Retrieves the spectrum taken by the last update().
+         * @return Newest spectrum.
+         */
+        const SpectrumFrame& getSpectrum() const;
+
+    private:
+        friend class AnalysisBus;
+        explicit Subscription(int feeds);
+
+        int feeds;                              ///< Combination of Feed values.
+        TripleBuffer<SpectrumFrame> spectrum;   ///< Lock-free hand-off from the FFT thread.
+    };
+
+    /**
+     * @brief Constructs a bus that plays through the given handler. The FFT thread starts in warmUp().
+     * @param handler Audio handler shared by all views.
+     */
+    AnalysisBus(AudioHandler& handler);
+
+    /**
+     * @brief Stops the FFT thread and the background passes.
+     */
+    ~AnalysisBus();
+
+    AnalysisBus(const AnalysisBus&) = delete;
+    AnalysisBus& operator=(const AnalysisBus&) = delete;
+
+    /**
+     * @brief Retrieves the audio handler the bus plays through.
+     * @return Shared audio handler.
+     */
+    AudioHandler& getAudioHandler();
+
+    /**
+     * @brief Retrieves the playback clock.
+     * @return Clock of the audio handler.
+     */
+    const PlaybackClock& getClock() const;
+
+    /**
+     * @brief Refreshes the playback clock from the audio driver. Views call it every frame;
+     * calls within CLOCK_REFRESH_MICROSECONDS of the last one share its reading.
+     */
+    void updateClock();
+
+    /**
+     * @brief Loads a file into the audio handler. Call while no view is subscribed.
+     * Peaks and the spectrogram are kept if the file is the one loaded already.
+     * @param filename Path to the audio file.
+     */
+    void loadFile(const std::string& filename);
+
+    /**
+     * @brief Retrieves the peak pyramid of the loaded file.
+     * @return Peaks, possibly still filling in unless they were cached; nullptr until a Peaks subscriber asked for them.
+     */
+    std::shared_ptr<const PeakPyramid> getPeaks() const;
+
+    /**
+     * @brief Sets how much consecutive FFT windows overlap. Call while no view is subscribed.
+     * @param overlap Fraction of each window shared with the next one, in [0, 1).
+     */
+    void setAnalysisOverlap(float overlap);
+
+    /**
+     * @brief Sets the FFT size and the number of bars. Call while no view is subscribed.
+     * @param fftSize Samples per FFT window; a power of two supported by SpectrumAnalyzer.
+     * @param bars Number of bars, at most fftSize / 2 + 1.
+     * @throws std::runtime_error If the configuration is not supported.
+     */
+    void setAnalysisSize(int fftSize, int bars);
+
+    /**
+     * @brief Sets how the bars are spaced along the frequency axis. Call while no view is subscribed.
+     * @param scale Linear, log, mel or constant-Q spacing.
+     */
+    void setBarScale(BandMapping::Scale scale);
+
+    /**
+     * @brief Retrieves the number of bars in each published spectrum.
+     * @return Number of bars.
+     */
+    int getBarCount() const;
+
+    /**
+     * @brief Starts the FFT thread, which builds the analyzer for the current configuration right away.
+     * Later calls do nothing.
+     */
+    void warmUp();
+
+    /**
+     * @brief Adds a view. The first subscriber starts playback; the first Spectrum subscriber wakes the FFT thread.
+     * Starts the spectrogram or peak pass of the loaded file if this is the first view that needs it.
+     * @param feeds Combination of Feed values.
+     * @return Subscription owned by the bus, valid until unsubscribe().
+     */
+    Subscription* subscribe(int feeds);
+
+    /**
+     * @brief Removes a view. The last subscriber pauses playback; the last Spectrum subscriber parks the FFT thread.
+     * @param subscription Subscription returned by subscribe().
+     */
+    void unsubscribe(Subscription* subscription);
+
+    /**
+     * @brief Retrieves the number of subscribed views.
+     * @return Number of subscriptions.
+     */
+    std::size_t getSubscriberCount() const;
+
+private:
+    /**
+     * @brief State the FFT thread keeps across runs.
+     */
+    struct Worker {
+        std::unique_ptr<SpectrumAnalyzer> analyzer; ///< Analyzer of the last run.
+        BandMapping::Scale scale;                  ///< Scale analyzer was built for.
+        unsigned int sampleRate;                   ///< Sample rate analyzer was built for.
+        std::vector<sf::Int16> interleaved;        ///< Scratch window of streamed samples.
+        std::vector<sf::Int16> samples;            ///< Scratch mono window.
+        std::array<float, MAX_BARS> magnitudes;    ///< Spectrum of the current hop, before it is published.
+        BeatTracker beats;                         ///< Onsets and beats of the current run.
+        PitchAnalyzer pitch;                       ///< Pitch features, analysed while someone wants them.
+        std::vector<sf::Int16> pitchInterleaved;   ///< Scratch pitch window of streamed samples.
+        std::vector<sf::Int16> pitchSamples;       ///< Scratch mono pitch window.
+        sf::Uint64 pitchFrame = 0;                 ///< End of the last pitch window.
+        bool havePitch = false;                    ///< False until the first pitch window of the run.
+    };
+
+    static void analysisThread(AnalysisBus& bus);
+    static void analyzeRun(AnalysisBus& bus, Worker& worker);
+    static void analyzePitch(AnalysisBus& bus, Worker& worker, const DownmixView* mix, sf::Uint64 end);
+    void publish(const Worker& worker, sf::Uint64 sequence);
+    void startSpectrogramBuild();
+    void stopSpectrogramBuild();
+    void startPeakBuild();
+    void stopPeakBuild();
+
+    static constexpr int DEFAULT_SAMPLE_RATE = 44100;          ///< Rate assumed until a file is loaded.
+    static constexpr float DEFAULT_OVERLAP = 0.5f;             ///< Default overlap between consecutive FFT windows.
+    static constexpr std::size_t PEAK_CHUNK_FRAMES = 65536;    ///< Frames summarized per step of the background peak pass.
+    static constexpr sf::Int64 CLOCK_REFRESH_MICROSECONDS = 2000; ///< Clock readings younger than this are shared.
+    static constexpr std::size_t PITCH_HOP_FRAMES = 1024;      ///< Frames between pitch windows, about one display frame.
+
+    AudioHandler& audioHandler;                ///< Plays the loaded file and feeds the clock.
+    std::string file;                          ///< File loaded by the last loadFile().
+    sf::Clock sinceClockUpdate;                ///< Time since the clock was last refreshed.
+
+    int fftSize;                               ///< Samples per FFT window.
+    int bars;                                  ///< Number of bars per spectrum.
+    float overlap;                             ///< Fraction shared by consecutive FFT windows.
+    BandMapping::Scale scale;                  ///< Spacing of the bars.
+    AnalysisScheduler scheduler;               ///< Paces the FFT thread by the playback clock, in frames.
+
+    SpectrogramCache spectrogram;              ///< Precomputed magnitudes of the whole file.
+    std::future<bool> spectrogramBuild;        ///< Background pass that fills spectrogram.
+    std::string spectrogramFile;               ///< File spectrogram was started for; cleared when the configuration changes.
+
+    std::shared_ptr<const PeakPyramid> peaks;  ///< Min/max/RMS summary of the loaded file.
+    std::future<void> peakBuild;               ///< Background pass that fills peaks when they are not cached.
+    std::atomic<bool> cancelPeakBuild{ false }; ///< Asks peakBuild to stop early.
+
+    mutable std::mutex subscriberMutex;        ///< Guards subscribers against the FFT thread.
+    std::vector<std::unique_ptr<Subscription>> subscribers; ///< Subscribed views.
+    std::size_t spectrumSubscribers = 0;       ///< Subscribers that receive spectra.
+    std::atomic<std::size_t> pitchSubscribers{ 0 }; ///< Subscribers that receive pitch features; read by the FFT thread.
+
+    std::thread analysis;                      ///< FFT thread, parked while no view wants spectra.
+    std::mutex workerMutex;                    ///< Guards workerBusy and workerQuit.
+    std::condition_variable workerWake;        ///< Signalled when a run starts or ends, and on shutdown.
+    std::atomic<bool> analyzing{ false };      ///< True while some view wants spectra.
+    bool workerBusy = false;                   ///< True while the FFT thread is inside a run.
+    bool workerQuit = false;                   ///< Stops the FFT thread.
+};
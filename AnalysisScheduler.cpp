@@ -0,0 +1,69 @@
+#include "AnalysisScheduler.h"
+#include <algorithm>
+
+AnalysisScheduler::AnalysisScheduler(std::size_t windowSize, float overlap, unsigned int sampleRate, std::size_t maxCatchUp)
+    : windowSize(windowSize), hopSize(windowSize), maxCatchUp(std::max<std::size_t>(maxCatchUp, 1)), sampleRate(sampleRate), nextIndex(0), started(false) {
+    configure(windowSize, overlap);
+}
+
+void AnalysisScheduler::configure(std::size_t size, float overlap) {
+    overlap = std::min(std::max(overlap, 0.0f), 0.95f);
+    windowSize = size;
+    hopSize = std::max<std::size_t>(1, static_cast<std::size_t>(size * (1.0f - overlap)));
+    reset();
+}
+
+void AnalysisScheduler::setSampleRate(unsigned int rate) {
+    sampleRate = rate;
+}
+
+std::size_t AnalysisScheduler::getHopSize() const {
+    return hopSize;
+}
+
+void AnalysisScheduler::reset() {
+    nextIndex = 0;
+    started = false;
+}
+
+/**
+ * @brief Returns the next hop that is due at the given playhead.
+ * @param playhead Current position of the audio clock.
+ * @param hopStart Receives the position of the first sample of the hop.
+ * @return True if a hop is due; call again until it returns false.
+ */
+bool AnalysisScheduler::nextHop(sf::Uint64 playhead, sf::Uint64& hopStart) {
+    sf::Uint64 due = playhead / hopSize;
+
+    // First hop, or the playhead jumped backwards (seek/rewind): restart at the playhead.
+    if (!started || due + 1 < nextIndex) {
+        nextIndex = due;
+        started = true;
+    }
+
+    // After a stall only the most recent hops are replayed.
+    if (due >= nextIndex + maxCatchUp) {
+        nextIndex = due + 1 - maxCatchUp;
+    }
+
+    if (nextIndex > due) {
+        return false;
+    }
+
+    hopStart = nextIndex * hopSize;
+    nextIndex++;
+    return true;
+}
+
+/**
+ * @brief Computes how long the analysis thread may stay idle.
+ * @param playhead Current position of the audio clock.
+ * @return Time until the next hop is due, or zero if one is due already.
+ */
+sf::Time AnalysisScheduler::timeUntilNextHop(sf::Uint64 playhead) const {
+    sf::Uint64 next = nextIndex * hopSize;
+    if (!started || next <= playhead || sampleRate == 0) {
+        return sf::Time::Zero;
+    }
+    return sf::microseconds(static_cast<sf::Int64>((next - playhead) * 1000000 / sampleRate));
+}
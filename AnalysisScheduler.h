@@ -0,0 +1,72 @@
+#pragma once
+#include <SFML/System.hpp>
+#include <cstddef>
+
+/**
+ * @class AnalysisScheduler
+ * @brief Decides when the next FFT hop is due, based on the audio clock.
+ *
+ * Hops start at multiples of the hop size, which follows from the window size and
+ * the overlap between consecutive windows. The analysis thread asks for every hop
+ * that the playhead has passed, then sleeps until the next one is due. After a stall
+ * at most maxCatchUp hops are replayed, always the most recent ones, so the result
+ * does not depend on how long the stall lasted.
+ */
+class AnalysisScheduler {
+public:
+    /**
+     * @brief Constructs a scheduler.
+     * @param windowSize Number of samples analysed per hop.
+     * @param overlap Fraction of each window shared with the next one, in [0, 1).
+     * @param sampleRate Rate of the clock positions passed to the scheduler.
+     * @param maxCatchUp Most hops replayed after a stall.
+     */
+    AnalysisScheduler(std::size_t windowSize, float overlap, unsigned int sampleRate, std::size_t maxCatchUp = 4);
+
+    /**
+     * @brief Changes the window size and overlap; the next hop restarts at the playhead.
+     * @param windowSize Number of samples analysed per hop.
+     * @param overlap Fraction of each window shared with the next one, in [0, 1).
+     */
+    void configure(std::size_t windowSize, float overlap);
+
+    /**
+     * @brief Changes the rate of the clock positions passed to the scheduler.
+     * @param rate Positions per second.
+     */
+    void setSampleRate(unsigned int rate);
+
+    /**
+     * @brief Retrieves the distance between the starts of consecutive windows.
+     * @return The hop size in samples.
+     */
+    std::size_t getHopSize() const;
+
+    /**
+     * @brief Forgets the last processed hop, e.g. after loading a new file.
+     */
+    void reset();
+
+    /**
+     * @brief Returns the next hop that is due at the given playhead.
+     * @param playhead Current position of the audio clock.
+     * @param hopStart Receives the position of the first sample of the hop.
+     * @return True if a hop is due; call again until it returns false.
+     */
+    bool nextHop(sf::Uint64 playhead, sf::Uint64& hopStart);
+
+    /**
+     * @brief Computes how long the analysis thread may stay idle.
+     * @param playhead Current position of the audio clock.
+     * @return Time until the next hop is due, or zero if one is due already.
+     */
+    sf::Time timeUntilNextHop(sf::Uint64 playhead) const;
+
+private:
+    std::size_t windowSize;     ///< Number of samples analysed per hop.
+    std::size_t hopSize;        ///< Distance between the starts of consecutive windows.
+    std::size_t maxCatchUp;     ///< Most hops replayed after a stall.
+    unsigned int sampleRate;    ///< Rate of the clock positions.
+    sf::Uint64 nextIndex;       ///< Index of the next hop to process.
+    bool started;               ///< False until the first hop has been scheduled.
+};
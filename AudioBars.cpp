@@ -1,127 +1,223 @@
 #include "AudioBars.h"
+#include <cmath>
+#include <cstdio>
 
-/**
- * @brief Constructs the AudioBars visualizer with an audio handler.
- * @param handler Reference to the audio handler.
- */
-AudioBars:: AudioBars(AudioHandler& handler) : AudioVisualizer(handler) { }
+#include "DspKernels.h"
 
-/**
- * @brief Scales a value logarithmically.
- * @param value The value to be scaled.
- * @param maxVal Maximum value used for normalization.
- * @return The logarithmically scaled value.
- */
-float AudioBars::logScale(float value, float maxVal) {
-    if (value == 0) return 0;
-    float logMax = std::log(maxVal + 1);
-    return std::log(value + 1) / logMax;
+namespace {
+    const float CHROMA_CELL = 24.0f;    ///< Width and height of a pitch class cell in pixels.
+    const float CHROMA_MARGIN = 12.0f;  ///< Distance of the chroma strip from the window corner.
 }
 
 /**
- * @brief The main thread function for visualizing audio with FFT.
- * @param vis Reference to the AudioBars instance.
+ * @brief Constructs the AudioBars visualizer on an analysis bus.
+ * @param bus Bus that supplies the spectra.
  */
-void AudioBars::visualizationThread(AudioBars& vis) {
-    fftw_complex out[vis.FFT_SIZE / 2 + 1];
-    double in[vis.FFT_SIZE];
-    fftw_plan p = fftw_plan_dft_r2c_1d(vis.FFT_SIZE, in, out, FFTW_MEASURE);
-
-    while (vis.barsWindow.isOpen()) { 
-        if (vis.audioHandler.getStatus() != sf::Sound::Playing) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            continue;
-        }
+AudioBars::AudioBars(AnalysisBus& bus) : AudioVisualizer(bus), barGeometry(sf::Quads, sf::VertexBuffer::Stream), useVertexBuffer(false) { }
 
-        sf::Time currentOffset = vis.audioHandler.getPlayingOffset();
-        std::size_t sampleOffset = currentOffset.asSeconds() * vis.SAMPLE_RATE;
-
-        if (sampleOffset < vis.audioHandler.getSampleCount() - vis.FFT_SIZE) {
-            const sf::Int16* samples = vis.audioHandler.getSamples() + sampleOffset;
-
-            for (int i = 0; i < vis.FFT_SIZE; i++) {
-                in[i] = samples[i] / 32768.0;
-            }
-
-            fftw_execute(p);
-
-            int binSize = (vis.FFT_SIZE / 2 + 1) / vis.BARS;
-            std::vector<float> localMagnitudes(vis.BARS, 0);
-
-            for (int i = 0; i < vis.BARS; i++) {
-                for (int j = 0; j < binSize; j++) {
-                    localMagnitudes[i] += std::sqrt(out[i * binSize + j][0] * out[i * binSize + j][0] + out[i * binSize + j][1] * out[i * binSize + j][1]);
-                }
-                localMagnitudes[i] /= binSize;
-            }
-            vis.mtx.lock();
-            vis.magnitudes = localMagnitudes;
-            vis.mtx.unlock();
-        }
+AudioBars::~AudioBars() {
+    if (running) {
+        end();
     }
-
-    fftw_destroy_plan(p);
-    fftw_cleanup();
 }
 
 /**
- * @brief Loads an audio file for visualization.
- * @param filename The path to the audio file.
+ * @brief Scales a value logarithmically, so that a magnitude of 1 maps to 1.
+ * @param value The value to be scaled.
+ * @return log2(value + 1), from a lookup table.
  */
-void AudioBars::loadFile(const std::string& filename) {
-    audioHandler.loadFile(filename);
+float AudioBars::logScale(float value) {
+    return dsp::log2Approx(value + 1.0f);
 }
 
 /**
- * @brief Initiates the audio visualization.
+ * @brief Writes one quad per bar, standing on the bottom edge of the target.
+ * @param magnitudes Magnitude of each bar.
+ * @param count Number of bars.
+ * @param width Width of the target in pixels.
+ * @param height Height of the target in pixels.
+ * @param vertices Receives 4 * count vertices.
  */
-void AudioBars::run() {
+void AudioBars::buildBarGeometry(const float* magnitudes, int count, float width, float height, sf::Vertex* vertices) {
+    float step = width / count;
+    float barWidth = step > 2.0f ? step - 1.0f : step;
+
+    for (int i = 0; i < count; i++) {
+        float scaledMagnitude = logScale(magnitudes[i]) * 100.0f;
+        sf::Color color = scaledMagnitude > 100 ? sf::Color::Red : sf::Color::Green;
+
+        float left = i * step;
+        float top = height - scaledMagnitude;
+        sf::Vertex* quad = vertices + 4 * i;
+        quad[0] = sf::Vertex(sf::Vector2f(left, top), color);
+        quad[1] = sf::Vertex(sf::Vector2f(left + barWidth, top), color);
+        quad[2] = sf::Vertex(sf::Vector2f(left + barWidth, height), color);
+        quad[3] = sf::Vertex(sf::Vector2f(left, height), color);
+    }
+}
+
+void AudioBars::warmUp() {
+    if (warm) {
+        return;
+    }
     barsWindow.create(sf::VideoMode(WINDOW_X, WINDOW_Y), "Audio Bars");
+    barsWindow.setVisible(false);
     barsWindow.setFramerateLimit(WINDOW_FPS);
 
-    visThread = std::thread(AudioBars::visualizationThread, std::ref(*this));
-    audioHandler.sound.play();
+    // Sized for the largest configuration, so changing the bar count never recreates it.
+    useVertexBuffer = sf::VertexBuffer::isAvailable() && barGeometry.create(4 * MAX_BARS);
+
+    beatMarker.setRadius(12.0f);
+    beatMarker.setPosition(static_cast<float>(WINDOW_X) - 36.0f, 12.0f);
+    beatMarker.setFillColor(sf::Color::White);
+
+    chromaVertices.assign(4 * 12, sf::Vertex());
+    for (int i = 0; i < 12; i++) {
+        float left = CHROMA_MARGIN + i * (CHROMA_CELL + 2.0f);
+        sf::Vertex* quad = chromaVertices.data() + 4 * i;
+        quad[0].position = sf::Vector2f(left, CHROMA_MARGIN);
+        quad[1].position = sf::Vector2f(left + CHROMA_CELL, CHROMA_MARGIN);
+        quad[2].position = sf::Vector2f(left + CHROMA_CELL, CHROMA_MARGIN + CHROMA_CELL);
+        quad[3].position = sf::Vector2f(left, CHROMA_MARGIN + CHROMA_CELL);
+    }
+    fontLoaded = font.loadFromFile("arial.ttf");
+    pitchText.setFont(font);
+    pitchText.setCharacterSize(16);
+    pitchText.setFillColor(sf::Color::White);
+    pitchText.setPosition(CHROMA_MARGIN, CHROMA_MARGIN + CHROMA_CELL + 6.0f);
+
+    bus.warmUp();
+    warm = true;
+}
+
+void AudioBars::begin() {
+    warmUp();
+    barVertices.assign(4 * bus.getBarCount(), sf::Vertex());
+    if (useVertexBuffer) {
+        barGeometry.update(barVertices.data(), barVertices.size(), 0);
+    }
 
-    while (barsWindow.isOpen()) {
-        sf::Event event;
-        while (barsWindow.pollEvent(event)) {
-            if (event.type == sf::Event::Closed) {
-                barsWindow.close();
+    FrameProfiler::setThreadName("render");
+    barsWindow.setVisible(true);
+    subscription = bus.subscribe(AnalysisBus::Spectrum | AnalysisBus::Pitch);
+    haveBeat = false;
+    updatePitchDisplay(PitchAnalyzer::Features());
+    running = true;
+}
+
+bool AudioBars::update() {
+    if (!running) {
+        return false;
+    }
+    ScopedTimer frameTimer(FrameProfiler::Frame);
+    bus.updateClock();
+    sf::Event event;
+    while (barsWindow.pollEvent(event)) {
+        if (profilerOverlay.handleEvent(event)) {
+            continue;
+        }
+        if (event.type == sf::Event::Closed || (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Escape)) {
+            running = false;
+        }
+        if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Space) {
+            if (audioHandler.getStatus() == sf::Sound::Playing) {
+                audioHandler.pause();
             }
-            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Space) {
-                if (audioHandler.sound.getStatus() == sf::Sound::Playing) {
-                    audioHandler.sound.pause();
-                }
-                else if (audioHandler.sound.getStatus() == sf::Sound::Paused) {
-                    audioHandler.sound.play();
-                }
+            else if (audioHandler.getStatus() == sf::Sound::Paused) {
+                audioHandler.play();
             }
         }
-        if (audioHandler.sound.getStatus() == sf::Sound::Stopped) {
-            barsWindow.close();
+    }
+    if (audioHandler.getStatus() == sf::Sound::Stopped) {
+        running = false;
+    }
+
+    // Geometry is rebuilt only when a new spectrum arrives, then drawn in a single call.
+    if (subscription->update()) {
+        ScopedTimer timer(FrameProfiler::Geometry);
+        const AnalysisBus::SpectrumFrame& frame = subscription->getSpectrum();
+        sf::Vector2u size = barsWindow.getSize();
+        buildBarGeometry(frame.magnitudes.data(), static_cast<int>(barVertices.size() / 4), static_cast<float>(size.x), static_cast<float>(size.y), barVertices.data());
+        if (useVertexBuffer) {
+            barGeometry.update(barVertices.data(), barVertices.size(), 0);
+        }
+        updatePitchDisplay(frame.pitch);
+        if (frame.beats.beatCount > 0) {
+            lastBeatFrame = frame.beats.lastBeatFrame;
+            haveBeat = true;
         }
+    }
 
-        mtx.lock();
-        std::vector<float> localMagnitudes = magnitudes;
-        mtx.unlock();
+    // Beats are stamped in playback frames, so the marker lights when the beat is heard, not when it was analysed.
+    const PlaybackClock& clock = bus.getClock();
+    sf::Int64 sinceBeat = static_cast<sf::Int64>(clock.getFrame()) - static_cast<sf::Int64>(lastBeatFrame);
+    bool beatLit = haveBeat && sinceBeat >= 0 && sinceBeat < static_cast<sf::Int64>(BEAT_FLASH_SECONDS * clock.getSampleRate());
 
+    {
+        ScopedTimer timer(FrameProfiler::Draw);
         barsWindow.clear();
-        for (int i = 0; i < localMagnitudes.size(); i++) {
-            float scaledMagnitude = logScale(localMagnitudes[i], 1.0f) * 100.0f;
-            sf::RectangleShape line(sf::Vector2f(15, scaledMagnitude));
-            line.setPosition(i * 16, barsWindow.getSize().y);
-            line.rotate(180);
-            if (scaledMagnitude >  100) {
-                line.setFillColor(sf::Color::Red);
-            }
-            else
-            {
-                line.setFillColor(sf::Color::Green);
-            }
-            barsWindow.draw(line);
+        if (useVertexBuffer) {
+            barsWindow.draw(barGeometry, 0, barVertices.size());
+        }
+        else {
+            barsWindow.draw(barVertices.data(), barVertices.size(), sf::Quads);
+        }
+        if (beatLit) {
+            barsWindow.draw(beatMarker);
+        }
+        barsWindow.draw(chromaVertices.data(), chromaVertices.size(), sf::Quads);
+        if (fontLoaded) {
+            barsWindow.draw(pitchText);
+        }
+        profilerOverlay.draw(barsWindow);
+    }
+    ScopedTimer timer(FrameProfiler::Display);
+    barsWindow.display();
+    return running;
+}
+
+/**
+ * @brief Lights the chroma cells and rewrites the key and chord line when its content changes.
+ * @param pitch Newest pitch features.
+ */
+void AudioBars::updatePitchDisplay(const PitchAnalyzer::Features& pitch) {
+    int note = pitch.frequency > 0.0f ? static_cast<int>(std::lround(69.0 + 12.0 * std::log2(pitch.frequency / 440.0))) : -1;
+    for (int i = 0; i < 12; i++) {
+        sf::Uint8 level = static_cast<sf::Uint8>(40.0f + 215.0f * pitch.chroma[i]);
+        sf::Color color = note >= 0 && note % 12 == i ? sf::Color(level, level, 0) : sf::Color(0, level / 2, level);
+        for (int k = 0; k < 4; k++) {
+            chromaVertices[4 * i + k].color = color;
         }
-        barsWindow.display();
     }
-    audioHandler.sound.pause();
-    visThread.join();
+
+    // Rebuilding the text allocates, so it happens only when the shown names change.
+    if (pitch.key == shownKey && pitch.chord == shownChord && note == shownNote) {
+        return;
+    }
+    shownKey = pitch.key;
+    shownChord = pitch.chord;
+    shownNote = note;
+    char line[64];
+    std::snprintf(line, sizeof(line), "Key %s   Chord %s   Note %s%s", pitch.key >= 0 ? PitchAnalyzer::chordName(pitch.key) : "-",
+        pitch.chord >= 0 ? PitchAnalyzer::chordName(pitch.chord) : "-", note >= 0 ? PitchAnalyzer::chordName(note % 12) : "-",
+        note >= 0 ? std::to_string(note / 12 - 1).c_str() : "");
+    pitchText.setString(line);
+}
+
+bool AudioBars::isOpen() const {
+    return running;
+}
+
+void AudioBars::end() {
+    if (subscription) {
+        // The last view to leave pauses playback.
+        bus.unsubscribe(subscription);
+        subscription = nullptr;
+    }
+    barsWindow.setVisible(false);
+    running = false;
+}
+
+sf::Window& AudioBars::getWindow() {
+    return barsWindow;
 }
@@ -3,63 +3,119 @@
 
 #include <SFML/Audio.hpp>
 #include <SFML/Graphics.hpp>
-#include <fftw3.h>
 #include <cmath>
+#include <algorithm>
 #include <vector>
-#include <thread>
-#include <mutex>
-#include <stdexcept>
 
+#include "AnalysisBus.h"
 #include "AudioHandler.h"
 #include "AudioVisualizer.h"
+#include "FrameProfiler.h"
 
 /**
  * @class AudioBars
  * @brief Visualizes audio in the form of bars.
  *
- * This class uses the FFT algorithm to process audio samples and visualize them as bars.
+ * This class draws the spectra that the AnalysisBus computes with the FFT algorithm as bars.
  * The height of each bar represents the magnitude of the frequency at that index.
+ * A strip of 12 cells above the bars shows the chroma, with the note of the fundamental
+ * highlighted, next to the detected key and chord; a marker flashes on every beat.
  */
 class AudioBars : public AudioVisualizer {
-private:
-    static constexpr int SAMPLE_RATE = 44100;  ///< Sampling rate of the audio.
-    static constexpr int FFT_SIZE = 512;       ///< Size for FFT calculations.
-    static constexpr int BARS = 128;           ///< Number of bars for visualization.
+public:
+    static constexpr int FFT_SIZE = AnalysisBus::FFT_SIZE;    ///< Default size for FFT calculations.
+    static constexpr int BARS = AnalysisBus::BARS;            ///< Default number of bars for visualization.
+    static constexpr int MAX_BARS = AnalysisBus::MAX_BARS;    ///< Most bars a spectrum can hold.
+    static constexpr BandMapping::Scale DEFAULT_SCALE = AnalysisBus::DEFAULT_SCALE; ///< Default spacing of the bars.
 
+private:
     const int WINDOW_X = 1000;                 ///< Window width.
     const int WINDOW_Y = 600;                  ///< Window height.
     const int WINDOW_FPS = 60;                 ///< Window frame rate.
+    const float BEAT_FLASH_SECONDS = 0.1f;     ///< How long the beat marker stays lit after a beat.
 
-    sf::RenderWindow barsWindow;               ///< SFML window for rendering bars.
-    std::thread visThread;                     ///< Thread for audio visualization.
+    sf::RenderWindow barsWindow;               ///< SFML window for rendering bars; hidden between runs.
+    AnalysisBus::Subscription* subscription = nullptr; ///< Spectra from the bus while running.
+    bool warm = false;                         ///< True once warmUp() has created the window.
+    bool running = false;                      ///< True between begin() and the end of the visualization.
 
-    std::vector<float> magnitudes;             ///< Magnitudes for each bar.
-    std::mutex mtx;                            ///< Mutex for synchronizing access to magnitudes.
+    std::vector<sf::Vertex> barVertices;       ///< Quads of all bars, four vertices per bar.
+    sf::VertexBuffer barGeometry;              ///< GPU copy of barVertices, drawn in one call.
+    bool useVertexBuffer;                      ///< False if the driver lacks vertex buffer support.
 
-    static float logScale(float value, float maxVal);
-    static void visualizationThread(AudioBars& vis);
+    static float logScale(float value);
 
     sf::RectangleShape timeline;               ///< Shape representing the audio timeline.
     sf::CircleShape seek;                      ///< Shape for the seek circle.
     sf::Time duration;                         ///< Duration of the loaded audio.
+    sf::CircleShape beatMarker;                ///< Lit on every beat the bus reports.
+    sf::Uint64 lastBeatFrame = 0;              ///< Playback frame of the newest beat seen.
+    bool haveBeat = false;                     ///< True once a beat was seen in this run.
+
+    std::vector<sf::Vertex> chromaVertices;    ///< One quad per pitch class, lit by its chroma.
+    sf::Font font;                             ///< Font of the key and chord line.
+    bool fontLoaded = false;                   ///< False if arial.ttf is missing; the line is not drawn then.
+    sf::Text pitchText;                        ///< Key, chord and note of the newest pitch features.
+    int shownKey = -2;                         ///< Key in pitchText; -2 forces the first update.
+    int shownChord = -2;                       ///< Chord in pitchText.
+    int shownNote = -2;                        ///< MIDI note in pitchText; -1 if no pitch.
+
+    void updatePitchDisplay(const PitchAnalyzer::Features& pitch);
 
 public:
     /**
-     * @brief Constructs the AudioBars visualizer with an audio handler.
-     * @param handler Reference to the audio handler.
+     * @brief Constructs the AudioBars visualizer on an analysis bus.
+     * @param bus Bus that supplies the spectra; its configuration sets the FFT size, bar count and scale.
+     */
+    AudioBars(AnalysisBus& bus);
+
+    /**
+     * @brief Ends a running visualization.
+     */
+    ~AudioBars();
+
+    /**
+     * @brief Creates the hidden window and the vertex buffer for MAX_BARS bars, and warms up the bus.
+     */
+    void warmUp() override;
+
+    /**
+     * @brief Subscribes to the spectra of the bus and shows the window.
+     */
+    void begin() override;
+
+    /**
+     * @brief Handles events and draws the newest spectrum.
+     * @return False once the window was closed or playback stopped.
+     */
+    bool update() override;
+
+    /**
+     * @brief Checks whether a visualization is running.
+     * @return True between begin() and the end of the visualization.
+     */
+    bool isOpen() const override;
+
+    /**
+     * @brief Unsubscribes from the bus and hides the window.
      */
-    AudioBars(AudioHandler& handler);
+    void end() override;
 
     /**
-     * @brief Loads an audio file for visualization.
-     * @param filename The path to the audio file.
+     * @brief Retrieves the bars window.
+     * @return Window created by warmUp().
      */
-    void loadFile(const std::string& filename);
+    sf::Window& getWindow() override;
 
     /**
-     * @brief Initiates the audio visualization.
+     * @brief Writes one quad per bar, standing on the bottom edge of the target.
+     * @param magnitudes Magnitude of each bar.
+     * @param count Number of bars.
+     * @param width Width of the target in pixels.
+     * @param height Height of the target in pixels.
+     * @param vertices Receives 4 * count vertices.
      */
-    void run();
+    static void buildBarGeometry(const float* magnitudes, int count, float width, float height, sf::Vertex* vertices);
 };
 
 #endif // AUDIOBARS_H
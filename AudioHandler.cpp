@@ -1,9 +1,10 @@
 #include "AudioHandler.h"
+#include <algorithm>
 
 /**
  * @brief Default constructor for the AudioHandler class.
  */
-AudioHandler::AudioHandler() { }
+AudioHandler::AudioHandler() : streaming(false), streamingThreshold(DEFAULT_STREAMING_THRESHOLD) { }
 
 /**
  * @brief Loads an audio file into the handler.
@@ -11,48 +12,109 @@ AudioHandler::AudioHandler() { }
  * @throws std::runtime_error If loading the file fails.
  */
 void AudioHandler::loadFile(const std::string& filename) {
-    if (!buffer.loadFromFile(filename)) {
+    stop();
+
+    streaming = shouldStream(filename, streamingThreshold);
+    if (streaming) {
+        decoded.reset();
+        if (!stream.openFromFile(filename)) {
+            throw std::runtime_error("Failed to open file!");
+        }
+    }
+    else {
+        decoded = PcmCache::acquire(filename);
+        if (!stream.openFromDecoded(decoded)) {
+            throw std::runtime_error("Failed to open file!");
+        }
+    }
+    clock.reset(getSampleRate(), getChannelCount(), getSampleCount() / std::max(1u, getChannelCount()));
+}
+
+void AudioHandler::setStreamingThreshold(sf::Uint64 sampleCount) {
+    streamingThreshold = sampleCount;
+}
+
+sf::Uint64 AudioHandler::getStreamingThreshold() const {
+    return streamingThreshold;
+}
+
+bool AudioHandler::shouldStream(const std::string& filename, sf::Uint64 threshold) {
+    // A file decoded earlier in the session needs neither a probe nor a decode.
+    std::shared_ptr<const DecodedAudio> cached = PcmCache::find(filename);
+    if (cached) {
+        return !cached->isMapped() && cached->getSampleCount() > threshold;
+    }
+    WavFile wav;
+    if (wav.open(filename)) {
+        // 16-bit data is played from the mapping whatever its length; opening it reads only the header.
+        return !wav.getInt16() && wav.getFrameCount() * wav.getChannelCount() > threshold;
+    }
+    sf::InputSoundFile probe;
+    if (!probe.openFromFile(filename)) {
         throw std::runtime_error("Failed to open file!");
     }
-    sound.setBuffer(buffer);
+    return probe.getSampleCount() > threshold;
+}
+
+bool AudioHandler::isStreaming() const {
+    return streaming;
 }
 
 void AudioHandler::play() {
-    sound.play();
+    stream.play();
+    updateClock();
 }
 
 void AudioHandler::pause() {
-    sound.pause();
+    stream.pause();
+    updateClock();
 }
 
 void AudioHandler::stop() {
-    sound.stop();
+    stream.stop();
+    updateClock();
+}
+
+void AudioHandler::updateClock() {
+    clock.update(getPlayingOffset(), getStatus() == sf::Sound::Playing);
+}
+
+const PlaybackClock& AudioHandler::getClock() const {
+    return clock;
 }
 
 sf::Time AudioHandler::getDuration() const {
-    return buffer.getDuration();
+    return stream.getDuration();
 }
 
 sf::Time AudioHandler::getPlayingOffset() const {
-    return sound.getPlayingOffset();
+    return stream.getPlayingOffset();
 }
 
 sf::Uint64 AudioHandler::getSampleCount() const {
-    return buffer.getSampleCount();
+    return stream.getSampleCount();
 }
 
 unsigned int AudioHandler::getSampleRate() const {
-    return buffer.getSampleRate();
+    return stream.getSampleRate();
 }
 
 const sf::Int16* AudioHandler::getSamples() const {
-    return buffer.getSamples();
+    return decoded ? decoded->getSamples() : nullptr;
+}
+
+std::size_t AudioHandler::readSamples(sf::Uint64 offset, sf::Int16* dst, std::size_t count) const {
+    return stream.readSamples(offset, dst, count);
+}
+
+std::shared_ptr<const DecodedAudio> AudioHandler::getDecoded() const {
+    return decoded;
 }
 
 unsigned int AudioHandler::getChannelCount() const {
-    return buffer.getChannelCount();
+    return stream.getChannelCount();
 }
 
 sf::Sound::Status AudioHandler::getStatus() const {
-    return sound.getStatus();
+    return stream.getStatus();
 }
\ No newline at end of file
@@ -1,8 +1,13 @@
 #pragma once
 #include <SFML/Audio.hpp>
+#include <memory>
 #include <string>
 #include <stdexcept>
 
+#include "AudioStream.h"
+#include "PcmCache.h"
+#include "PlaybackClock.h"
+
 /**
  * @class AudioHandler
  * @brief A utility class to handle audio operations using SFML.
@@ -10,19 +15,35 @@
  * The AudioHandler class provides basic functionalities for audio operations like
  * playing, pausing, and stopping an audio, as well as retrieving information about
  * the audio file, such as its duration, playing offset, sample count, etc.
+ *
+ * Files longer than the streaming threshold are not decoded as a whole; they are
+ * decoded chunk by chunk while playing and their samples are read in windows with
+ * readSamples(). Shorter files are decoded through the PcmCache, so loading a file again,
+ * from the same or another visualizer, costs a lookup instead of a decode. Their samples
+ * exist once: playback, getSamples() and getDecoded() all point into the cached buffer.
+ * 16-bit WAV files are never streamed: their samples are a mapping of the file, which
+ * opens in constant time however long the file is.
+ *
+ * The playhead is published through a PlaybackClock. Only the thread that calls
+ * updateClock() (the render loop) talks to the audio driver; every other thread reads
+ * the clock.
  */
 class AudioHandler {
 private:
+    AudioStream stream;                 ///< Plays the shared samples, or decodes long files chunk by chunk.
+    bool streaming;                     ///< True if the current file is decoded from disk while playing.
+    sf::Uint64 streamingThreshold;      ///< Sample count above which files are streamed.
+    PlaybackClock clock;                ///< Playhead shared with the analysis threads.
+    std::shared_ptr<const DecodedAudio> decoded; ///< Samples played by stream; nullptr in streaming mode.
 
 public:
+    static constexpr sf::Uint64 DEFAULT_STREAMING_THRESHOLD = 44100ull * 2 * 60 * 10; ///< Ten minutes of 44.1 kHz stereo.
+
     /**
      * @brief Default constructor for the AudioHandler class.
      */
     AudioHandler();
 
-    sf::Sound sound;            ///< SFML Sound object to handle audio playback.
-    sf::SoundBuffer buffer;    ///< Buffer storing audio data.
-
     /**
      * @brief Loads an audio file into the handler.
      * @param filename Path to the audio file.
@@ -30,6 +51,34 @@ public:
      */
     void loadFile(const std::string& filename);
 
+    /**
+     * @brief Sets the sample count above which files are streamed instead of decoded as a whole.
+     * @param sampleCount Threshold in samples (all channels); 0 streams every file.
+     */
+    void setStreamingThreshold(sf::Uint64 sampleCount);
+
+    /**
+     * @brief Retrieves the sample count above which files are streamed.
+     * @return Threshold in samples (all channels).
+     */
+    sf::Uint64 getStreamingThreshold() const;
+
+    /**
+     * @brief Decides whether loadFile() would stream a file, reading at most its header.
+     * Safe to call from any thread.
+     * @param filename Path to the audio file.
+     * @param threshold Sample count above which files are streamed.
+     * @return True if the file would be decoded chunk by chunk while playing.
+     * @throws std::runtime_error If the file cannot be opened.
+     */
+    static bool shouldStream(const std::string& filename, sf::Uint64 threshold);
+
+    /**
+     * @brief Checks whether the current file is played through the streaming decoder.
+     * @return True in streaming mode.
+     */
+    bool isStreaming() const;
+
     /**
      * @brief Starts or resumes the playback of the audio.
      */
@@ -52,11 +101,24 @@ public:
     sf::Time getDuration() const;
 
     /**
-     * @brief Retrieves the current playback position of the audio.
+     * @brief Retrieves the current playback position of the audio, as reported by the driver.
+     * Threads other than the one calling updateClock() should read getClock() instead.
      * @return The current playback offset.
      */
     sf::Time getPlayingOffset() const;
 
+    /**
+     * @brief Feeds the current driver position and status into the playback clock.
+     * Call once per rendered frame from the thread that controls playback.
+     */
+    void updateClock();
+
+    /**
+     * @brief Retrieves the playback clock; safe to read from any thread.
+     * @return The clock of the current file.
+     */
+    const PlaybackClock& getClock() const;
+
     /**
      * @brief Retrieves the number of audio samples.
      * @return The sample count.
@@ -71,10 +133,25 @@ public:
 
     /**
      * @brief Retrieves a pointer to the audio samples.
-     * @return Pointer to the audio samples.
+     * @return Pointer to the audio samples, or nullptr in streaming mode.
      */
     const sf::Int16* getSamples() const;
 
+    /**
+     * @brief Copies a window of interleaved samples, in both buffered and streaming mode.
+     * @param offset Index of the first sample (counted over all channels).
+     * @param dst Destination for the samples.
+     * @param count Number of samples to copy.
+     * @return The number of samples available; the rest of dst is zero-filled.
+     */
+    std::size_t readSamples(sf::Uint64 offset, sf::Int16* dst, std::size_t count) const;
+
+    /**
+     * @brief Retrieves the shared decoded samples of the current file.
+     * @return The cached samples, or nullptr in streaming mode.
+     */
+    std::shared_ptr<const DecodedAudio> getDecoded() const;
+
     /**
      * @brief Retrieves the number of channels in the audio.
      * @return The channel count.
@@ -0,0 +1,125 @@
+#include "AudioLoader.h"
+#include <algorithm>
+
+#include "AudioHandler.h"
+#include "FrameProfiler.h"
+#include "PeakPyramid.h"
+
+LoadHandle::LoadHandle() { }
+
+bool LoadHandle::isValid() const {
+    return state != nullptr;
+}
+
+const std::string& LoadHandle::getPath() const {
+    static const std::string none;
+    return state ? state->path : none;
+}
+
+LoadHandle::Stage LoadHandle::getStage() const {
+    return state ? static_cast<Stage>(state->stage.load()) : Cancelled;
+}
+
+float LoadHandle::getProgress() const {
+    return state ? state->progress.load() : 0.0f;
+}
+
+bool LoadHandle::isPlayable() const {
+    Stage stage = getStage();
+    return stage == Summarizing || stage == Ready;
+}
+
+bool LoadHandle::isFinished() const {
+    Stage stage = getStage();
+    return stage == Ready || stage == Failed || stage == Cancelled;
+}
+
+void LoadHandle::cancel() {
+    if (state) {
+        state->cancelled = true;
+    }
+}
+
+std::shared_ptr<const DecodedAudio> LoadHandle::get() const {
+    return result.valid() ? result.get() : nullptr;
+}
+
+LoadHandle AudioLoader::load(const std::string& path, sf::Uint64 streamingThreshold, ProgressCallback callback) {
+    std::shared_ptr<LoadHandle::State> state = std::make_shared<LoadHandle::State>();
+    state->path = path;
+    state->callback = callback;
+
+    LoadHandle handle;
+    handle.state = state;
+    handle.result = std::async(std::launch::async, [state, streamingThreshold]() {
+        return run(*state, streamingThreshold);
+    }).share();
+    return handle;
+}
+
+/**
+ * @brief Body of the loader thread: decodes, then summarizes, checking for cancellation between chunks.
+ */
+std::shared_ptr<const DecodedAudio> AudioLoader::run(LoadHandle::State& state, sf::Uint64 streamingThreshold) {
+    FrameProfiler::setThreadName("loader");
+    try {
+        advance(state, LoadHandle::Decoding, 0.0f);
+        std::shared_ptr<const DecodedAudio> audio;
+        if (!AudioHandler::shouldStream(state.path, streamingThreshold)) {
+            audio = PcmCache::acquire(state.path, [&state](float done) {
+                advance(state, LoadHandle::Decoding, done);
+                return !state.cancelled;
+            });
+            // Streamed files are summarized by the AnalysisBus while they play.
+            if (!summarize(state, *audio)) {
+                advance(state, LoadHandle::Cancelled, 0.0f);
+                return nullptr;
+            }
+        }
+        advance(state, LoadHandle::Ready, 1.0f);
+        return audio;
+    }
+    catch (...) {
+        if (state.cancelled) {
+            advance(state, LoadHandle::Cancelled, 0.0f);
+            return nullptr;
+        }
+        advance(state, LoadHandle::Failed, 0.0f);
+        throw;
+    }
+}
+
+/**
+ * @brief Builds the peak pyramid of decoded samples into the PcmCache, unless it is cached already.
+ * @return False if the load was cancelled.
+ */
+bool AudioLoader::summarize(LoadHandle::State& state, const DecodedAudio& audio) {
+    advance(state, LoadHandle::Summarizing, 0.0f);
+    if (PcmCache::findPeaks(state.path)) {
+        return true;
+    }
+
+    unsigned int channels = audio.getChannelCount();
+    sf::Uint64 frames = audio.getFrameCount();
+    std::shared_ptr<PeakPyramid> peaks = std::make_shared<PeakPyramid>();
+    peaks->reset(channels, frames);
+    for (sf::Uint64 frame = 0; frame < frames; frame += SUMMARY_CHUNK_FRAMES) {
+        if (state.cancelled) {
+            return false;
+        }
+        advance(state, LoadHandle::Summarizing, static_cast<float>(frame) / frames);
+        std::size_t count = static_cast<std::size_t>(std::min<sf::Uint64>(SUMMARY_CHUNK_FRAMES, frames - frame));
+        peaks->append(audio.getSamples() + frame * channels, count);
+    }
+    peaks->finish();
+    PcmCache::storePeaks(state.path, peaks);
+    return true;
+}
+
+void AudioLoader::advance(LoadHandle::State& state, LoadHandle::Stage stage, float progress) {
+    state.progress = progress;
+    state.stage = stage;
+    if (state.callback) {
+        state.callback(stage, progress);
+    }
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <SFML/Config.hpp>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+
+#include "PcmCache.h"
+
+/**
+ * @class LoadHandle
+ * @brief Handle of a load started by AudioLoader::load(); cheap to copy and safe to poll every frame.
+ *
+ * Dropping the last copy of a handle waits for the load to stop, so cancel() it first.
+ */
+class LoadHandle {
+public:
+    /**
+     * @brief How far a load has come.
+     */
+    enum Stage {
+        Decoding,       ///< Samples are being decoded; nothing can play yet.
+        Summarizing,    ///< Samples can play; the peak pyramid is being built.
+        Ready,          ///< Samples and peaks are in the PcmCache.
+        Failed,         ///< The file could not be loaded; get() rethrows the error.
+        Cancelled       ///< cancel() stopped the load.
+    };
+
+    /**
+     * @brief Creates a handle that refers to no load.
+     */
+    LoadHandle();
+
+    /**
+     * @brief Checks whether the handle refers to a load.
+     * @return False for a default-constructed handle.
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Retrieves the file being loaded.
+     * @return Path passed to AudioLoader::load().
+     */
+    const std::string& getPath() const;
+
+    /**
+     * @brief Retrieves the current stage.
+     * @return Stage of the load.
+     */
+    Stage getStage() const;
+
+    /**
+     * @brief Retrieves the progress of the current stage.
+     * @return Fraction done, from 0 to 1.
+     */
+    float getProgress() const;
+
+    /**
+     * @brief Checks whether the file can be played, even though its peaks may still be building.
+     * @return True in the Summarizing and Ready stages.
+     */
+    bool isPlayable() const;
+
+    /**
+     * @brief Checks whether the load has ended, successfully or not.
+     * @return True in the Ready, Failed and Cancelled stages.
+     */
+    bool isFinished() const;
+
+    /**
+     * @brief Asks the load to stop at the next chunk. Does not wait.
+     */
+    void cancel();
+
+    /**
+     * @brief Waits for the load to end.
+     * @return The decoded samples, or nullptr if the file is streamed or the load was cancelled.
+     * @throws std::runtime_error If the load failed.
+     */
+    std::shared_ptr<const DecodedAudio> get() const;
+
+private:
+    friend class AudioLoader;
+
+    /**
+     * @brief State shared between the handles and the loader thread.
+     */
+    struct State {
+        std::string path;                                   ///< File being loaded.
+        std::atomic<int> stage{ Decoding };                 ///< Current Stage.
+        std::atomic<float> progress{ 0.0f };                ///< Fraction of the current stage done.
+        std::atomic<bool> cancelled{ false };               ///< Set by cancel().
+        std::function<void(Stage, float)> callback;         ///< Progress callback, called on the loader thread.
+    };
+
+    std::shared_ptr<State> state;                                   ///< Shared progress; nullptr for an invalid handle.
+    std::shared_future<std::shared_ptr<const DecodedAudio>> result; ///< Samples, once the load has ended.
+};
+
+/**
+ * @class AudioLoader
+ * @brief Loads files on a background thread, with progress reports and cancellation.
+ *
+ * A load decodes the file into the PcmCache and then summarizes it into a peak pyramid
+ * stored next to it, so the AudioHandler::loadFile() and the AnalysisBus peak pass that
+ * follow are lookups. Files the AudioHandler would stream and mapped 16-bit WAV files
+ * need no decode; they are playable as soon as the header has been read.
+ */
+class AudioLoader {
+public:
+    /**
+     * @brief Receives the stage and its progress from 0 to 1; called on the loader thread.
+     */
+    typedef std::function<void(LoadHandle::Stage, float)> ProgressCallback;
+
+    static constexpr std::size_t SUMMARY_CHUNK_FRAMES = 1 << 16; ///< Frames summarized between progress reports.
+
+    /**
+     * @brief Starts loading a file and returns at once.
+     * @param path Audio file.
+     * @param streamingThreshold Streaming threshold of the AudioHandler that will play the file.
+     * @param callback Optional progress callback.
+     * @return Handle to poll, wait on or cancel.
+     */
+    static LoadHandle load(const std::string& path, sf::Uint64 streamingThreshold, ProgressCallback callback = ProgressCallback());
+
+private:
+    static std::shared_ptr<const DecodedAudio> run(LoadHandle::State& state, sf::Uint64 streamingThreshold);
+    static bool summarize(LoadHandle::State& state, const DecodedAudio& audio);
+    static void advance(LoadHandle::State& state, LoadHandle::Stage stage, float progress);
+};
@@ -0,0 +1,166 @@
+#include "AudioStream.h"
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief Default constructor for the AudioStream class.
+ */
+AudioStream::AudioStream() : position(0), ring(RING_CHUNKS), head(0) { }
+
+/**
+ * @brief Opens an audio file for streaming.
+ * @param filename Path to the audio file.
+ * @return True if the file was opened successfully.
+ */
+bool AudioStream::openFromFile(const std::string& filename) {
+    stop();
+    decoded.reset();
+
+    if (!file.openFromFile(filename)) {
+        return false;
+    }
+
+    std::size_t chunkSamples = CHUNK_FRAMES * file.getChannelCount();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (Slot& slot : ring) {
+            slot.offset = 0;
+            slot.count = 0;
+            slot.samples.resize(chunkSamples);
+        }
+        head = 0;
+    }
+    decodeBuffer.resize(chunkSamples);
+
+    initialize(file.getChannelCount(), file.getSampleRate());
+    return true;
+}
+
+/**
+ * @brief Plays samples that are already decoded, without copying them.
+ * @param audio Shared samples; kept alive while the stream uses them.
+ * @return True if the samples can be played.
+ */
+bool AudioStream::openFromDecoded(std::shared_ptr<const DecodedAudio> audio) {
+    stop();
+    if (!audio || audio->getSampleRate() == 0) {
+        return false;
+    }
+    decoded = audio;
+    position = 0;
+
+    // The ring is only used when decoding from file.
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (Slot& slot : ring) {
+            slot.count = 0;
+            std::vector<sf::Int16>().swap(slot.samples);
+        }
+    }
+    std::vector<sf::Int16>().swap(decodeBuffer);
+
+    initialize(decoded->getChannelCount(), decoded->getSampleRate());
+    return true;
+}
+
+sf::Uint64 AudioStream::getSampleCount() const {
+    return decoded ? decoded->getSampleCount() : file.getSampleCount();
+}
+
+sf::Time AudioStream::getDuration() const {
+    if (decoded) {
+        return sf::microseconds(static_cast<sf::Int64>(decoded->getFrameCount() * 1000000 / decoded->getSampleRate()));
+    }
+    return file.getDuration();
+}
+
+/**
+ * @brief Copies interleaved samples from the shared samples or the decoded chunk ring.
+ * @param offset Index of the first sample (counted over all channels).
+ * @param dst Destination for the samples.
+ * @param count Number of samples to copy.
+ * @return The number of samples that were available; the rest of dst is zero-filled.
+ */
+std::size_t AudioStream::readSamples(sf::Uint64 offset, sf::Int16* dst, std::size_t count) const {
+    if (decoded) {
+        std::size_t size = decoded->getSampleCount();
+        std::size_t available = offset < size ? static_cast<std::size_t>(std::min<sf::Uint64>(count, size - offset)) : 0;
+        if (available > 0) {
+            std::memcpy(dst, decoded->getSamples() + offset, available * sizeof(sf::Int16));
+        }
+        std::fill(dst + available, dst + count, sf::Int16(0));
+        return available;
+    }
+
+    std::fill(dst, dst + count, sf::Int16(0));
+
+    std::size_t copied = 0;
+    std::lock_guard<std::mutex> lock(mtx);
+    for (const Slot& slot : ring) {
+        sf::Uint64 begin = std::max(offset, slot.offset);
+        sf::Uint64 end = std::min(offset + count, slot.offset + slot.count);
+        if (begin >= end) {
+            continue;
+        }
+        std::memcpy(dst + (begin - offset), slot.samples.data() + (begin - slot.offset), (end - begin) * sizeof(sf::Int16));
+        copied += end - begin;
+    }
+    return copied;
+}
+
+/**
+ * @brief Decodes the next chunk into the ring and hands it to the sound stream.
+ * @param data Chunk passed on to OpenAL.
+ * @return False once the end of the file has been reached.
+ */
+bool AudioStream::onGetData(Chunk& data) {
+    FrameProfiler::setThreadName("stream");
+    if (decoded) {
+        // OpenAL copies the chunk when queueing it; nothing is decoded or copied here.
+        std::size_t size = decoded->getSampleCount();
+        std::size_t count = static_cast<std::size_t>(std::min<sf::Uint64>(CHUNK_FRAMES * decoded->getChannelCount(), size - position));
+        data.samples = decoded->getSamples() + position;
+        data.sampleCount = count;
+        position += count;
+        return position < size;
+    }
+
+    sf::Uint64 offset = file.getSampleOffset();
+    std::size_t count;
+    {
+        ScopedTimer timer(FrameProfiler::Decode);
+        count = static_cast<std::size_t>(file.read(decodeBuffer.data(), decodeBuffer.size()));
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    Slot& slot = ring[head];
+    slot.samples.swap(decodeBuffer);
+    slot.offset = offset;
+    slot.count = count;
+    head = (head + 1) % ring.size();
+
+    data.samples = slot.samples.data();
+    data.sampleCount = count;
+    return count == slot.samples.size();
+}
+
+/**
+ * @brief Moves the decoder to a new position and drops the chunks that no longer apply.
+ * @param timeOffset New playing position.
+ */
+void AudioStream::onSeek(sf::Time timeOffset) {
+    if (decoded) {
+        sf::Uint64 frame = static_cast<sf::Uint64>(timeOffset.asMicroseconds()) * decoded->getSampleRate() / 1000000;
+        position = std::min<sf::Uint64>(frame * decoded->getChannelCount(), decoded->getSampleCount());
+        // A mapped file is only read where it is played; start on the new position now.
+        decoded->prefetch(frame, decoded->getSampleRate());
+        return;
+    }
+    file.seek(timeOffset);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    for (Slot& slot : ring) {
+        slot.count = 0;
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <SFML/Audio.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "PcmCache.h"
+
+/**
+ * @class AudioStream
+ * @brief Plays audio chunk by chunk, either decoded on demand or from shared decoded samples.
+ *
+ * Opened from a file, AudioStream decodes on demand from the SFML stream thread and keeps
+ * the most recently decoded chunks in a fixed-size ring. The ring is large enough to
+ * cover the audio queued in OpenAL plus one look-ahead chunk, so visualizers can
+ * still read sample windows around the playing offset while the resident memory
+ * stays the same no matter how long the file is.
+ *
+ * Opened from a DecodedAudio, the chunks handed to OpenAL point straight into the shared
+ * samples, so playback holds no copy of its own next to the cache.
+ */
+class AudioStream : public sf::SoundStream {
+public:
+    static constexpr std::size_t CHUNK_FRAMES = 4096; ///< Frames decoded per chunk.
+    static constexpr std::size_t RING_CHUNKS = 16;    ///< Number of chunks kept in memory.
+
+    /**
+     * @brief Default constructor for the AudioStream class.
+     */
+    AudioStream();
+
+    /**
+     * @brief Opens an audio file for streaming.
+     * @param filename Path to the audio file.
+     * @return True if the file was opened successfully.
+     */
+    bool openFromFile(const std::string& filename);
+
+    /**
+     * @brief Plays samples that are already decoded, without copying them.
+     * @param audio Shared samples; kept alive while the stream uses them.
+     * @return True if the samples can be played.
+     */
+    bool openFromDecoded(std::shared_ptr<const DecodedAudio> audio);
+
+    /**
+     * @brief Retrieves the total number of samples (all channels) in the file.
+     * @return The sample count.
+     */
+    sf::Uint64 getSampleCount() const;
+
+    /**
+     * @brief Retrieves the total duration of the file.
+     * @return The duration of the audio.
+     */
+    sf::Time getDuration() const;
+
+    /**
+     * @brief Copies interleaved samples from the shared samples or the decoded chunk ring.
+     * @param offset Index of the first sample (counted over all channels).
+     * @param dst Destination for the samples.
+     * @param count Number of samples to copy.
+     * @return The number of samples that were available; the rest of dst is zero-filled.
+     */
+    std::size_t readSamples(sf::Uint64 offset, sf::Int16* dst, std::size_t count) const;
+
+protected:
+    bool onGetData(Chunk& data) override;
+    void onSeek(sf::Time timeOffset) override;
+
+private:
+    /**
+     * @brief A decoded chunk of interleaved samples.
+     */
+    struct Slot {
+        sf::Uint64 offset = 0;              ///< Index of the first sample held by the slot.
+        std::size_t count = 0;              ///< Number of valid samples in the slot.
+        std::vector<sf::Int16> samples;     ///< Interleaved samples.
+    };
+
+    std::shared_ptr<const DecodedAudio> decoded; ///< Source in memory; nullptr when decoding from file.
+    sf::Uint64 position;                    ///< Next sample handed out from decoded.
+    sf::InputSoundFile file;                ///< Decoder for the streamed file.
+    std::vector<Slot> ring;                 ///< Ring of the most recently decoded chunks.
+    std::size_t head;                       ///< Slot that receives the next decoded chunk.
+    std::vector<sf::Int16> decodeBuffer;    ///< Scratch buffer filled outside the lock.
+    mutable std::mutex mtx;                 ///< Guards ring against concurrent readers.
+};
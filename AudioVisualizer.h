@@ -1,5 +1,8 @@
 #pragma once
+#include <SFML/Window.hpp>
+#include "AnalysisBus.h"
 #include "AudioHandler.h"
+#include "ProfilerOverlay.h"
 
 /**
  * @class AudioVisualizer
@@ -8,28 +11,80 @@
  * The AudioVisualizer class provides an interface for visualizing audio.
  * Derived classes are expected to provide their own implementations for
  * loading audio files and running the visualization.
+ *
+ * A visualizer keeps its window, render resources and worker threads for its whole
+ * lifetime. warmUp() creates them hidden ahead of time, begin() only shows the window and
+ * resets per-file state, and end() hides it again, so switching modes costs a few
+ * milliseconds instead of a new GL context, textures and FFT plans. The step functions
+ * let a caller drive the frame loop itself; run() is the plain loop over them.
+ *
+ * Views share one AnalysisBus: they take the clock, spectra and peaks from it instead of
+ * analysing the file themselves, so several can run side by side from one analysis pass.
  */
 class AudioVisualizer {
 public:
     /**
-     * @brief Constructor that initializes the AudioVisualizer with an AudioHandler.
-     * @param handler Reference to an AudioHandler instance.
+     * @brief Constructor that initializes the AudioVisualizer with the bus it subscribes to.
+     * @param bus Analysis bus shared with the other views.
+     */
+    AudioVisualizer(AnalysisBus& bus) : bus(bus), audioHandler(bus.getAudioHandler()) {}
+
+    /**
+     * @brief Virtual destructor; derived classes release their windows and threads.
+     */
+    virtual ~AudioVisualizer() {}
+
+    /**
+     * @brief Takes what the view needs from the file the bus has loaded; call after AnalysisBus::loadFile().
+     * Views that take everything from the bus frames keep this default, which does nothing.
+     */
+    virtual void loadFile() {}
+
+    /**
+     * @brief Creates the window, render resources and worker threads, hidden. Later calls do nothing.
+     */
+    virtual void warmUp() = 0;
+
+    /**
+     * @brief Shows the window and starts playing the loaded file; warms up first if needed.
+     */
+    virtual void begin() = 0;
+
+    /**
+     * @brief Handles pending events and renders one frame.
+     * @return False once the visualization has ended, by closing the window or reaching the end of the file.
+     */
+    virtual bool update() = 0;
+
+    /**
+     * @brief Checks whether a visualization is running.
+     * @return True between begin() and the update() that returns false.
+     */
+    virtual bool isOpen() const = 0;
+
+    /**
+     * @brief Pauses playback and hides the window; everything is kept for the next begin().
      */
-    AudioVisualizer(AudioHandler& handler) : audioHandler(handler) {}
+    virtual void end() = 0;
 
     /**
-     * @brief Loads an audio file for visualization.
-     * @param filename Path to the audio file.
-     * @note This is a pure virtual function and must be implemented by derived classes.
+     * @brief Retrieves the window of the visualizer, e.g. to place several side by side.
+     * @return Window created by warmUp().
      */
-    virtual void loadFile(const std::string& filename) = 0;
+    virtual sf::Window& getWindow() = 0;
 
     /**
-     * @brief Starts the audio visualization.
-     * @note This is a pure virtual function and must be implemented by derived classes.
+     * @brief Starts the audio visualization and returns when it ends.
      */
-    virtual void run() = 0;
+    void run() {
+        begin();
+        while (update()) {
+        }
+        end();
+    }
 
 protected:
+    AnalysisBus& bus; ///< Shared clock, spectra and peaks.
     AudioHandler& audioHandler; ///< Reference to the associated AudioHandler instance. Derived classes can access this.
+    ProfilerOverlay profilerOverlay; ///< Frame timing overlay, toggled with ProfilerOverlay::TOGGLE_KEY.
 };
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "BandMapping.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+BandMapping::BandMapping() : scale(Linear), binCount(0), usesPrefix(false) { }
+
+float BandMapping::hzToMel(float hz) {
+    return 2595.0f * std::log10(1.0f + hz / 700.0f);
+}
+
+float BandMapping::melToHz(float mel) {
+    return 700.0f * (std::pow(10.0f, mel / 2595.0f) - 1.0f);
+}
+
+void BandMapping::configure(Scale newScale, int fftSize, int bandCount, unsigned int sampleRate, float minFrequency, float maxFrequency) {
+    scale = newScale;
+    binCount = fftSize / 2 + 1;
+    usesPrefix = false;
+    bands.clear();
+    weightBins.clear();
+    weights.clear();
+
+    if (bandCount < 1 || binCount < 2 || sampleRate == 0) {
+        throw std::runtime_error("Invalid band mapping!");
+    }
+
+    const float binWidth = static_cast<float>(sampleRate) / fftSize;
+    const float nyquist = sampleRate / 2.0f;
+    if (maxFrequency <= 0) {
+        maxFrequency = std::min(nyquist, 20000.0f);
+    }
+    if (minFrequency <= 0) {
+        minFrequency = scale == ConstantQ ? 32.703f : std::max(20.0f, scale == Log ? binWidth : 0.0f);
+    }
+    maxFrequency = std::min(maxFrequency, nyquist);
+    if (scale != Linear && minFrequency >= maxFrequency) {
+        throw std::runtime_error("Invalid band frequency range!");
+    }
+
+    // Weights of the band being built, indexed by bin; addBand() resets what it reads.
+    std::vector<float> binWeights(binCount, 0.0f);
+
+    // Weight of bin k for a rectangular band [low, high): the share of the bin's width inside it.
+    auto rectangle = [&](float low, float high) {
+        int first = std::max(0, static_cast<int>(std::floor(low / binWidth + 0.5f)));
+        int last = std::min(binCount - 1, static_cast<int>(std::floor(high / binWidth + 0.5f)));
+        for (int k = first; k <= last; k++) {
+            float overlap = std::min(high, (k + 0.5f) * binWidth) - std::max(low, (k - 0.5f) * binWidth);
+            binWeights[k] = std::max(0.0f, overlap / binWidth);
+        }
+        return (low + high) / 2;
+    };
+
+    // Weight of bin k for a triangle rising from low to peak and falling to high.
+    auto triangle = [&](float low, float peak, float high) {
+        int first = std::max(0, static_cast<int>(std::ceil(low / binWidth)));
+        int last = std::min(binCount - 1, static_cast<int>(std::floor(high / binWidth)));
+        for (int k = first; k <= last; k++) {
+            float f = k * binWidth;
+            binWeights[k] = f <= peak ? (f - low) / (peak - low) : (high - f) / (high - peak);
+        }
+        return peak;
+    };
+
+    for (int b = 0; b < bandCount; b++) {
+        float centre = 0;
+        switch (scale) {
+        case Linear: {
+            // Same split as SpectrumAnalyzer::barEdge: every bin in exactly one band.
+            int first = static_cast<int>(static_cast<long long>(b) * binCount / bandCount);
+            int last = static_cast<int>(static_cast<long long>(b + 1) * binCount / bandCount);
+            for (int k = first; k < last; k++) {
+                binWeights[k] = 1.0f;
+            }
+            centre = (first + last - 1) * binWidth / 2;
+            break;
+        }
+        case Log: {
+            float ratio = maxFrequency / minFrequency;
+            centre = rectangle(minFrequency * std::pow(ratio, static_cast<float>(b) / bandCount),
+                minFrequency * std::pow(ratio, static_cast<float>(b + 1) / bandCount));
+            break;
+        }
+        case Mel: {
+            float lowMel = hzToMel(minFrequency);
+            float step = (hzToMel(maxFrequency) - lowMel) / (bandCount + 1);
+            centre = triangle(melToHz(lowMel + b * step), melToHz(lowMel + (b + 1) * step), melToHz(lowMel + (b + 2) * step));
+            break;
+        }
+        case ConstantQ: {
+            float ratio = std::pow(maxFrequency / minFrequency, 1.0f / bandCount);
+            float peak = minFrequency * std::pow(ratio, b + 0.5f);
+            centre = triangle(peak / ratio, peak, peak * ratio);
+            break;
+        }
+        }
+
+        // A band narrower than a bin gets the nearest bin rather than nothing.
+        bool empty = std::none_of(binWeights.begin(), binWeights.end(), [](float w) { return w > 0; });
+        if (empty) {
+            int nearest = std::min(binCount - 1, std::max(0, static_cast<int>(std::lround(centre / binWidth))));
+            binWeights[nearest] = 1.0f;
+        }
+        addBand(binWeights);
+    }
+
+    prefix.assign(usesPrefix ? binCount + 1 : 0, 0.0);
+}
+
+/**
+ * @brief Turns the dense weights of one band into a full-weight run plus sparse entries,
+ * and clears them for the next band.
+ * @param dense Weight of every bin; zero outside the band. Cleared on return.
+ */
+void BandMapping::addBand(std::vector<float>& dense) {
+    Band band;
+    band.runFirst = band.runLast = 0;
+    band.weightFirst = static_cast<int>(weights.size());
+
+    // Longest run of full-weight bins, to be summed through the prefix sum.
+    int bestFirst = 0, bestLength = 0;
+    for (int k = 0; k < binCount; ) {
+        if (dense[k] < 0.9999f) {
+            k++;
+            continue;
+        }
+        int first = k;
+        while (k < binCount && dense[k] >= 0.9999f) {
+            k++;
+        }
+        if (k - first > bestLength) {
+            bestFirst = first;
+            bestLength = k - first;
+        }
+    }
+    if (bestLength >= PREFIX_MIN_BINS) {
+        band.runFirst = bestFirst;
+        band.runLast = bestFirst + bestLength;
+        usesPrefix = true;
+    }
+
+    double total = band.runLast - band.runFirst;
+    for (int k = 0; k < binCount; k++) {
+        if (dense[k] > 0 && (k < band.runFirst || k >= band.runLast)) {
+            weightBins.push_back(k);
+            weights.push_back(dense[k]);
+            total += dense[k];
+        }
+        dense[k] = 0;
+    }
+    band.weightLast = static_cast<int>(weights.size());
+    band.scale = static_cast<float>(1.0 / total);
+    bands.push_back(band);
+}
+
+void BandMapping::apply(const float* power, float* levels) {
+    if (usesPrefix) {
+        double sum = 0;
+        prefix[0] = 0;
+        for (int k = 0; k < binCount; k++) {
+            sum += power[k];
+            prefix[k + 1] = sum;
+        }
+    }
+
+    for (std::size_t b = 0; b < bands.size(); b++) {
+        const Band& band = bands[b];
+        double sum = band.runLast > band.runFirst ? prefix[band.runLast] - prefix[band.runFirst] : 0.0;
+        for (int i = band.weightFirst; i < band.weightLast; i++) {
+            sum += weights[i] * power[weightBins[i]];
+        }
+        levels[b] = std::sqrt(std::max(0.0f, static_cast<float>(sum) * band.scale));
+    }
+}
+
+int BandMapping::getBandCount() const {
+    return static_cast<int>(bands.size());
+}
+
+int BandMapping::getBinCount() const {
+    return binCount;
+}
+
+BandMapping::Scale BandMapping::getScale() const {
+    return scale;
+}
+
+const char* BandMapping::scaleName(Scale scale) {
+    switch (scale) {
+    case Linear: return "linear";
+    case Log: return "log";
+    case Mel: return "mel";
+    case ConstantQ: return "cq";
+    default: return "unknown";
+    }
+}
+
+bool BandMapping::parseScale(const std::string& name, Scale& scale) {
+    for (Scale s : { Linear, Log, Mel, ConstantQ }) {
+        if (name == scaleName(s)) {
+            scale = s;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <string>
+#include <vector>
+
+/**
+ * @class BandMapping
+ * @brief Reduces an FFT power spectrum to bands on a linear, logarithmic, mel or constant-Q scale.
+ *
+ * configure() computes the band edges once and turns them into sparse weight tables:
+ * each band keeps a contiguous run of full-weight bins, summed through a prefix sum of
+ * the spectrum when it is wide, plus a short list of weighted bins for its fractional
+ * or sloped parts. Per frame, apply() therefore costs one pass over the bins, a few
+ * multiply-adds per band and one square root per band.
+ *
+ * Bands narrower than a bin (low frequencies on a log scale with a short FFT) still get
+ * the nearest bin, so no band stays empty.
+ */
+class BandMapping {
+public:
+    /**
+     * @brief How band edges are spaced.
+     */
+    enum Scale {
+        Linear,     ///< Equal width in Hz; every bin in exactly one band.
+        Log,        ///< Equal width in octaves, rectangular bands.
+        Mel,        ///< Equal width on the mel scale, overlapping triangular bands.
+        ConstantQ   ///< Geometric centres with bandwidth proportional to frequency, overlapping triangular bands.
+    };
+
+    /**
+     * @brief Creates an empty mapping; apply() does nothing until configure() is called.
+     */
+    BandMapping();
+
+    /**
+     * @brief Builds the weight tables.
+     * @param scale Band spacing.
+     * @param fftSize Samples per FFT window; the spectrum has fftSize / 2 + 1 bins.
+     * @param bands Number of bands.
+     * @param sampleRate Sample rate of the analysed audio.
+     * @param minFrequency Lower edge of the first band in Hz; 0 picks a default for the scale.
+     * @param maxFrequency Upper edge of the last band in Hz; 0 picks the Nyquist frequency, capped at 20 kHz.
+     * Linear bands ignore both and always cover every bin.
+     * @throws std::runtime_error If the parameters leave no frequency range.
+     */
+    void configure(Scale scale, int fftSize, int bands, unsigned int sampleRate, float minFrequency = 0, float maxFrequency = 0);
+
+    /**
+     * @brief Reduces a power spectrum to band levels.
+     * @param power Squared magnitude of each of the getBinCount() bins.
+     * @param levels Receives getBandCount() levels, each the square root of the weighted mean power of its band.
+     */
+    void apply(const float* power, float* levels);
+
+    /**
+     * @brief Retrieves the number of bands.
+     * @return The band count.
+     */
+    int getBandCount() const;
+
+    /**
+     * @brief Retrieves the number of bins apply() expects.
+     * @return fftSize / 2 + 1.
+     */
+    int getBinCount() const;
+
+    /**
+     * @brief Retrieves the scale the mapping was built for.
+     * @return The scale.
+     */
+    Scale getScale() const;
+
+    /**
+     * @brief Retrieves the name of a scale, as accepted by parseScale().
+     * @param scale Scale.
+     * @return "linear", "log", "mel" or "cq".
+     */
+    static const char* scaleName(Scale scale);
+
+    /**
+     * @brief Parses a scale name.
+     * @param name "linear", "log", "mel" or "cq".
+     * @param scale Receives the scale.
+     * @return False if the name is unknown.
+     */
+    static bool parseScale(const std::string& name, Scale& scale);
+
+private:
+    static constexpr int PREFIX_MIN_BINS = 8;  ///< Full-weight runs at least this long are summed through the prefix sum.
+
+    /**
+     * @brief Where a band takes its power from.
+     */
+    struct Band {
+        int runFirst;       ///< First bin of the full-weight run.
+        int runLast;        ///< One past the last bin of the run; equal to runFirst if there is none.
+        int weightFirst;    ///< First entry of the band in weightBins/weights.
+        int weightLast;     ///< One past the last entry.
+        float scale;        ///< 1 / total weight of the band.
+    };
+
+    void addBand(std::vector<float>& dense);
+    static float hzToMel(float hz);
+    static float melToHz(float mel);
+
+    Scale scale;                        ///< Scale of the current tables.
+    int binCount;                       ///< Bins of the expected spectrum.
+    bool usesPrefix;                    ///< True if any band reads the prefix sum.
+    std::vector<Band> bands;            ///< Per-band table.
+    std::vector<int> weightBins;        ///< Bin of each sparse entry.
+    std::vector<float> weights;         ///< Weight of each sparse entry.
+    std::vector<double> prefix;         ///< Running sum of the power; double so quiet bands survive the subtraction.
+};
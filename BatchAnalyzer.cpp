@@ -0,0 +1,258 @@
+#include "BatchAnalyzer.h"
+#include <SFML/Audio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+
+#include "DspKernels.h"
+#include "SpectrumAnalyzer.h"
+#include "ThreadPool.h"
+
+namespace {
+    const sf::Uint64 SEGMENT_COLUMNS = 2048;    ///< Columns per task; long files split into several.
+    const std::size_t BLOCK_COLUMNS = 64;       ///< Columns decoded per read inside a task.
+
+    bool isWavFile(const std::filesystem::path& path) {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension == ".wav";
+    }
+}
+
+/**
+ * @brief A file being analysed; shared by its segment tasks, the last one to finish writes it out.
+ */
+struct BatchAnalyzer::FileJob {
+    std::filesystem::path input;        ///< Audio file.
+    std::filesystem::path output;       ///< Summary file.
+    unsigned int sampleRate = 0;        ///< Frames per second.
+    unsigned int channels = 0;          ///< Samples per frame.
+    sf::Uint64 frames = 0;              ///< Frames in the file.
+    sf::Uint64 columnCount = 0;         ///< Analysis windows in the file.
+    std::size_t segmentCount = 0;       ///< Tasks the columns are split into.
+
+    // Per-segment partial results, bars values each, merged in segment order so the
+    // summary does not depend on scheduling.
+    std::vector<double> sums;           ///< Sum of the magnitudes.
+    std::vector<double> energies;       ///< Sum of the squared magnitudes.
+    std::vector<float> peaks;           ///< Largest magnitude.
+
+    std::atomic<std::size_t> remaining{ 0 };   ///< Segments not yet analysed.
+    std::atomic<bool> failed{ false };         ///< Set by the first segment that fails.
+    std::mutex errorMutex;                     ///< Guards error.
+    std::string error;                         ///< Why the file failed.
+
+    void fail(const std::string& message) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!failed.exchange(true)) {
+            error = message;
+        }
+    }
+};
+
+BatchAnalyzer::BatchAnalyzer(const Options& options) : options(options), inFlight(0) {
+    std::error_code error;
+    if (!std::filesystem::is_directory(options.input, error)) {
+        throw std::runtime_error("Input is not a directory!");
+    }
+    if (!SpectrumAnalyzer::isValid(options.fftSize, options.bars)) {
+        throw std::runtime_error("Unsupported FFT size or bar count!");
+    }
+    float overlap = std::min(std::max(options.overlap, 0.0f), 0.95f);
+    hopSize = std::max<std::size_t>(1, static_cast<std::size_t>(options.fftSize * (1.0f - overlap)));
+}
+
+/**
+ * @brief Analyses every file. Failures are reported on std::cerr and counted; the run goes on.
+ * @return Counts and timings of the run.
+ */
+BatchAnalyzer::Report BatchAnalyzer::run() {
+    std::error_code error;
+    std::filesystem::create_directories(options.output, error);
+    if (!std::filesystem::is_directory(options.output, error)) {
+        throw std::runtime_error("Failed to create the output directory!");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Report report;
+    ThreadPool pool(options.threads);
+    unsigned int limit = options.filesInFlight ? options.filesInFlight : 2 * pool.getThreadCount();
+
+    std::filesystem::recursive_directory_iterator it(options.input, std::filesystem::directory_options::skip_permission_denied, error);
+    for (; !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+        if (!it->is_regular_file(error) || !isWavFile(it->path())) {
+            continue;
+        }
+        {
+            // Open files hold decoders and partial results; wait for a slot before the next one.
+            std::unique_lock<std::mutex> lock(flightMutex);
+            flightDone.wait(lock, [&]() { return inFlight < limit; });
+            inFlight++;
+            report.files++;
+        }
+        startFile(pool, it->path().string(), report);
+    }
+    if (error) {
+        std::cerr << "Failed to list " << options.input << ": " << error.message() << std::endl;
+    }
+
+    pool.wait();
+    report.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+/**
+ * @brief Queues a task that opens a file and splits it into segment tasks.
+ */
+void BatchAnalyzer::startFile(ThreadPool& pool, const std::string& path, Report& report) {
+    std::shared_ptr<FileJob> job = std::make_shared<FileJob>();
+    job->input = path;
+    job->output = std::filesystem::path(options.output) / std::filesystem::relative(job->input, options.input);
+    job->output.replace_extension(".csv");
+
+    pool.submit([this, &pool, job, &report]() {
+        sf::InputSoundFile input;
+        if (!input.openFromFile(job->input.string())) {
+            job->fail("Failed to open file!");
+            finishFile(*job, report);
+            return;
+        }
+        job->sampleRate = input.getSampleRate();
+        job->channels = std::max(1u, input.getChannelCount());
+        job->frames = input.getSampleCount() / job->channels;
+        job->columnCount = job->frames >= static_cast<sf::Uint64>(options.fftSize) ? (job->frames - options.fftSize) / hopSize + 1 : 0;
+        job->segmentCount = static_cast<std::size_t>((job->columnCount + SEGMENT_COLUMNS - 1) / SEGMENT_COLUMNS);
+
+        if (job->segmentCount == 0) {
+            finishFile(*job, report);
+            return;
+        }
+        job->sums.assign(job->segmentCount * options.bars, 0.0);
+        job->energies.assign(job->segmentCount * options.bars, 0.0);
+        job->peaks.assign(job->segmentCount * options.bars, 0.0f);
+        job->remaining = job->segmentCount;
+
+        // Submitted from a worker, the segments land in its own deque; idle workers steal them.
+        for (std::size_t segment = 0; segment < job->segmentCount; segment++) {
+            pool.submit([this, job, segment, &report]() {
+                try {
+                    analyzeSegment(*job, segment);
+                }
+                catch (const std::exception& e) {
+                    job->fail(e.what());
+                }
+                if (job->remaining.fetch_sub(1) == 1) {
+                    finishFile(*job, report);
+                }
+            });
+        }
+    });
+}
+
+/**
+ * @brief Analyses the columns of one segment and stores its partial sums.
+ */
+void BatchAnalyzer::analyzeSegment(FileJob& job, std::size_t segment) const {
+    if (job.failed) {
+        return;
+    }
+    sf::InputSoundFile input;
+    if (!input.openFromFile(job.input.string())) {
+        throw std::runtime_error("Failed to open file!");
+    }
+
+    std::unique_ptr<SpectrumAnalyzer> analyzer = SpectrumAnalyzer::create(options.fftSize, options.bars, options.scale, job.sampleRate);
+    std::size_t blockFrames = (BLOCK_COLUMNS - 1) * hopSize + options.fftSize;
+    std::vector<sf::Int16> interleaved(blockFrames * job.channels);
+    std::vector<sf::Int16> mono(blockFrames);
+    std::vector<float> magnitudes(options.bars);
+
+    double* sum = job.sums.data() + segment * options.bars;
+    double* energy = job.energies.data() + segment * options.bars;
+    float* peak = job.peaks.data() + segment * options.bars;
+
+    sf::Uint64 first = segment * SEGMENT_COLUMNS;
+    sf::Uint64 last = std::min(job.columnCount, first + SEGMENT_COLUMNS);
+    for (sf::Uint64 column = first; column < last && !job.failed; column += BLOCK_COLUMNS) {
+        sf::Uint64 count = std::min<sf::Uint64>(BLOCK_COLUMNS, last - column);
+        std::size_t wanted = static_cast<std::size_t>((count - 1) * hopSize + options.fftSize);
+
+        input.seek(column * hopSize * job.channels);
+        std::size_t got = static_cast<std::size_t>(input.read(interleaved.data(), wanted * job.channels));
+        std::fill(interleaved.begin() + got, interleaved.begin() + wanted * job.channels, sf::Int16(0));
+        dsp::downmix(interleaved.data(), mono.data(), wanted, job.channels);
+
+        for (sf::Uint64 k = 0; k < count; k++) {
+            analyzer->analyze(mono.data() + k * hopSize, magnitudes.data());
+            for (int bar = 0; bar < options.bars; bar++) {
+                float m = magnitudes[bar];
+                sum[bar] += m;
+                energy[bar] += static_cast<double>(m) * m;
+                peak[bar] = std::max(peak[bar], m);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Merges the segments, writes the summary and frees the file's slot.
+ */
+void BatchAnalyzer::finishFile(FileJob& job, Report& report) {
+    bool written = !job.failed && writeSummary(job);
+    if (!job.failed && !written) {
+        job.fail("Failed to write " + job.output.string());
+    }
+    if (job.failed) {
+        std::cerr << job.input.string() << ": " << job.error << std::endl;
+    }
+
+    // The partial results are no longer needed; release them before the slot.
+    std::vector<double>().swap(job.sums);
+    std::vector<double>().swap(job.energies);
+    std::vector<float>().swap(job.peaks);
+
+    {
+        std::lock_guard<std::mutex> lock(flightMutex);
+        if (job.failed) {
+            report.failed++;
+        }
+        else if (job.sampleRate) {
+            report.audioSeconds += static_cast<double>(job.frames) / job.sampleRate;
+        }
+        inFlight--;
+    }
+    flightDone.notify_one();
+}
+
+/**
+ * @brief Writes one CSV row per bar: mean and peak magnitude and mean energy over all columns.
+ */
+bool BatchAnalyzer::writeSummary(const FileJob& job) const {
+    std::error_code error;
+    std::filesystem::create_directories(job.output.parent_path(), error);
+
+    std::ofstream file(job.output);
+    if (!file) {
+        return false;
+    }
+    double columns = static_cast<double>(std::max<sf::Uint64>(1, job.columnCount));
+    file << "bar,mean,peak,energy\n";
+    for (int bar = 0; bar < options.bars; bar++) {
+        double sum = 0, energy = 0;
+        float peak = 0;
+        for (std::size_t segment = 0; segment < job.segmentCount; segment++) {
+            sum += job.sums[segment * options.bars + bar];
+            energy += job.energies[segment * options.bars + bar];
+            peak = std::max(peak, job.peaks[segment * options.bars + bar]);
+        }
+        file << bar << ',' << sum / columns << ',' << peak << ',' << energy / columns << '\n';
+    }
+    return static_cast<bool>(file);
+}
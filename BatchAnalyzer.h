@@ -0,0 +1,81 @@
+#pragma once
+#include <SFML/Config.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BandMapping.h"
+
+class ThreadPool;
+
+/**
+ * @class BatchAnalyzer
+ * @brief Writes a spectral summary for every WAV file under a directory, without a window.
+ *
+ * Each file is split into segments of analysis columns that run as separate tasks on a
+ * work-stealing ThreadPool, so one long track spreads over all cores as well as many
+ * short ones. Segments run the same SpectrumAnalyzer and mono downmix as AudioBars and
+ * decode through their own sf::InputSoundFile in small blocks. The directory walk
+ * admits a new file only while fewer than filesInFlight are open, which bounds peak
+ * memory independently of the size of the collection.
+ *
+ * The summary of a file goes to the same relative path under the output directory,
+ * with a ".csv" extension: one row per bar with the mean and peak magnitude and the
+ * mean energy (squared magnitude) over all columns.
+ */
+class BatchAnalyzer {
+public:
+    /**
+     * @brief What to analyse and where to write it.
+     */
+    struct Options {
+        std::string input;              ///< Directory searched recursively for .wav files.
+        std::string output;             ///< Directory that receives the summaries.
+        unsigned int threads = 0;       ///< Worker threads; 0 uses every core.
+        unsigned int filesInFlight = 0; ///< Files open at once; 0 uses twice the thread count.
+        int fftSize = 512;              ///< Frames per FFT window.
+        int bars = 128;                 ///< Number of bars per column.
+        BandMapping::Scale scale = BandMapping::Log; ///< Spacing of the bars.
+        float overlap = 0.5f;           ///< Fraction shared by consecutive windows.
+    };
+
+    /**
+     * @brief Outcome of a run.
+     */
+    struct Report {
+        std::size_t files = 0;          ///< Files found.
+        std::size_t failed = 0;         ///< Files that could not be analysed.
+        double audioSeconds = 0;        ///< Total duration of the analysed files.
+        double wallSeconds = 0;         ///< Time the run took.
+    };
+
+    /**
+     * @brief Checks the options.
+     * @param options What to analyse and where.
+     * @throws std::runtime_error If the input is not a directory or the analysis size is unsupported.
+     */
+    explicit BatchAnalyzer(const Options& options);
+
+    /**
+     * @brief Analyses every file. Failures are reported on std::cerr and counted; the run goes on.
+     * @return Counts and timings of the run.
+     * @throws std::runtime_error If the output directory cannot be created.
+     */
+    Report run();
+
+private:
+    struct FileJob;
+
+    void startFile(ThreadPool& pool, const std::string& path, Report& report);
+    void analyzeSegment(FileJob& job, std::size_t segment) const;
+    void finishFile(FileJob& job, Report& report);
+    bool writeSummary(const FileJob& job) const;
+
+    Options options;                    ///< What to analyse and where.
+    std::size_t hopSize;                ///< Frames between consecutive windows.
+
+    std::mutex flightMutex;             ///< Guards inFlight and the report.
+    std::condition_variable flightDone; ///< Signalled when a file finishes.
+    unsigned int inFlight;              ///< Files opened and not yet written.
+};
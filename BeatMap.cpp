@@ -0,0 +1,120 @@
+#include "BeatMap.h"
+#include <SFML/Audio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+#include "DspKernels.h"
+#include "SpectrumAnalyzer.h"
+#include "ThreadPool.h"
+
+namespace {
+    const sf::Uint64 SEGMENT_COLUMNS = 2048;    ///< Columns per task; long files split into several.
+    const std::size_t BLOCK_COLUMNS = 64;       ///< Columns decoded per read inside a task.
+}
+
+BeatMap::BeatMap(const Options& options) : options(options) {
+    if (!SpectrumAnalyzer::isValid(options.fftSize, options.bars)) {
+        throw std::runtime_error("Unsupported FFT size or bar count!");
+    }
+    float overlap = std::min(std::max(options.overlap, 0.0f), 0.95f);
+    hopSize = std::max<std::size_t>(1, static_cast<std::size_t>(options.fftSize * (1.0f - overlap)));
+}
+
+/**
+ * @brief Computes the flux of every column in parallel, then tracks beats over it in order.
+ * @return Onsets and beats.
+ */
+BeatMap::Result BeatMap::run() {
+    auto start = std::chrono::steady_clock::now();
+    sf::InputSoundFile input;
+    if (!input.openFromFile(options.input)) {
+        throw std::runtime_error("Failed to open file!");
+    }
+    Result result;
+    unsigned int channels = std::max(1u, input.getChannelCount());
+    result.sampleRate = input.getSampleRate();
+    result.frames = input.getSampleCount() / channels;
+    sf::Uint64 columnCount = result.frames >= static_cast<sf::Uint64>(options.fftSize) ? (result.frames - options.fftSize) / hopSize + 1 : 0;
+
+    std::vector<float> flux(static_cast<std::size_t>(columnCount), 0.0f);
+    {
+        ThreadPool pool(options.threads);
+        for (sf::Uint64 first = 0; first < columnCount; first += SEGMENT_COLUMNS) {
+            sf::Uint64 last = std::min(columnCount, first + SEGMENT_COLUMNS);
+            unsigned int sampleRate = result.sampleRate;
+            pool.submit([this, first, last, sampleRate, channels, &flux]() {
+                analyzeSegment(first, last, sampleRate, channels, flux);
+            });
+        }
+        pool.wait();
+    }
+
+    BeatTracker tracker;
+    tracker.configure(options.bars, hopSize, result.sampleRate);
+    for (sf::Uint64 column = 0; column < columnCount; column++) {
+        // Stamped at the centre of the window, like the beats AnalysisBus reports.
+        sf::Uint64 frame = column * hopSize + options.fftSize / 2;
+        if (tracker.processFlux(flux[static_cast<std::size_t>(column)], frame)) {
+            result.beats.push_back({ tracker.getState().lastBeatFrame, tracker.getState().bpm, tracker.lastBeatWasOnset() });
+        }
+    }
+    result.bpm = tracker.getState().bpm;
+    result.onsets = tracker.getState().onsetCount;
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+/**
+ * @brief Computes the flux of the columns [first, last), starting from the spectrum of the column before.
+ */
+void BeatMap::analyzeSegment(sf::Uint64 first, sf::Uint64 last, unsigned int sampleRate, unsigned int channels, std::vector<float>& flux) const {
+    sf::InputSoundFile input;
+    if (!input.openFromFile(options.input)) {
+        throw std::runtime_error("Failed to open file!");
+    }
+
+    std::unique_ptr<SpectrumAnalyzer> analyzer = SpectrumAnalyzer::create(options.fftSize, options.bars, options.scale, sampleRate);
+    std::size_t blockFrames = (BLOCK_COLUMNS - 1) * hopSize + options.fftSize;
+    std::vector<sf::Int16> interleaved(blockFrames * channels);
+    std::vector<sf::Int16> mono(blockFrames);
+    std::vector<float> previous(options.bars);
+    std::vector<float> current(options.bars);
+
+    // The first column of the file has no predecessor; a sequential pass gives it no flux either.
+    sf::Uint64 column = first > 0 ? first - 1 : first;
+    bool havePrevious = false;
+    while (column < last) {
+        sf::Uint64 count = std::min<sf::Uint64>(BLOCK_COLUMNS, last - column);
+        std::size_t wanted = static_cast<std::size_t>((count - 1) * hopSize + options.fftSize);
+
+        input.seek(column * hopSize * channels);
+        std::size_t got = static_cast<std::size_t>(input.read(interleaved.data(), wanted * channels));
+        std::fill(interleaved.begin() + got, interleaved.begin() + wanted * channels, sf::Int16(0));
+        dsp::downmix(interleaved.data(), mono.data(), wanted, channels);
+
+        for (sf::Uint64 k = 0; k < count; k++, column++) {
+            analyzer->analyze(mono.data() + k * hopSize, current.data());
+            if (havePrevious) {
+                flux[static_cast<std::size_t>(column)] = BeatTracker::spectralFlux(previous.data(), current.data(), options.bars);
+            }
+            previous.swap(current);
+            havePrevious = true;
+        }
+    }
+}
+
+bool BeatMap::write(const Result& result, const std::string& path) {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+    double rate = static_cast<double>(std::max(1u, result.sampleRate));
+    file << "time,frame,bpm,onset\n";
+    for (const BeatTracker::Beat& beat : result.beats) {
+        file << beat.frame / rate << ',' << beat.frame << ',' << beat.bpm << ',' << (beat.onset ? 1 : 0) << '\n';
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <SFML/Config.hpp>
+#include <string>
+#include <vector>
+
+#include "BandMapping.h"
+#include "BeatTracker.h"
+
+/**
+ * @class BeatMap
+ * @brief Lists the onsets and beats of a whole file, without a window.
+ *
+ * The spectral flux of every analysis column is computed in segments that run as
+ * separate tasks on a ThreadPool, like BatchAnalyzer. Each segment analyses one column
+ * before its first, so the flux at segment edges matches a sequential pass, and writes
+ * into its own slice of one array. A single BeatTracker then walks the flux in order;
+ * that pass is a few operations per column and takes a fraction of the FFT time.
+ *
+ * The beats are the ones AnalysisBus reports during playback of the same file with the
+ * same analysis configuration, stamped with the same playback frames.
+ */
+class BeatMap {
+public:
+    /**
+     * @brief What to analyse.
+     */
+    struct Options {
+        std::string input;              ///< Audio file.
+        unsigned int threads = 0;       ///< Worker threads; 0 uses every core.
+        int fftSize = 512;              ///< Frames per FFT window.
+        int bars = 128;                 ///< Number of bars per column.
+        BandMapping::Scale scale = BandMapping::Log; ///< Spacing of the bars.
+        float overlap = 0.5f;           ///< Fraction shared by consecutive windows.
+    };
+
+    /**
+     * @brief Onsets and beats of a file.
+     */
+    struct Result {
+        unsigned int sampleRate = 0;    ///< Frames per second.
+        sf::Uint64 frames = 0;          ///< Frames in the file.
+        float bpm = 0.0f;               ///< Tempo estimate at the end of the file; 0 if none was found.
+        sf::Uint64 onsets = 0;          ///< Onsets detected.
+        std::vector<BeatTracker::Beat> beats; ///< Beats in playback order.
+        double wallSeconds = 0;         ///< Time the scan took.
+    };
+
+    /**
+     * @brief Checks the options.
+     * @param options What to analyse.
+     * @throws std::runtime_error If the analysis size is unsupported.
+     */
+    explicit BeatMap(const Options& options);
+
+    /**
+     * @brief Analyses the file.
+     * @return Onsets and beats.
+     * @throws std::runtime_error If the file cannot be opened or read.
+     */
+    Result run();
+
+    /**
+     * @brief Writes one CSV row per beat: time in seconds, frame, tempo and whether it fell on an onset.
+     * @param result Beats to write.
+     * @param path CSV file.
+     * @return False if the file could not be written.
+     */
+    static bool write(const Result& result, const std::string& path);
+
+private:
+    void analyzeSegment(sf::Uint64 first, sf::Uint64 last, unsigned int sampleRate, unsigned int channels, std::vector<float>& flux) const;
+
+    Options options;                    ///< What to analyse.
+    std::size_t hopSize;                ///< Frames between consecutive windows.
+};
@@ -0,0 +1,226 @@
+#include "BeatTracker.h"
+#include <algorithm>
+#include <cmath>
+
+#include "DspKernels.h"
+
+namespace {
+    const float FLUX_FLOOR = 1e-3f;     ///< Smallest threshold, so silence and constant tones never trigger.
+    const int LOST_BEATS = 4;           ///< Predicted beats in a row without an onset before the lock is dropped.
+    const int WARM_UP_PERIODS = 2;      ///< Longest periods of history needed before the tempo is trusted.
+}
+
+BeatTracker::BeatTracker() : bars(0), framesPerHop(1), hopsPerSecond(1), havePrevious(false), fluxHead(0), fluxCount(0), fluxSum(0), fluxSquares(0),
+    fluxBefore(0), fluxLast(0), thresholdLast(0), frameLast(0), minOnsetFrames(0), strengthHead(0), minLag(1), maxLag(2), decay(1), hops(0),
+    periodFrames(0), predictedFrame(0), lastWasOnset(false), missedBeats(0) { }
+
+void BeatTracker::configure(int bars, std::size_t hopFrames, unsigned int sampleRate) {
+    this->bars = bars;
+    framesPerHop = static_cast<double>(std::max<std::size_t>(1, hopFrames));
+    hopsPerSecond = sampleRate / framesPerHop;
+    previous.assign(bars, 0.0f);
+
+    fluxHistory.assign(std::max<std::size_t>(3, static_cast<std::size_t>(THRESHOLD_SECONDS * hopsPerSecond)), 0.0f);
+    minOnsetFrames = static_cast<sf::Uint64>(MIN_ONSET_SECONDS * sampleRate);
+
+    minLag = std::max<std::size_t>(1, static_cast<std::size_t>(std::floor(hopsPerSecond * 60.0 / MAX_BPM)));
+    maxLag = std::max(minLag + 2, static_cast<std::size_t>(std::ceil(hopsPerSecond * 60.0 / MIN_BPM)));
+    strengths.assign(maxLag + 1, 0.0f);
+    correlation.assign(maxLag + 1, 0.0f);
+    prior.assign(maxLag + 1, 0.0f);
+    for (std::size_t lag = minLag; lag <= maxLag; lag++) {
+        double octaves = std::log2(60.0 * hopsPerSecond / lag / PRIOR_BPM) / PRIOR_OCTAVES;
+        prior[lag] = static_cast<float>(std::exp(-0.5 * octaves * octaves));
+    }
+    decay = static_cast<float>(std::exp(-1.0 / (TEMPO_SECONDS * hopsPerSecond)));
+    reset();
+}
+
+void BeatTracker::reset() {
+    std::fill(previous.begin(), previous.end(), 0.0f);
+    havePrevious = false;
+    std::fill(fluxHistory.begin(), fluxHistory.end(), 0.0f);
+    fluxHead = 0;
+    fluxCount = 0;
+    fluxSum = 0;
+    fluxSquares = 0;
+    fluxBefore = 0;
+    fluxLast = 0;
+    thresholdLast = 0;
+    frameLast = 0;
+    std::fill(strengths.begin(), strengths.end(), 0.0f);
+    std::fill(correlation.begin(), correlation.end(), 0.0f);
+    strengthHead = 0;
+    hops = 0;
+    periodFrames = 0;
+    predictedFrame = 0;
+    lastWasOnset = false;
+    missedBeats = 0;
+    state = State();
+}
+
+float BeatTracker::spectralFlux(const float* previous, const float* current, int bars) {
+    float flux = 0.0f;
+    for (int i = 0; i < bars; i++) {
+        // Log magnitudes make the flux follow relative changes, so loud bars do not drown quiet ones.
+        float rise = dsp::log2Approx(current[i] + 1.0f) - dsp::log2Approx(previous[i] + 1.0f);
+        flux += std::max(rise, 0.0f);
+    }
+    return flux;
+}
+
+bool BeatTracker::process(const float* magnitudes, sf::Uint64 frame) {
+    float flux = havePrevious ? spectralFlux(previous.data(), magnitudes, bars) : 0.0f;
+    std::copy(magnitudes, magnitudes + bars, previous.begin());
+    havePrevious = true;
+    return processFlux(flux, frame);
+}
+
+bool BeatTracker::processFlux(float flux, sf::Uint64 frame) {
+    double mean = fluxCount ? fluxSum / fluxCount : 0.0;
+    double variance = fluxCount ? std::max(0.0, fluxSquares / fluxCount - mean * mean) : 0.0;
+    // Between sparse onsets the deviation shrinks to that of the noise; the ratio keeps noise peaks out.
+    float threshold = static_cast<float>(std::max(mean + THRESHOLD_DEVIATIONS * std::sqrt(variance), THRESHOLD_RATIO * mean)) + FLUX_FLOOR;
+
+    // The previous hop is an onset if it rose above its threshold and is a local peak.
+    sf::Uint64 candidateFrame = frameLast;
+    bool onset = hops >= 2 && fluxLast > thresholdLast && fluxLast >= fluxBefore && fluxLast > flux
+        && (state.onsetCount == 0 || candidateFrame >= state.lastOnsetFrame + minOnsetFrames);
+    if (onset) {
+        state.onsetCount++;
+        state.lastOnsetFrame = candidateFrame;
+    }
+
+    updateTempo(static_cast<float>(std::max(0.0, flux - mean)));
+
+    if (fluxCount == fluxHistory.size()) {
+        float oldest = fluxHistory[fluxHead];
+        fluxSum -= oldest;
+        fluxSquares -= static_cast<double>(oldest) * oldest;
+    }
+    else {
+        fluxCount++;
+    }
+    fluxHistory[fluxHead] = flux;
+    fluxHead = (fluxHead + 1) % fluxHistory.size();
+    fluxSum += flux;
+    fluxSquares += static_cast<double>(flux) * flux;
+
+    fluxBefore = fluxLast;
+    fluxLast = flux;
+    thresholdLast = threshold;
+    frameLast = frame;
+    hops++;
+    state.flux = flux;
+    state.threshold = threshold;
+
+    return trackBeats(onset, candidateFrame);
+}
+
+/**
+ * @brief Adds the onset strength of a hop to the autocorrelation and re-estimates the tempo.
+ */
+void BeatTracker::updateTempo(float strength) {
+    std::size_t size = strengths.size();
+    strengthHead = strengthHead + 1 == size ? 0 : strengthHead + 1;
+    strengths[strengthHead] = strength;
+
+    for (std::size_t lag = minLag; lag <= maxLag; lag++) {
+        std::size_t older = strengthHead >= lag ? strengthHead - lag : strengthHead + size - lag;
+        correlation[lag] = decay * correlation[lag] + strength * strengths[older];
+    }
+    if (hops < WARM_UP_PERIODS * maxLag) {
+        return;
+    }
+
+    // A period between two lags splits its correlation over both, so every lag is scored
+    // together with its neighbours.
+    auto spread = [this](std::size_t lag) {
+        return correlation[lag - 1] + correlation[lag] + (lag < maxLag ? correlation[lag + 1] : 0.0f);
+    };
+    std::size_t best = 0;
+    float bestScore = 0.0f;
+    for (std::size_t lag = minLag; lag <= maxLag; lag++) {
+        float score = spread(lag) * prior[lag];
+        if (score > bestScore) {
+            bestScore = score;
+            best = lag;
+        }
+    }
+    if (best == 0) {
+        return;
+    }
+
+    // A pulse correlates at twice its period as well as at its period, and the prior
+    // favours the slower of the two above PRIOR_BPM; half the lag wins if it correlates
+    // nearly as well, so tempos up to MAX_BPM are not reported an octave down.
+    std::size_t half = (best + 1) / 2;
+    if (half >= minLag && spread(half) >= DOUBLE_TEMPO_RATIO * spread(best)) {
+        best = half;
+        bestScore = spread(best) * prior[best];
+    }
+
+    // Refine the lag between hops with a parabola through the best score and its neighbours.
+    double lag = static_cast<double>(best);
+    if (best > minLag && best < maxLag) {
+        double left = spread(best - 1) * prior[best - 1];
+        double right = spread(best + 1) * prior[best + 1];
+        double curvature = left - 2.0 * bestScore + right;
+        if (curvature < 0.0) {
+            lag += 0.5 * (left - right) / curvature;
+        }
+    }
+    periodFrames = lag * framesPerHop;
+    state.bpm = static_cast<float>(60.0 * hopsPerSecond / lag);
+}
+
+/**
+ * @brief Locks beats to onsets near the prediction and predicts beats through gaps.
+ * @param onset True if the hop confirmed an onset.
+ * @param candidateFrame Frame of the hop that was checked for an onset.
+ * @return True if a beat was added.
+ */
+bool BeatTracker::trackBeats(bool onset, sf::Uint64 candidateFrame) {
+    if (periodFrames <= 0.0) {
+        return false;
+    }
+    double tolerance = BEAT_TOLERANCE * periodFrames;
+    double position = static_cast<double>(candidateFrame);
+
+    // Lost or never locked, or the playhead jumped: the next onset starts a new beat grid.
+    if (predictedFrame > 0.0 && (position > predictedFrame + LOST_BEATS * periodFrames || position < predictedFrame - 2.0 * periodFrames)) {
+        predictedFrame = 0.0;
+    }
+    if (predictedFrame <= 0.0 || (onset && std::abs(position - predictedFrame) <= tolerance)) {
+        if (!onset) {
+            return false;
+        }
+        addBeat(candidateFrame, true);
+        return true;
+    }
+    if (position > predictedFrame + tolerance) {
+        addBeat(static_cast<sf::Uint64>(predictedFrame + 0.5), false);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Records a beat and predicts the next one a period later.
+ */
+void BeatTracker::addBeat(sf::Uint64 frame, bool onset) {
+    missedBeats = onset ? 0 : missedBeats + 1;
+    lastWasOnset = onset;
+    predictedFrame = missedBeats >= LOST_BEATS ? 0.0 : static_cast<double>(frame) + periodFrames;
+    state.beatCount++;
+    state.lastBeatFrame = frame;
+    state.nextBeatFrame = static_cast<sf::Uint64>(predictedFrame + 0.5);
+}
+
+const BeatTracker::State& BeatTracker::getState() const {
+    return state;
+}
+
+bool BeatTracker::lastBeatWasOnset() const {
+    return lastWasOnset;
+}
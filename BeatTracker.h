@@ -0,0 +1,157 @@
+#pragma once
+#include <SFML/Config.hpp>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class BeatTracker
+ * @brief Incremental onset and beat detection on a stream of spectra.
+ *
+ * Every hop, the spectral flux of the new spectrum (the summed increase of its log
+ * magnitudes over the previous one) is compared with an adaptive threshold: the mean
+ * plus a multiple of the standard deviation of the recent flux, and at least a multiple
+ * of the mean. A flux peak above the threshold is an onset; peaks are confirmed one hop
+ * late, once the flux falls again.
+ *
+ * The tempo comes from an exponentially decaying autocorrelation of the onset strength,
+ * updated with one multiply-add per candidate lag, and weighted towards 120 BPM to
+ * avoid octave errors; half the winning lag takes over if it correlates nearly as well,
+ * so fast tempos are not halved by the weighting. Beats lock to onsets that land near
+ * the predicted beat and coast on the tempo through gaps, so getState() always holds
+ * the last beat and a prediction of the next one, as frames of the playback clock.
+ *
+ * configure() allocates; process() and processFlux() cost O(bars) and O(lags) per hop
+ * and never allocate. Spectral flux is computed on bars rather than FFT bins, which is
+ * what the analysis bus publishes.
+ */
+class BeatTracker {
+public:
+    static constexpr float MIN_BPM = 60.0f;         ///< Slowest tempo considered.
+    static constexpr float MAX_BPM = 200.0f;        ///< Fastest tempo considered.
+
+    /**
+     * @brief Onsets and beats so far; counts let a reader that skips hops notice every new event.
+     */
+    struct State {
+        sf::Uint64 onsetCount = 0;      ///< Onsets detected since reset().
+        sf::Uint64 lastOnsetFrame = 0;  ///< Frame of the last onset.
+        sf::Uint64 beatCount = 0;       ///< Beats detected since reset().
+        sf::Uint64 lastBeatFrame = 0;   ///< Frame of the last beat.
+        sf::Uint64 nextBeatFrame = 0;   ///< Predicted frame of the next beat; 0 while no beat grid is locked.
+        float bpm = 0.0f;               ///< Current tempo estimate; 0 until enough onsets were seen.
+        float flux = 0.0f;              ///< Spectral flux of the last hop.
+        float threshold = 0.0f;         ///< Adaptive onset threshold of the last hop.
+    };
+
+    /**
+     * @brief A beat, as listed by BeatMap.
+     */
+    struct Beat {
+        sf::Uint64 frame;               ///< Frame of the beat.
+        float bpm;                      ///< Tempo estimate at the beat.
+        bool onset;                     ///< True if the beat fell on an onset, false if it was predicted through a gap.
+    };
+
+    /**
+     * @brief Creates a tracker that needs configure() before use.
+     */
+    BeatTracker();
+
+    /**
+     * @brief Sizes the history for a hop rate and clears it. Allocates.
+     * @param bars Values per spectrum.
+     * @param hopFrames Frames between consecutive spectra.
+     * @param sampleRate Frames per second.
+     */
+    void configure(int bars, std::size_t hopFrames, unsigned int sampleRate);
+
+    /**
+     * @brief Forgets all onsets, beats and the previous spectrum, keeping the configuration.
+     */
+    void reset();
+
+    /**
+     * @brief Computes the spectral flux between two spectra.
+     * @param previous Magnitudes of the earlier hop.
+     * @param current Magnitudes of the later hop.
+     * @param bars Values per spectrum.
+     * @return Sum of the increases of log2(1 + magnitude).
+     */
+    static float spectralFlux(const float* previous, const float* current, int bars);
+
+    /**
+     * @brief Feeds the spectrum of the next hop.
+     * @param magnitudes Magnitudes of the hop, as many as configured.
+     * @param frame Playback frame the hop is heard at.
+     * @return True if a new beat was detected.
+     */
+    bool process(const float* magnitudes, sf::Uint64 frame);
+
+    /**
+     * @brief Feeds the flux of the next hop, e.g. one computed in parallel by BeatMap.
+     * @param flux Spectral flux of the hop.
+     * @param frame Playback frame the hop is heard at.
+     * @return True if a new beat was detected.
+     */
+    bool processFlux(float flux, sf::Uint64 frame);
+
+    /**
+     * @brief Retrieves the onsets and beats so far.
+     * @return Current state.
+     */
+    const State& getState() const;
+
+    /**
+     * @brief Checks whether the last beat fell on an onset or was predicted through a gap.
+     * @return True if the last beat was an onset.
+     */
+    bool lastBeatWasOnset() const;
+
+private:
+    void updateTempo(float strength);
+    bool trackBeats(bool onset, sf::Uint64 candidateFrame);
+    void addBeat(sf::Uint64 frame, bool onset);
+
+    static constexpr float THRESHOLD_SECONDS = 1.0f;    ///< Flux history of the threshold; a beat period at MIN_BPM.
+    static constexpr float THRESHOLD_DEVIATIONS = 1.5f; ///< Standard deviations above the mean an onset needs.
+    static constexpr float THRESHOLD_RATIO = 1.5f;      ///< Multiple of the mean an onset needs at least.
+    static constexpr float MIN_ONSET_SECONDS = 0.05f;   ///< Shortest gap between two onsets.
+    static constexpr float TEMPO_SECONDS = 8.0f;        ///< Time constant of the autocorrelation.
+    static constexpr float PRIOR_BPM = 120.0f;          ///< Centre of the tempo preference.
+    static constexpr float PRIOR_OCTAVES = 1.0f;        ///< Width of the tempo preference, in octaves.
+    static constexpr float DOUBLE_TEMPO_RATIO = 0.9f;   ///< Share of a lag's correlation half the lag needs to win.
+    static constexpr float BEAT_TOLERANCE = 0.2f;       ///< Distance from the prediction an onset may lock at, in periods.
+
+    int bars;                           ///< Values per spectrum.
+    double framesPerHop;                ///< Playback frames between hops.
+    double hopsPerSecond;               ///< Hop rate.
+    std::vector<float> previous;        ///< Spectrum of the last hop.
+    bool havePrevious;                  ///< False until the first spectrum.
+
+    std::vector<float> fluxHistory;     ///< Ring of recent flux values, for the threshold.
+    std::size_t fluxHead;               ///< Next slot of fluxHistory.
+    std::size_t fluxCount;              ///< Valid values in fluxHistory.
+    double fluxSum;                     ///< Sum of the valid values.
+    double fluxSquares;                 ///< Sum of their squares.
+    float fluxBefore;                   ///< Flux two hops ago.
+    float fluxLast;                     ///< Flux of the previous hop, the onset candidate.
+    float thresholdLast;                ///< Threshold of the previous hop.
+    sf::Uint64 frameLast;               ///< Frame of the previous hop.
+    sf::Uint64 minOnsetFrames;          ///< Shortest gap between onsets, in frames.
+
+    std::vector<float> strengths;       ///< Ring of onset strengths, one per hop, for the autocorrelation.
+    std::size_t strengthHead;           ///< Slot of the newest strength.
+    std::vector<float> correlation;     ///< Decaying autocorrelation per lag in hops.
+    std::vector<float> prior;           ///< Tempo preference per lag.
+    std::size_t minLag;                 ///< Shortest lag, at MAX_BPM.
+    std::size_t maxLag;                 ///< Longest lag, at MIN_BPM.
+    float decay;                        ///< Per-hop decay of the autocorrelation.
+    sf::Uint64 hops;                    ///< Hops processed since reset().
+
+    double periodFrames;                ///< Beat period in frames; 0 until the tempo is known.
+    double predictedFrame;              ///< Predicted frame of the next beat.
+    bool lastWasOnset;                  ///< True if the last beat fell on an onset.
+    int missedBeats;                    ///< Predicted beats in a row that fell on no onset.
+
+    State state;                        ///< Onsets and beats so far.
+};
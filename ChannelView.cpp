@@ -0,0 +1,62 @@
+#include "ChannelView.h"
+#include <algorithm>
+
+#include "DspKernels.h"
+
+ChannelView::ChannelView() : data(nullptr), frames(0), stride(1) { }
+
+ChannelView::ChannelView(const sf::Int16* interleaved, sf::Uint64 frames, unsigned int channels, unsigned int channel)
+    : data(interleaved + channel), frames(frames), stride(channels) { }
+
+sf::Uint64 ChannelView::size() const {
+    return frames;
+}
+
+std::size_t ChannelView::read(sf::Uint64 first, std::size_t count, sf::Int16* dst) const {
+    std::size_t available = first < frames ? static_cast<std::size_t>(std::min<sf::Uint64>(count, frames - first)) : 0;
+    const sf::Int16* src = data + first * stride;
+    for (std::size_t i = 0; i < available; i++) {
+        dst[i] = src[i * stride];
+    }
+    std::fill(dst + available, dst + count, sf::Int16(0));
+    return available;
+}
+
+DownmixView::DownmixView() : interleaved(nullptr), frames(0), channels(1) { }
+
+DownmixView::DownmixView(const sf::Int16* interleaved, sf::Uint64 frames, unsigned int channels)
+    : interleaved(interleaved), frames(frames), channels(std::max(1u, channels)) { }
+
+sf::Int16 DownmixView::operator[](sf::Uint64 frame) const {
+    const sf::Int16* src = interleaved + frame * channels;
+    int sum = 0;
+    for (unsigned int c = 0; c < channels; c++) {
+        sum += src[c];
+    }
+    return static_cast<sf::Int16>(sum / static_cast<int>(channels));
+}
+
+std::size_t DownmixView::read(sf::Uint64 first, std::size_t count, sf::Int16* dst) const {
+    std::size_t available = first < frames ? static_cast<std::size_t>(std::min<sf::Uint64>(count, frames - first)) : 0;
+    if (available > 0) {
+        dsp::downmix(interleaved + first * channels, dst, available, channels);
+    }
+    std::fill(dst + available, dst + count, sf::Int16(0));
+    return available;
+}
+
+ChannelView DownmixView::channel(unsigned int channel) const {
+    return ChannelView(interleaved, frames, channels, channel);
+}
+
+const sf::Int16* DownmixView::getInterleaved() const {
+    return interleaved;
+}
+
+sf::Uint64 DownmixView::size() const {
+    return frames;
+}
+
+unsigned int DownmixView::getChannelCount() const {
+    return channels;
+}
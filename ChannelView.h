@@ -0,0 +1,125 @@
+#pragma once
+#include <SFML/Config.hpp>
+#include <cstddef>
+
+/**
+ * @class ChannelView
+ * @brief Read-only, strided view of one channel of interleaved samples.
+ *
+ * Views never own or copy samples; they stay valid as long as the buffer they point
+ * into, typically a DecodedAudio held through a shared_ptr.
+ */
+class ChannelView {
+public:
+    /**
+     * @brief Creates an empty view.
+     */
+    ChannelView();
+
+    /**
+     * @brief Views one channel of interleaved frames.
+     * @param interleaved First sample of the buffer.
+     * @param frames Number of frames in the buffer.
+     * @param channels Samples per frame.
+     * @param channel Channel to view, below channels.
+     */
+    ChannelView(const sf::Int16* interleaved, sf::Uint64 frames, unsigned int channels, unsigned int channel);
+
+    /**
+     * @brief Retrieves the sample of one frame.
+     * @param frame Frame index, below size().
+     * @return The sample.
+     */
+    sf::Int16 operator[](sf::Uint64 frame) const {
+        return data[frame * stride];
+    }
+
+    /**
+     * @brief Retrieves the length of the view.
+     * @return Number of frames.
+     */
+    sf::Uint64 size() const;
+
+    /**
+     * @brief Copies a span into contiguous memory; frames past the end read as silence.
+     * @param first First frame.
+     * @param count Number of frames.
+     * @param dst Destination, count samples.
+     * @return Number of frames that were inside the view.
+     */
+    std::size_t read(sf::Uint64 first, std::size_t count, sf::Int16* dst) const;
+
+private:
+    const sf::Int16* data;  ///< Sample of the channel in frame 0.
+    sf::Uint64 frames;      ///< Number of frames.
+    unsigned int stride;    ///< Distance between consecutive samples of the channel.
+};
+
+/**
+ * @class DownmixView
+ * @brief Mono mix of interleaved samples, computed span by span when read.
+ *
+ * Replaces a whole-file mono copy: callers read the windows they need, and the mix of
+ * each window is computed on the fly with dsp::downmix(). Mono sources are read directly.
+ */
+class DownmixView {
+public:
+    /**
+     * @brief Creates an empty view.
+     */
+    DownmixView();
+
+    /**
+     * @brief Views the mix of interleaved frames.
+     * @param interleaved First sample of the buffer.
+     * @param frames Number of frames in the buffer.
+     * @param channels Samples per frame.
+     */
+    DownmixView(const sf::Int16* interleaved, sf::Uint64 frames, unsigned int channels);
+
+    /**
+     * @brief Mixes a single frame.
+     * @param frame Frame index, below size().
+     * @return Mean of the channels, rounded toward zero.
+     */
+    sf::Int16 operator[](sf::Uint64 frame) const;
+
+    /**
+     * @brief Mixes a span into contiguous memory; frames past the end read as silence.
+     * @param first First frame.
+     * @param count Number of frames.
+     * @param dst Destination, count samples.
+     * @return Number of frames that were inside the view.
+     */
+    std::size_t read(sf::Uint64 first, std::size_t count, sf::Int16* dst) const;
+
+    /**
+     * @brief Views a single channel of the same buffer.
+     * @param channel Channel index, below getChannelCount().
+     * @return Strided view of the channel.
+     */
+    ChannelView channel(unsigned int channel) const;
+
+    /**
+     * @brief Retrieves the interleaved source.
+     * @return First sample of the buffer.
+     */
+    const sf::Int16* getInterleaved() const;
+
+    /**
+     * @brief Retrieves the length of the view.
+     * @return Number of frames.
+     */
+    sf::Uint64 size() const;
+
+    /**
+     * @brief Retrieves the channel count of the source.
+     * @return Samples per frame.
+     */
+    unsigned int getChannelCount() const;
+
+private:
+    const sf::Int16* interleaved;   ///< Source samples.
+    sf::Uint64 frames;              ///< Number of frames.
+    unsigned int channels;          ///< Samples per frame.
+};
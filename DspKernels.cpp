@@ -0,0 +1,420 @@
+#include "DspKernels.h"
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DSP_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define DSP_TARGET_AVX2
+#else
+#define DSP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace dsp {
+
+    namespace {
+        const std::size_t DISTANCE_LANES = 16;  ///< Partial sums of squaredDistance(), in every variant.
+
+        /**
+         * @brief Adds up the lanes of squaredDistance() in order, then the values past the last full block.
+         */
+        float finishDistance(const float* lanes, const float* a, const float* b, std::size_t tail) {
+            float sum = 0.0f;
+            for (std::size_t k = 0; k < DISTANCE_LANES; k++) {
+                sum += lanes[k];
+            }
+            for (std::size_t i = 0; i < tail; i++) {
+                float d = a[i] - b[i];
+                sum += d * d;
+            }
+            return sum;
+        }
+    }
+
+    namespace scalar {
+
+        void convert(const sf::Int16* src, float* dst, std::size_t count, float factor) {
+            for (std::size_t i = 0; i < count; i++) {
+                dst[i] = static_cast<float>(src[i]) * factor;
+            }
+        }
+
+        void scale(float* data, std::size_t count, float factor) {
+            for (std::size_t i = 0; i < count; i++) {
+                data[i] *= factor;
+            }
+        }
+
+        void multiply(float* data, const float* window, std::size_t count) {
+            for (std::size_t i = 0; i < count; i++) {
+                data[i] *= window[i];
+            }
+        }
+
+        float squaredDistance(const float* a, const float* b, std::size_t count) {
+            float lanes[DISTANCE_LANES] = {};
+            std::size_t i = 0;
+            for (; i + DISTANCE_LANES <= count; i += DISTANCE_LANES) {
+                for (std::size_t k = 0; k < DISTANCE_LANES; k++) {
+                    float d = a[i + k] - b[i + k];
+                    lanes[k] += d * d;
+                }
+            }
+            return finishDistance(lanes, a + i, b + i, count - i);
+        }
+
+        void downmixStereo(const sf::Int16* interleaved, sf::Int16* mono, std::size_t frames) {
+            for (std::size_t i = 0; i < frames; i++) {
+                mono[i] = static_cast<sf::Int16>((interleaved[2 * i] + interleaved[2 * i + 1]) / 2);
+            }
+        }
+
+        void deinterleaveStereo(const sf::Int16* interleaved, sf::Int16* left, sf::Int16* right, std::size_t frames) {
+            for (std::size_t i = 0; i < frames; i++) {
+                left[i] = interleaved[2 * i];
+                right[i] = interleaved[2 * i + 1];
+            }
+        }
+    }
+
+#ifdef DSP_X86
+
+    namespace sse2 {
+
+        void convert(const sf::Int16* src, float* dst, std::size_t count, float factor) {
+            const __m128 f = _mm_set1_ps(factor);
+            std::size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+                __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), f));
+                _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), f));
+            }
+            scalar::convert(src + i, dst + i, count - i, factor);
+        }
+
+        void scale(float* data, std::size_t count, float factor) {
+            const __m128 f = _mm_set1_ps(factor);
+            std::size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), f));
+            }
+            scalar::scale(data + i, count - i, factor);
+        }
+
+        void multiply(float* data, const float* window, std::size_t count) {
+            std::size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), _mm_loadu_ps(window + i)));
+            }
+            scalar::multiply(data + i, window + i, count - i);
+        }
+
+        float squaredDistance(const float* a, const float* b, std::size_t count) {
+            // Four accumulators hide the latency of the adds; together they are the 16 lanes.
+            __m128 sum[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+            std::size_t i = 0;
+            for (; i + DISTANCE_LANES <= count; i += DISTANCE_LANES) {
+                for (int k = 0; k < 4; k++) {
+                    __m128 d = _mm_sub_ps(_mm_loadu_ps(a + i + 4 * k), _mm_loadu_ps(b + i + 4 * k));
+                    sum[k] = _mm_add_ps(sum[k], _mm_mul_ps(d, d));
+                }
+            }
+            float lanes[DISTANCE_LANES];
+            for (int k = 0; k < 4; k++) {
+                _mm_storeu_ps(lanes + 4 * k, sum[k]);
+            }
+            return finishDistance(lanes, a + i, b + i, count - i);
+        }
+
+        /**
+         * @brief (l + r) / 2 for four frames, with the sum formed in 32 bits and rounded toward zero.
+         */
+        static inline __m128i average(__m128i frames) {
+            __m128i sum = _mm_madd_epi16(frames, _mm_set1_epi16(1));
+            return _mm_srai_epi32(_mm_add_epi32(sum, _mm_srli_epi32(sum, 31)), 1);
+        }
+
+        void downmixStereo(const sf::Int16* interleaved, sf::Int16* mono, std::size_t frames) {
+            std::size_t i = 0;
+            for (; i + 8 <= frames; i += 8) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(interleaved + 2 * i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(interleaved + 2 * i + 8));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(mono + i), _mm_packs_epi32(average(a), average(b)));
+            }
+            scalar::downmixStereo(interleaved + 2 * i, mono + i, frames - i);
+        }
+
+        void deinterleaveStereo(const sf::Int16* interleaved, sf::Int16* left, sf::Int16* right, std::size_t frames) {
+            std::size_t i = 0;
+            for (; i + 8 <= frames; i += 8) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(interleaved + 2 * i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(interleaved + 2 * i + 8));
+                __m128i leftA = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+                __m128i leftB = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(left + i), _mm_packs_epi32(leftA, leftB));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(right + i), _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16)));
+            }
+            scalar::deinterleaveStereo(interleaved + 2 * i, left + i, right + i, frames - i);
+        }
+    }
+
+    namespace avx2 {
+
+        DSP_TARGET_AVX2 void convert(const sf::Int16* src, float* dst, std::size_t count, float factor) {
+            const __m256 f = _mm256_set1_ps(factor);
+            std::size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+                __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8)));
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), f));
+                _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), f));
+            }
+            sse2::convert(src + i, dst + i, count - i, factor);
+        }
+
+        DSP_TARGET_AVX2 void scale(float* data, std::size_t count, float factor) {
+            const __m256 f = _mm256_set1_ps(factor);
+            std::size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), f));
+            }
+            sse2::scale(data + i, count - i, factor);
+        }
+
+        DSP_TARGET_AVX2 void multiply(float* data, const float* window, std::size_t count) {
+            std::size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), _mm256_loadu_ps(window + i)));
+            }
+            sse2::multiply(data + i, window + i, count - i);
+        }
+
+        DSP_TARGET_AVX2 float squaredDistance(const float* a, const float* b, std::size_t count) {
+            __m256 low = _mm256_setzero_ps();
+            __m256 high = _mm256_setzero_ps();
+            std::size_t i = 0;
+            for (; i + DISTANCE_LANES <= count; i += DISTANCE_LANES) {
+                // Multiply and add stay separate, so no FMA changes the rounding against the other variants.
+                __m256 dLow = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+                __m256 dHigh = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+                low = _mm256_add_ps(low, _mm256_mul_ps(dLow, dLow));
+                high = _mm256_add_ps(high, _mm256_mul_ps(dHigh, dHigh));
+            }
+            float lanes[DISTANCE_LANES];
+            _mm256_storeu_ps(lanes, low);
+            _mm256_storeu_ps(lanes + 8, high);
+            return finishDistance(lanes, a + i, b + i, count - i);
+        }
+
+        DSP_TARGET_AVX2 static inline __m256i average(__m256i frames) {
+            __m256i sum = _mm256_madd_epi16(frames, _mm256_set1_epi16(1));
+            return _mm256_srai_epi32(_mm256_add_epi32(sum, _mm256_srli_epi32(sum, 31)), 1);
+        }
+
+        DSP_TARGET_AVX2 void downmixStereo(const sf::Int16* interleaved, sf::Int16* mono, std::size_t frames) {
+            std::size_t i = 0;
+            for (; i + 16 <= frames; i += 16) {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(interleaved + 2 * i));
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(interleaved + 2 * i + 16));
+                // packs works per 128-bit lane; the permute puts the four quarters back in order.
+                __m256i packed = _mm256_packs_epi32(average(a), average(b));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(mono + i), _mm256_permute4x64_epi64(packed, 0xD8));
+            }
+            sse2::downmixStereo(interleaved + 2 * i, mono + i, frames - i);
+        }
+
+        DSP_TARGET_AVX2 void deinterleaveStereo(const sf::Int16* interleaved, sf::Int16* left, sf::Int16* right, std::size_t frames) {
+            std::size_t i = 0;
+            for (; i + 16 <= frames; i += 16) {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(interleaved + 2 * i));
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(interleaved + 2 * i + 16));
+                __m256i leftA = _mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16);
+                __m256i leftB = _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16);
+                __m256i rightA = _mm256_srai_epi32(a, 16);
+                __m256i rightB = _mm256_srai_epi32(b, 16);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(left + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(leftA, leftB), 0xD8));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(right + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(rightA, rightB), 0xD8));
+            }
+            sse2::deinterleaveStereo(interleaved + 2 * i, left + i, right + i, frames - i);
+        }
+    }
+
+#endif
+
+    namespace {
+
+        /**
+         * @brief Entry points of one instruction set.
+         */
+        struct KernelTable {
+            const char* name;
+            void (*convert)(const sf::Int16*, float*, std::size_t, float);
+            void (*scale)(float*, std::size_t, float);
+            void (*multiply)(float*, const float*, std::size_t);
+            float (*squaredDistance)(const float*, const float*, std::size_t);
+            void (*downmixStereo)(const sf::Int16*, sf::Int16*, std::size_t);
+            void (*deinterleaveStereo)(const sf::Int16*, sf::Int16*, sf::Int16*, std::size_t);
+        };
+
+#ifdef DSP_X86
+        bool cpuHasAvx2() {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) {
+                return false;
+            }
+            __cpuid(info, 1);
+            bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+            __cpuidex(info, 7, 0);
+            return osSavesYmm && (info[1] & (1 << 5));
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+
+        bool cpuHasSse2() {
+#if defined(_M_X64) || defined(__x86_64__)
+            return true;
+#elif defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            return (info[3] & (1 << 26)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+#endif
+        }
+#endif
+
+#ifdef DSP_X86
+        const KernelTable AVX2_KERNELS = { "avx2", avx2::convert, avx2::scale, avx2::multiply, avx2::squaredDistance, avx2::downmixStereo, avx2::deinterleaveStereo };
+        const KernelTable SSE2_KERNELS = { "sse2", sse2::convert, sse2::scale, sse2::multiply, sse2::squaredDistance, sse2::downmixStereo, sse2::deinterleaveStereo };
+#endif
+        const KernelTable SCALAR_KERNELS = { "scalar", scalar::convert, scalar::scale, scalar::multiply, scalar::squaredDistance, scalar::downmixStereo, scalar::deinterleaveStereo };
+
+        KernelTable selectKernels() {
+#ifdef DSP_X86
+            if (cpuHasAvx2()) {
+                return AVX2_KERNELS;
+            }
+            if (cpuHasSse2()) {
+                return SSE2_KERNELS;
+            }
+#endif
+            return SCALAR_KERNELS;
+        }
+
+        KernelTable& kernels() {
+            static KernelTable table = selectKernels();
+            return table;
+        }
+    }
+
+    bool selectInstructionSet(const char* name) {
+        std::string wanted = name;
+#ifdef DSP_X86
+        if (wanted == "avx2" && cpuHasAvx2()) {
+            kernels() = AVX2_KERNELS;
+            return true;
+        }
+        if (wanted == "sse2" && cpuHasSse2()) {
+            kernels() = SSE2_KERNELS;
+            return true;
+        }
+#endif
+        if (wanted == "scalar") {
+            kernels() = SCALAR_KERNELS;
+            return true;
+        }
+        return false;
+    }
+
+    void convert(const sf::Int16* src, float* dst, std::size_t count, float factor) {
+        kernels().convert(src, dst, count, factor);
+    }
+
+    void scale(float* data, std::size_t count, float factor) {
+        kernels().scale(data, count, factor);
+    }
+
+    void multiply(float* data, const float* window, std::size_t count) {
+        kernels().multiply(data, window, count);
+    }
+
+    float squaredDistance(const float* a, const float* b, std::size_t count) {
+        return kernels().squaredDistance(a, b, count);
+    }
+
+    void downmixStereo(const sf::Int16* interleaved, sf::Int16* mono, std::size_t frames) {
+        kernels().downmixStereo(interleaved, mono, frames);
+    }
+
+    void deinterleaveStereo(const sf::Int16* interleaved, sf::Int16* left, sf::Int16* right, std::size_t frames) {
+        kernels().deinterleaveStereo(interleaved, left, right, frames);
+    }
+
+    void downmix(const sf::Int16* interleaved, sf::Int16* mono, std::size_t frames, unsigned int channels) {
+        if (channels == 1) {
+            if (frames) {
+                std::memcpy(mono, interleaved, frames * sizeof(sf::Int16));
+            }
+            return;
+        }
+        if (channels == 2) {
+            downmixStereo(interleaved, mono, frames);
+            return;
+        }
+        for (std::size_t i = 0; i < frames; i++) {
+            int sum = 0;
+            for (unsigned int c = 0; c < channels; c++) {
+                sum += interleaved[i * channels + c];
+            }
+            mono[i] = static_cast<sf::Int16>(sum / static_cast<int>(channels));
+        }
+    }
+
+    const char* instructionSet() {
+        return kernels().name;
+    }
+
+    namespace {
+        const int LOG2_TABLE_BITS = 8;
+
+        /**
+         * @brief log2 of 1 + i / 256 for i in [0, 256], the mantissa part of log2Approx().
+         */
+        struct Log2Table {
+            float values[(1 << LOG2_TABLE_BITS) + 1];
+
+            Log2Table() {
+                for (int i = 0; i <= (1 << LOG2_TABLE_BITS); i++) {
+                    values[i] = static_cast<float>(std::log2(1.0 + static_cast<double>(i) / (1 << LOG2_TABLE_BITS)));
+                }
+            }
+        };
+    }
+
+    float log2Approx(float x) {
+        static const Log2Table table;
+        if (!(x > 0)) {
+            return -126.0f;
+        }
+
+        // x = 2^exponent * (1 + mantissa); the top mantissa bits pick the table entry,
+        // the remaining ones interpolate to the next.
+        sf::Uint32 bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        int exponent = static_cast<int>((bits >> 23) & 0xff) - 127;
+        sf::Uint32 index = (bits >> (23 - LOG2_TABLE_BITS)) & ((1u << LOG2_TABLE_BITS) - 1);
+        float fraction = static_cast<float>(bits & ((1u << (23 - LOG2_TABLE_BITS)) - 1)) / (1u << (23 - LOG2_TABLE_BITS));
+        return exponent + table.values[index] + (table.values[index + 1] - table.values[index]) * fraction;
+    }
+}
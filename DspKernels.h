@@ -0,0 +1,118 @@
+#pragma once
+#include <SFML/Config.hpp>
+#include <cstddef>
+
+/**
+ * @namespace dsp
+ * @brief Vectorized sample-processing kernels shared by the visualizers.
+ *
+ * Every kernel has an SSE2 and an AVX2 implementation next to the scalar one in
+ * dsp::scalar. The fastest variant the CPU supports is picked once, at the first
+ * call. All variants produce bit-identical results, so the scalar functions double
+ * as references when checking the vector paths.
+ */
+namespace dsp {
+
+    /**
+     * @brief Converts samples to float and multiplies them by a factor.
+     * @param src Source samples.
+     * @param dst Destination, count values.
+     * @param count Number of samples.
+     * @param factor Factor applied after conversion, e.g. 1 / 32768.
+     */
+    void convert(const sf::Int16* src, float* dst, std::size_t count, float factor);
+
+    /**
+     * @brief Multiplies values in place by a factor.
+     * @param data Values to scale.
+     * @param count Number of values.
+     * @param factor Scale factor.
+     */
+    void scale(float* data, std::size_t count, float factor);
+
+    /**
+     * @brief Multiplies values element-wise by a window.
+     * @param data Values to window, in place.
+     * @param window Window coefficients, count values.
+     * @param count Number of values.
+     */
+    void multiply(float* data, const float* window, std::size_t count);
+
+    /**
+     * @brief Sums the squared differences of two sequences, the YIN difference function at one lag.
+     *
+     * The sum runs in 16 interleaved lanes that are added up in a fixed order at the end,
+     * which is what keeps the vector variants bit-identical to the scalar one.
+     * @param a First sequence, count values.
+     * @param b Second sequence, count values.
+     * @param count Number of values.
+     * @return Sum of (a[i] - b[i])^2.
+     */
+    float squaredDistance(const float* a, const float* b, std::size_t count);
+
+    /**
+     * @brief Averages interleaved stereo frames into mono, rounding toward zero like (l + r) / 2.
+     * @param interleaved Source samples, 2 * frames values.
+     * @param mono Destination, frames values.
+     * @param frames Number of frames.
+     */
+    void downmixStereo(const sf::Int16* interleaved, sf::Int16* mono, std::size_t frames);
+
+    /**
+     * @brief Splits interleaved stereo frames into separate channels.
+     * @param interleaved Source samples, 2 * frames values.
+     * @param left Destination for the first channel, frames values.
+     * @param right Destination for the second channel, frames values.
+     * @param frames Number of frames.
+     */
+    void deinterleaveStereo(const sf::Int16* interleaved, sf::Int16* left, sf::Int16* right, std::size_t frames);
+
+    /**
+     * @brief Averages interleaved frames of any channel count into mono.
+     *
+     * Copies mono input, uses downmixStereo() for stereo and a plain loop otherwise.
+     * Not part of the SIMD dispatch itself.
+     * @param interleaved Source samples, channels * frames values.
+     * @param mono Destination, frames values.
+     * @param frames Number of frames.
+     * @param channels Samples per frame.
+     */
+    void downmix(const sf::Int16* interleaved, sf::Int16* mono, std::size_t frames, unsigned int channels);
+
+    /**
+     * @brief Base-2 logarithm from a 256-entry mantissa table with linear interpolation.
+     *
+     * Accurate to about 1e-5, with no call into the C library; meant for display scaling,
+     * not for analysis. Not part of the SIMD dispatch.
+     * @param x Positive value.
+     * @return log2(x); values that are not positive give -126.
+     */
+    float log2Approx(float x);
+
+    /**
+     * @brief Retrieves the instruction set the kernels dispatch to.
+     * @return "avx2", "sse2" or "scalar".
+     */
+    const char* instructionSet();
+
+    /**
+     * @brief Switches the kernels to another instruction set, so tests can check every path on one machine.
+     * Not safe while other threads run kernels.
+     * @param name "avx2", "sse2" or "scalar".
+     * @return False if the name is unknown or the CPU lacks the instruction set; the kernels are unchanged then.
+     */
+    bool selectInstructionSet(const char* name);
+
+    /**
+     * @namespace dsp::scalar
+     * @brief Plain C++ reference implementations of the kernels.
+     */
+    namespace scalar {
+        void convert(const sf::Int16* src, float* dst, std::size_t count, float factor);
+        void scale(float* data, std::size_t count, float factor);
+        void multiply(float* data, const float* window, std::size_t count);
+        float squaredDistance(const float* a, const float* b, std::size_t count);
+        void downmixStereo(const sf::Int16* interleaved, sf::Int16* mono, std::size_t frames);
+        void deinterleaveStereo(const sf::Int16* interleaved, sf::Int16* left, sf::Int16* right, std::size_t frames);
+    }
+}
@@ -0,0 +1,98 @@
+#include "FftPlanCache.h"
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+
+#include "UserCache.h"
+
+std::map<std::pair<int, FftPlanCache::Direction>, fftwf_plan> FftPlanCache::plans;
+bool FftPlanCache::wisdomChanged = false;
+long long FftPlanCache::planningTime = 0;
+
+std::mutex& FftPlanCache::plannerMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+fftwf_plan FftPlanCache::acquire(int size, Direction direction) {
+    std::lock_guard<std::mutex> lock(plannerMutex());
+
+    std::pair<int, Direction> key(size, direction);
+    std::map<std::pair<int, Direction>, fftwf_plan>::iterator found = plans.find(key);
+    if (found != plans.end()) {
+        return found->second;
+    }
+
+    // Planning with FFTW_MEASURE overwrites the arrays, so it runs on scratch buffers.
+    // fftwf_malloc alignment lets the plan run later on any other fftwf_malloc'ed buffers.
+    float* real = static_cast<float*>(fftwf_malloc(sizeof(float) * size));
+    fftwf_complex* complex = static_cast<fftwf_complex*>(fftwf_malloc(sizeof(fftwf_complex) * (size / 2 + 1)));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Try the wisdom first, so we can tell whether measuring was needed at all.
+    unsigned int flags = FFTW_MEASURE | FFTW_WISDOM_ONLY;
+    fftwf_plan plan = direction == RealToComplex ? fftwf_plan_dft_r2c_1d(size, real, complex, flags)
+        : fftwf_plan_dft_c2r_1d(size, complex, real, flags);
+    if (!plan) {
+        plan = direction == RealToComplex ? fftwf_plan_dft_r2c_1d(size, real, complex, FFTW_MEASURE)
+            : fftwf_plan_dft_c2r_1d(size, complex, real, FFTW_MEASURE);
+        wisdomChanged = true;
+    }
+
+    planningTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    fftwf_free(complex);
+    fftwf_free(real);
+
+    if (!plan) {
+        throw std::runtime_error("Failed to create FFT plan!");
+    }
+    plans[key] = plan;
+    return plan;
+}
+
+std::string FftPlanCache::wisdomPath() {
+    std::string directory = userCacheDirectory();
+    return directory.empty() ? std::string() : directory + "/fftwf.wisdom";
+}
+
+bool FftPlanCache::loadWisdom() {
+    std::string path = wisdomPath();
+    if (path.empty()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(plannerMutex());
+    return fftwf_import_wisdom_from_filename(path.c_str()) != 0;
+}
+
+bool FftPlanCache::saveWisdom() {
+    std::string path = wisdomPath();
+    std::lock_guard<std::mutex> lock(plannerMutex());
+    if (!wisdomChanged) {
+        return true;
+    }
+    if (path.empty()) {
+        return false;
+    }
+
+    // Write next to the target and rename, so a crash never leaves half a wisdom file;
+    // the name is unique, so processes saving at the same time never share it.
+    std::string temporary = temporaryPath(path);
+    std::error_code error;
+    if (!fftwf_export_wisdom_to_filename(temporary.c_str())) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    wisdomChanged = false;
+    return true;
+}
+
+long long FftPlanCache::getPlanningTime() {
+    std::lock_guard<std::mutex> lock(plannerMutex());
+    return planningTime;
+}
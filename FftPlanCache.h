@@ -0,0 +1,73 @@
+#pragma once
+#include <fftw3.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+/**
+ * @class FftPlanCache
+ * @brief Process-wide cache of single-precision FFTW plans, backed by wisdom on disk.
+ *
+ * Plans are keyed by size and direction and live until the process exits, so reopening a
+ * visualizer or going back to an earlier FFT size does not plan again. Plans are made for
+ * fftwf_malloc'ed scratch buffers and must be run with the new-array execute functions
+ * (fftwf_execute_dft_r2c/c2r) on buffers from fftwf_malloc; run that way, one plan can be
+ * shared by any number of threads at once.
+ *
+ * Wisdom in the user cache directory lets even the first plan of a size skip measurement.
+ */
+class FftPlanCache {
+public:
+    static constexpr int MIN_SIZE = 64;     ///< Smallest transform the analyzers use.
+    static constexpr int MAX_SIZE = 16384;  ///< Largest transform the analyzers use.
+
+    /**
+     * @brief Transform direction.
+     */
+    enum Direction {
+        RealToComplex,  ///< Forward transform of real input, fftwf_execute_dft_r2c.
+        ComplexToReal   ///< Inverse transform to real output, fftwf_execute_dft_c2r.
+    };
+
+    /**
+     * @brief Returns the plan for a transform, measuring it only the first time.
+     * @param size Number of real samples.
+     * @param direction Transform direction.
+     * @return Plan owned by the cache; never destroy it.
+     * @throws std::runtime_error If FFTW cannot create the plan.
+     */
+    static fftwf_plan acquire(int size, Direction direction);
+
+    /**
+     * @brief Imports wisdom from the user cache directory. Call once at startup; missing
+     * or stale wisdom is ignored.
+     * @return True if wisdom was imported.
+     */
+    static bool loadWisdom();
+
+    /**
+     * @brief Exports wisdom to the user cache directory if any plan was measured since it
+     * was loaded. Call at shutdown.
+     * @return False if the file could not be written.
+     */
+    static bool saveWisdom();
+
+    /**
+     * @brief Retrieves the total time spent creating plans, for diagnostics.
+     * @return Planning time in microseconds.
+     */
+    static long long getPlanningTime();
+
+    /**
+     * @brief Retrieves the path of the wisdom file.
+     * @return Path, or an empty string if there is no user cache directory.
+     */
+    static std::string wisdomPath();
+
+private:
+    static std::mutex& plannerMutex();  ///< Serializes the FFTW planner, which is not thread-safe.
+    static std::map<std::pair<int, Direction>, fftwf_plan> plans; ///< Every plan created so far.
+    static bool wisdomChanged;          ///< A plan was measured since the wisdom was loaded.
+    static long long planningTime;      ///< Microseconds spent in the planner.
+};
@@ -0,0 +1,417 @@
+#include "FileBrowser.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+#include "FrameProfiler.h"
+#include "WavFile.h"
+
+namespace {
+    const std::size_t NAME_CHARS = 64; ///< Longer names are shortened so they do not run into the header column.
+
+    bool isWav(const std::filesystem::path& path) {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension == ".wav";
+    }
+
+    bool lessIgnoringCase(const std::string& a, const std::string& b) {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](unsigned char x, unsigned char y) {
+            return std::tolower(x) < std::tolower(y);
+        });
+    }
+
+    /**
+     * @brief Makes a path absolute and drops a trailing separator, so parent_path() goes up one level.
+     */
+    std::filesystem::path normalize(const std::string& directory) {
+        std::error_code error;
+        std::filesystem::path path = std::filesystem::absolute(directory, error);
+        if (error) {
+            path = directory;
+        }
+        path = path.lexically_normal();
+        if (!path.has_filename() && path != path.root_path()) {
+            path = path.parent_path();
+        }
+        return path;
+    }
+}
+
+FileBrowser::FileBrowser() {
+    headerReader = std::thread(&FileBrowser::readHeaders, this);
+}
+
+FileBrowser::~FileBrowser() {
+    stopListing();
+    {
+        std::lock_guard<std::mutex> lock(headerMutex);
+        stopping = true;
+    }
+    headerWake.notify_all();
+    headerReader.join();
+}
+
+void FileBrowser::setLayout(const sf::Font& font, const sf::FloatRect& area) {
+    this->area = area;
+
+    background.setPosition(area.left, area.top);
+    background.setSize(sf::Vector2f(area.width, area.height));
+    background.setFillColor(sf::Color::Black);
+    background.setOutlineThickness(2);
+    background.setOutlineColor(sf::Color::Green);
+
+    highlight.setSize(sf::Vector2f(area.width, ROW_HEIGHT));
+    highlight.setFillColor(sf::Color(0, 80, 0));
+
+    title.setFont(font);
+    title.setCharacterSize(18);
+    title.setFillColor(sf::Color::Green);
+    title.setPosition(area.left + 8, area.top + 4);
+
+    nameTexts.assign(getVisibleRows(), sf::Text("", font, 18));
+    infoTexts.assign(getVisibleRows(), sf::Text("", font, 18));
+    for (std::size_t i = 0; i < nameTexts.size(); i++) {
+        nameTexts[i].setFillColor(sf::Color::Green);
+        infoTexts[i].setFillColor(sf::Color::Green);
+    }
+}
+
+void FileBrowser::open(const std::string& path) {
+    stopListing();
+
+    directory = normalize(path).string();
+    entries.clear();
+    order.clear();
+    selected = 0;
+    scroll = 0;
+    queuedScroll = static_cast<std::size_t>(-1);
+
+    // ".." stays the first row whatever the sort order.
+    Entry parent;
+    parent.name = "..";
+    parent.directory = true;
+    entries.push_back(parent);
+    order.push_back(0);
+
+    {
+        std::lock_guard<std::mutex> lock(headerMutex);
+        generation++;
+        headerRequests.clear();
+        headerResults.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(listMutex);
+        arrived.clear();
+        sortedOrder.clear();
+        listed = false;
+    }
+    cancelListing = false;
+    listing = std::async(std::launch::async, &FileBrowser::list, this, directory);
+}
+
+const std::string& FileBrowser::getDirectory() const {
+    return directory;
+}
+
+const std::string& FileBrowser::getChosenFile() const {
+    return chosenFile;
+}
+
+/**
+ * @brief Body of the listing thread: hands over directories and WAV files in batches, then sorts them.
+ */
+void FileBrowser::list(std::string path) {
+    FrameProfiler::setThreadName("browser");
+    std::vector<Entry> listedEntries;
+    std::size_t handedOver = 0;
+
+    std::error_code error;
+    std::filesystem::directory_iterator it(path, std::filesystem::directory_options::skip_permission_denied, error);
+    for (; !error && it != std::filesystem::directory_iterator() && !cancelListing; it.increment(error)) {
+        // The type usually comes with the directory entry itself; no stat per file.
+        std::error_code typeError;
+        bool isDirectory = it->is_directory(typeError);
+        if (typeError || (!isDirectory && !isWav(it->path()))) {
+            continue;
+        }
+        Entry entry;
+        entry.name = it->path().filename().string();
+        entry.directory = isDirectory;
+        listedEntries.push_back(entry);
+
+        if (listedEntries.size() - handedOver == LIST_BATCH) {
+            std::lock_guard<std::mutex> lock(listMutex);
+            arrived.insert(arrived.end(), listedEntries.begin() + handedOver, listedEntries.end());
+            handedOver = listedEntries.size();
+        }
+    }
+    if (cancelListing) {
+        return;
+    }
+
+    // Directories first, then files, each by name regardless of case. Entry 0 is "..".
+    std::vector<std::size_t> sorted(listedEntries.size());
+    for (std::size_t i = 0; i < sorted.size(); i++) {
+        sorted[i] = i;
+    }
+    std::sort(sorted.begin(), sorted.end(), [&listedEntries](std::size_t a, std::size_t b) {
+        if (listedEntries[a].directory != listedEntries[b].directory) {
+            return listedEntries[a].directory;
+        }
+        return lessIgnoringCase(listedEntries[a].name, listedEntries[b].name);
+    });
+
+    std::lock_guard<std::mutex> lock(listMutex);
+    arrived.insert(arrived.end(), listedEntries.begin() + handedOver, listedEntries.end());
+    sortedOrder.assign(1, 0);
+    for (std::size_t index : sorted) {
+        sortedOrder.push_back(index + 1);
+    }
+    listed = true;
+}
+
+/**
+ * @brief Body of the header reader: reads the most recently requested header until stopped.
+ */
+void FileBrowser::readHeaders() {
+    FrameProfiler::setThreadName("headers");
+    std::unique_lock<std::mutex> lock(headerMutex);
+    while (true) {
+        headerWake.wait(lock, [this] { return stopping || !headerRequests.empty(); });
+        if (stopping) {
+            return;
+        }
+        HeaderJob job = std::move(headerRequests.back());
+        headerRequests.pop_back();
+        lock.unlock();
+
+        WavFile wav;
+        if (wav.open(job.path)) {
+            job.result.header = Entry::Read;
+            job.result.sampleRate = wav.getSampleRate();
+            job.result.channels = wav.getChannelCount();
+            job.result.seconds = static_cast<float>(wav.getFrameCount()) / wav.getSampleRate();
+        }
+        else {
+            job.result.header = Entry::Unreadable;
+        }
+
+        lock.lock();
+        headerResults.push_back(std::move(job));
+    }
+}
+
+void FileBrowser::stopListing() {
+    cancelListing = true;
+    if (listing.valid()) {
+        listing.wait();
+    }
+}
+
+void FileBrowser::update() {
+    bool complete;
+    {
+        std::lock_guard<std::mutex> lock(listMutex);
+        for (Entry& entry : arrived) {
+            order.push_back(entries.size());
+            entries.push_back(std::move(entry));
+        }
+        arrived.clear();
+
+        complete = listed;
+        if (!sortedOrder.empty()) {
+            // Keep the selected entry selected across the sort.
+            std::size_t current = order[selected];
+            order.swap(sortedOrder);
+            sortedOrder.clear();
+            selected = std::find(order.begin(), order.end(), current) - order.begin();
+            select(selected);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(headerMutex);
+        for (const HeaderJob& job : headerResults) {
+            if (job.generation == generation) {
+                Entry& entry = entries[job.index];
+                entry.header = job.result.header;
+                entry.seconds = job.result.seconds;
+                entry.sampleRate = job.result.sampleRate;
+                entry.channels = job.result.channels;
+            }
+        }
+        headerResults.clear();
+    }
+    queueVisibleHeaders();
+
+    title.setString(directory + "    " + std::to_string(order.size() - 1) + (complete ? " entries" : " entries, listing..."));
+}
+
+/**
+ * @brief Queues header reads for the visible rows that have none; rows that scrolled away are dequeued.
+ */
+void FileBrowser::queueVisibleHeaders() {
+    std::size_t end = std::min(order.size(), scroll + getVisibleRows());
+    bool queued = false;
+
+    std::lock_guard<std::mutex> lock(headerMutex);
+    if (scroll != queuedScroll) {
+        for (const HeaderJob& job : headerRequests) {
+            entries[job.index].header = Entry::Unread;
+        }
+        headerRequests.clear();
+        queuedScroll = scroll;
+    }
+    // The reader serves the most recent request first; queue bottom up so the top rows fill in first.
+    for (std::size_t row = end; row-- > scroll;) {
+        Entry& entry = entries[order[row]];
+        if (entry.directory || entry.header != Entry::Unread) {
+            continue;
+        }
+        entry.header = Entry::Queued;
+        headerRequests.push_back(HeaderJob{ generation, order[row], (std::filesystem::path(directory) / entry.name).string(), Entry() });
+        queued = true;
+    }
+    if (queued) {
+        headerWake.notify_one();
+    }
+}
+
+bool FileBrowser::handleEvent(const sf::Event& event) {
+    std::size_t rows = getVisibleRows();
+    if (event.type == sf::Event::MouseWheelScrolled) {
+        if (!area.contains(static_cast<float>(event.mouseWheelScroll.x), static_cast<float>(event.mouseWheelScroll.y))) {
+            return false;
+        }
+        long last = static_cast<long>(order.size() > rows ? order.size() - rows : 0);
+        long next = static_cast<long>(scroll) - static_cast<long>(event.mouseWheelScroll.delta * 3);
+        scroll = static_cast<std::size_t>(std::max(0L, std::min(next, last)));
+    }
+    else if (event.type == sf::Event::KeyPressed) {
+        switch (event.key.code) {
+        case sf::Keyboard::Up:
+            select(selected > 0 ? selected - 1 : 0);
+            break;
+        case sf::Keyboard::Down:
+            select(selected + 1);
+            break;
+        case sf::Keyboard::PageUp:
+            select(selected - std::min(selected, rows));
+            break;
+        case sf::Keyboard::PageDown:
+            select(selected + rows);
+            break;
+        case sf::Keyboard::Home:
+            select(0);
+            break;
+        case sf::Keyboard::End:
+            select(order.size());
+            break;
+        case sf::Keyboard::Enter:
+            return activate(selected);
+        case sf::Keyboard::BackSpace:
+            return activate(0);
+        default:
+            break;
+        }
+    }
+    else if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left) {
+        float y = event.mouseButton.y - area.top - TITLE_HEIGHT;
+        if (!area.contains(static_cast<float>(event.mouseButton.x), static_cast<float>(event.mouseButton.y)) || y < 0) {
+            return false;
+        }
+        std::size_t row = scroll + static_cast<std::size_t>(y / ROW_HEIGHT);
+        if (row >= order.size()) {
+            return false;
+        }
+        bool doubleClick = row == lastClickRow && clickClock.getElapsedTime().asSeconds() < DOUBLE_CLICK_SECONDS;
+        clickClock.restart();
+        lastClickRow = row;
+        select(row);
+        if (doubleClick) {
+            return activate(row);
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Enters a directory, or chooses a file.
+ * @return True if a file was chosen.
+ */
+bool FileBrowser::activate(std::size_t row) {
+    const Entry& entry = entries[order[row]];
+    if (!entry.directory) {
+        chosenFile = (std::filesystem::path(directory) / entry.name).string();
+        return true;
+    }
+    std::filesystem::path target = entry.name == ".." ? std::filesystem::path(directory).parent_path() : std::filesystem::path(directory) / entry.name;
+    open(target.string());
+    return false;
+}
+
+/**
+ * @brief Selects a row, clamped to the listing, and scrolls it into view.
+ */
+void FileBrowser::select(std::size_t row) {
+    std::size_t rows = std::max<std::size_t>(1, getVisibleRows());
+    selected = std::min(row, order.size() - 1);
+    if (selected < scroll) {
+        scroll = selected;
+    }
+    else if (selected >= scroll + rows) {
+        scroll = selected - rows + 1;
+    }
+}
+
+std::size_t FileBrowser::getVisibleRows() const {
+    return area.height > TITLE_HEIGHT ? static_cast<std::size_t>((area.height - TITLE_HEIGHT) / ROW_HEIGHT) : 0;
+}
+
+/**
+ * @brief Formats the header column of a row: duration, rate and channels.
+ */
+std::string FileBrowser::describe(const Entry& entry) const {
+    if (entry.directory) {
+        return "";
+    }
+    if (entry.header == Entry::Unreadable) {
+        return "unsupported";
+    }
+    if (entry.header != Entry::Read) {
+        return "...";
+    }
+    unsigned long seconds = static_cast<unsigned long>(entry.seconds);
+    char text[64];
+    if (seconds >= 3600) {
+        std::snprintf(text, sizeof(text), "%lu:%02lu:%02lu  %u Hz  %u ch", seconds / 3600, seconds / 60 % 60, seconds % 60, entry.sampleRate, entry.channels);
+    }
+    else {
+        std::snprintf(text, sizeof(text), "%lu:%02lu  %u Hz  %u ch", seconds / 60, seconds % 60, entry.sampleRate, entry.channels);
+    }
+    return text;
+}
+
+void FileBrowser::draw(sf::RenderTarget& target) {
+    target.draw(background);
+    target.draw(title);
+
+    for (std::size_t i = 0; i < nameTexts.size() && scroll + i < order.size(); i++) {
+        const Entry& entry = entries[order[scroll + i]];
+        float y = area.top + TITLE_HEIGHT + i * ROW_HEIGHT;
+        if (scroll + i == selected) {
+            highlight.setPosition(area.left, y);
+            target.draw(highlight);
+        }
+
+        std::string name = entry.name.size() > NAME_CHARS ? entry.name.substr(0, NAME_CHARS - 3) + "..." : entry.name;
+        nameTexts[i].setString(entry.directory ? name + "/" : name);
+        nameTexts[i].setPosition(area.left + 8, y + 1);
+        infoTexts[i].setString(describe(entry));
+        infoTexts[i].setPosition(area.left + area.width - 280, y + 1);
+        target.draw(nameTexts[i]);
+        target.draw(infoTexts[i]);
+    }
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class FileBrowser
+ * @brief In-window browser for directories and WAV files that never blocks the render thread.
+ *
+ * A directory is listed on a background thread and its entries are handed over in
+ * batches, so the first rows show up at once and large directories fill in while the
+ * user scrolls. Once the listing ends, the entries are sorted on the same thread.
+ *
+ * Duration, rate and channel count come from the WAV header. They are read lazily on a
+ * second thread, and only for the rows that are on screen. Rows that scroll away before
+ * their turn are dropped from the queue, so a directory of tens of thousands of
+ * recordings costs one header read per row actually seen.
+ *
+ * All member functions are called from the render thread; the two threads are internal.
+ */
+class FileBrowser {
+public:
+    /**
+     * @brief Starts the header reader; nothing is listed until open().
+     */
+    FileBrowser();
+
+    /**
+     * @brief Stops the listing and the header reader.
+     */
+    ~FileBrowser();
+
+    FileBrowser(const FileBrowser&) = delete;
+    FileBrowser& operator=(const FileBrowser&) = delete;
+
+    /**
+     * @brief Sets where the browser is drawn and the font of its rows.
+     * @param font Font for the rows; must outlive the browser.
+     * @param area Area of the window covered by the browser.
+     */
+    void setLayout(const sf::Font& font, const sf::FloatRect& area);
+
+    /**
+     * @brief Starts listing a directory, replacing the current one. Returns at once.
+     * @param directory Path of the directory.
+     */
+    void open(const std::string& directory);
+
+    /**
+     * @brief Retrieves the directory being shown.
+     * @return Path passed to open(), or entered since.
+     */
+    const std::string& getDirectory() const;
+
+    /**
+     * @brief Takes over listed entries and read headers, and queues header reads for the visible rows.
+     * Call once per frame.
+     */
+    void update();
+
+    /**
+     * @brief Scrolls, selects and opens entries with the mouse and keyboard.
+     * Up and Down move the selection, Enter or a double click opens it, Backspace goes up a directory.
+     * @param event Event polled from the window.
+     * @return True if a file was chosen; see getChosenFile().
+     */
+    bool handleEvent(const sf::Event& event);
+
+    /**
+     * @brief Retrieves the file chosen by the last handleEvent() that returned true.
+     * @return Full path of the file.
+     */
+    const std::string& getChosenFile() const;
+
+    /**
+     * @brief Draws the visible rows.
+     * @param target Window to draw into.
+     */
+    void draw(sf::RenderTarget& target);
+
+private:
+    /**
+     * @brief A directory or WAV file in the listing.
+     */
+    struct Entry {
+        enum Header {
+            Unread,     ///< Not read yet.
+            Queued,     ///< Waiting for the header reader.
+            Read,       ///< seconds, sampleRate and channels are valid.
+            Unreadable  ///< Not a supported WAV file.
+        };
+
+        std::string name;               ///< File name within the directory.
+        bool directory = false;         ///< True for directories, including "..".
+        Header header = Unread;         ///< State of the header fields.
+        float seconds = 0.0f;           ///< Duration.
+        unsigned int sampleRate = 0;    ///< Frames per second.
+        unsigned int channels = 0;      ///< Samples per frame.
+    };
+
+    /**
+     * @brief Header read for an entry, or a request for one.
+     */
+    struct HeaderJob {
+        unsigned int generation;        ///< Directory the entry belongs to.
+        std::size_t index;              ///< Index of the entry in entries.
+        std::string path;               ///< Full path of the file.
+        Entry result;                   ///< Header fields, once read.
+    };
+
+    void list(std::string path);
+    void readHeaders();
+    void stopListing();
+    void queueVisibleHeaders();
+    bool activate(std::size_t row);
+    void select(std::size_t row);
+    std::size_t getVisibleRows() const;
+    std::string describe(const Entry& entry) const;
+
+    std::string directory;                  ///< Directory being shown.
+    std::string chosenFile;                 ///< File chosen by the last handleEvent().
+    std::vector<Entry> entries;             ///< Entries in the order they were listed.
+    std::vector<std::size_t> order;         ///< Indices into entries, in display order.
+    std::size_t selected = 0;               ///< Selected row.
+    std::size_t scroll = 0;                 ///< First visible row.
+    std::size_t queuedScroll = static_cast<std::size_t>(-1); ///< scroll when headers were last queued.
+    std::size_t lastClickRow = 0;           ///< Row of the last click, to detect double clicks.
+    sf::Clock clickClock;                   ///< Time since the last click.
+
+    std::mutex listMutex;                   ///< Guards arrived, sortedOrder and listed.
+    std::vector<Entry> arrived;             ///< Entries listed since the last update().
+    std::vector<std::size_t> sortedOrder;   ///< Display order computed by the listing thread at the end.
+    bool listed = false;                    ///< True once the listing thread has ended.
+    std::atomic<bool> cancelListing{ false }; ///< Asks the listing thread to stop.
+    std::future<void> listing;              ///< Listing thread of the current directory.
+
+    std::mutex headerMutex;                 ///< Guards the header queues, generation and stopping.
+    std::condition_variable headerWake;     ///< Signalled when a header is queued or on shutdown.
+    std::vector<HeaderJob> headerRequests;  ///< Headers to read; the most recent request is served first.
+    std::vector<HeaderJob> headerResults;   ///< Headers read since the last update().
+    unsigned int generation = 0;            ///< Incremented by open(); older jobs are dropped.
+    bool stopping = false;                  ///< Stops the header reader.
+    std::thread headerReader;               ///< Reads WAV headers of visible rows.
+
+    sf::FloatRect area;                     ///< Area covered by the browser.
+    sf::RectangleShape background;          ///< Frame around the browser.
+    sf::RectangleShape highlight;           ///< Marks the selected row.
+    sf::Text title;                         ///< Directory and listing status.
+    std::vector<sf::Text> nameTexts;        ///< One name per visible row, reused every frame.
+    std::vector<sf::Text> infoTexts;        ///< One header summary per visible row, reused every frame.
+
+    static constexpr std::size_t LIST_BATCH = 256;      ///< Entries handed over at a time by the listing thread.
+    static constexpr float ROW_HEIGHT = 24.0f;          ///< Height of a row in pixels.
+    static constexpr float TITLE_HEIGHT = 32.0f;        ///< Height of the title line in pixels.
+    static constexpr float DOUBLE_CLICK_SECONDS = 0.4f; ///< Longest gap between the clicks of a double click.
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include <array>
+#include <cmath>
+
+#include "SpectrumAnalyzer.h"
+
+namespace spectrum {
+
+    /**
+     * @brief Sine and cosine of a small angle by their Taylor series, usable in constant expressions.
+     * @param x Angle in radians, |x| <= pi / 32.
+     * @param sine Receives sin(x).
+     * @param cosine Receives cos(x).
+     */
+    constexpr void smallAngle(double x, double& sine, double& cosine) {
+        double term = x;
+        sine = 0;
+        for (int n = 1; n < 20; n += 2) {
+            sine += term;
+            term *= -x * x / ((n + 1) * (n + 2));
+        }
+        term = 1;
+        cosine = 0;
+        for (int n = 0; n < 20; n += 2) {
+            cosine += term;
+            term *= -x * x / ((n + 1) * (n + 2));
+        }
+    }
+
+    /**
+     * @brief Hann window scaled by 2 to unit coherent gain, computed at compile time.
+     *
+     * cos(2 pi i / N) comes from rotating by 2 pi / N once per sample, which keeps the
+     * constant evaluation linear in N; the drift stays far below float precision.
+     */
+    template <int N>
+    constexpr std::array<float, N> hannWindow() {
+        const double pi = 3.14159265358979323846;
+        double stepSine = 0, stepCosine = 0;
+        smallAngle(2.0 * pi / N, stepSine, stepCosine);
+
+        std::array<float, N> window{};
+        double sine = 0, cosine = 1;
+        for (int i = 0; i < N; i++) {
+            window[i] = static_cast<float>(1.0 - cosine);
+            double nextCosine = cosine * stepCosine - sine * stepSine;
+            sine = sine * stepCosine + cosine * stepSine;
+            cosine = nextCosine;
+        }
+        return window;
+    }
+
+    /**
+     * @brief First bin of every bar plus the end of the last one, computed at compile time.
+     */
+    template <int N, int Bars>
+    constexpr std::array<int, Bars + 1> barEdges() {
+        std::array<int, Bars + 1> edges{};
+        for (int bar = 0; bar <= Bars; bar++) {
+            edges[bar] = SpectrumAnalyzer::barEdge(bar, N / 2 + 1, Bars);
+        }
+        return edges;
+    }
+
+    /**
+     * @brief 1 / (bins in the bar) for every bar, computed at compile time.
+     */
+    template <int N, int Bars>
+    constexpr std::array<float, Bars> barScales() {
+        std::array<float, Bars> scales{};
+        for (int bar = 0; bar < Bars; bar++) {
+            scales[bar] = 1.0f / (SpectrumAnalyzer::barEdge(bar + 1, N / 2 + 1, Bars) - SpectrumAnalyzer::barEdge(bar, N / 2 + 1, Bars));
+        }
+        return scales;
+    }
+}
+
+/**
+ * @class FixedSpectrumAnalyzer
+ * @brief SpectrumAnalyzer for one FFT size and bar count, fixed at compile time.
+ *
+ * The window and the bin-to-bar tables are constant expressions and every loop has a
+ * constant trip count, so the compiler can unroll and vectorize the whole reduction.
+ * SpectrumAnalyzer::create() picks the instantiations listed in SpectrumAnalyzer.cpp.
+ */
+template <int FftSize, int Bars>
+class FixedSpectrumAnalyzer : public SpectrumAnalyzer {
+    static_assert(FftSize >= MIN_FFT_SIZE && FftSize <= MAX_FFT_SIZE && (FftSize & (FftSize - 1)) == 0, "FFT size must be a supported power of two");
+    static_assert(Bars >= 1 && Bars <= FftSize / 2 + 1, "Every bar needs at least one bin");
+
+public:
+    static constexpr int BINS = FftSize / 2 + 1;  ///< Bins of the real FFT.
+
+    FixedSpectrumAnalyzer() : SpectrumAnalyzer(FftSize, Bars) { }
+
+    void analyze(const sf::Int16* samples, float* magnitudes) override {
+        transform(samples, window.data());
+
+        float binMagnitudes[BINS];
+        for (int k = 0; k < BINS; k++) {
+            binMagnitudes[k] = std::sqrt(out[k][0] * out[k][0] + out[k][1] * out[k][1]);
+        }
+        for (int bar = 0; bar < Bars; bar++) {
+            float sum = 0;
+            for (int k = edges[bar]; k < edges[bar + 1]; k++) {
+                sum += binMagnitudes[k];
+            }
+            magnitudes[bar] = sum * scales[bar];
+        }
+    }
+
+private:
+    static constexpr std::array<float, FftSize> window = spectrum::hannWindow<FftSize>(); ///< Hann window, unit coherent gain.
+    static constexpr std::array<int, Bars + 1> edges = spectrum::barEdges<FftSize, Bars>(); ///< First bin of each bar.
+    static constexpr std::array<float, Bars> scales = spectrum::barScales<FftSize, Bars>(); ///< Reciprocal bin count of each bar.
+};
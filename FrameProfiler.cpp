@@ -0,0 +1,214 @@
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <fstream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+std::mutex FrameProfiler::registryMutex;
+std::vector<std::unique_ptr<FrameProfiler::ThreadHistograms>> FrameProfiler::registry;
+std::atomic<bool> FrameProfiler::enabled(true);
+thread_local FrameProfiler::Registration FrameProfiler::registration;
+
+FrameProfiler::Registration::~Registration() {
+    if (histograms) {
+        histograms->owned.store(false, std::memory_order_release);
+    }
+}
+
+/**
+ * @brief Hands out the unowned histograms with the given name, or new ones.
+ * @param name Thread name.
+ * @return Histograms now owned by the calling thread.
+ */
+FrameProfiler::ThreadHistograms* FrameProfiler::claim(const std::string& name) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (std::unique_ptr<ThreadHistograms>& entry : registry) {
+        if (entry->name == name && !entry->owned.load(std::memory_order_acquire)) {
+            entry->owned = true;
+            return entry.get();
+        }
+    }
+
+    std::unique_ptr<ThreadHistograms> entry(new ThreadHistograms());
+    entry->name = name;
+    entry->owned = true;
+    for (Histogram& histogram : entry->stages) {
+        for (std::atomic<sf::Uint32>& bucket : histogram.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        histogram.count.store(0, std::memory_order_relaxed);
+        histogram.sum.store(0, std::memory_order_relaxed);
+        histogram.max.store(0, std::memory_order_relaxed);
+    }
+    registry.push_back(std::move(entry));
+    return registry.back().get();
+}
+
+void FrameProfiler::setThreadName(const std::string& name) {
+    if (registration.histograms) {
+        if (registration.histograms->name == name) {
+            return;
+        }
+        registration.histograms->owned.store(false, std::memory_order_release);
+    }
+    registration.histograms = claim(name);
+}
+
+void FrameProfiler::setEnabled(bool enable) {
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool FrameProfiler::isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Maps a duration onto a bucket: exact below 4 ns, then four buckets per power of two.
+ * @param nanoseconds Duration.
+ * @return Bucket index.
+ */
+int FrameProfiler::bucketOf(sf::Uint64 nanoseconds) {
+    if (nanoseconds < 4) {
+        return static_cast<int>(nanoseconds);
+    }
+#ifdef _MSC_VER
+    unsigned long msb;
+    _BitScanReverse64(&msb, nanoseconds);
+#else
+    int msb = 63 - __builtin_clzll(nanoseconds);
+#endif
+    int sub = static_cast<int>((nanoseconds >> (msb - 2)) & 3);
+    return std::min(4 * (static_cast<int>(msb) - 1) + sub, BUCKETS - 1);
+}
+
+/**
+ * @brief Returns the midpoint of a bucket in nanoseconds.
+ * @param bucket Bucket index.
+ * @return Representative duration of the bucket.
+ */
+double FrameProfiler::bucketValue(int bucket) {
+    if (bucket < 4) {
+        return bucket;
+    }
+    int msb = bucket / 4 + 1;
+    double lower = static_cast<double>(4 + bucket % 4) * static_cast<double>(1ull << (msb - 2));
+    double width = static_cast<double>(1ull << (msb - 2));
+    return lower + width / 2;
+}
+
+/**
+ * @brief Finds the bucket holding the given fraction of the samples.
+ * @return Duration in nanoseconds.
+ */
+double FrameProfiler::percentile(const sf::Uint32* buckets, sf::Uint64 count, double fraction) {
+    sf::Uint64 rank = static_cast<sf::Uint64>(fraction * (count - 1)) + 1;
+    sf::Uint64 seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return bucketValue(i);
+        }
+    }
+    return bucketValue(BUCKETS - 1);
+}
+
+void FrameProfiler::record(Stage stage, sf::Uint64 nanoseconds) {
+    if (!enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (!registration.histograms) {
+        registration.histograms = claim("unnamed");
+    }
+
+    // Only the owning thread writes, so plain load/store pairs are enough; the atomics
+    // only keep concurrent readers from seeing torn values.
+    Histogram& histogram = registration.histograms->stages[stage];
+    std::atomic<sf::Uint32>& bucket = histogram.buckets[bucketOf(nanoseconds)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    histogram.sum.store(histogram.sum.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+    if (nanoseconds > histogram.max.load(std::memory_order_relaxed)) {
+        histogram.max.store(nanoseconds, std::memory_order_relaxed);
+    }
+    histogram.count.store(histogram.count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+std::vector<FrameProfiler::Summary> FrameProfiler::summarize() {
+    std::vector<Summary> summaries;
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    for (const std::unique_ptr<ThreadHistograms>& entry : registry) {
+        for (int stage = 0; stage < StageCount; stage++) {
+            const Histogram& histogram = entry->stages[stage];
+            if (histogram.count.load(std::memory_order_acquire) == 0) {
+                continue;
+            }
+
+            // Snapshot the buckets first and count from the snapshot, so percentiles stay
+            // consistent while the owner keeps recording.
+            sf::Uint32 buckets[BUCKETS];
+            sf::Uint64 count = 0;
+            for (int i = 0; i < BUCKETS; i++) {
+                buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+                count += buckets[i];
+            }
+            if (count == 0) {
+                continue;
+            }
+
+            Summary summary;
+            summary.thread = entry->name;
+            summary.stage = static_cast<Stage>(stage);
+            summary.count = count;
+            summary.mean = histogram.sum.load(std::memory_order_relaxed) / 1000.0 / histogram.count.load(std::memory_order_relaxed);
+            summary.p50 = percentile(buckets, count, 0.50) / 1000.0;
+            summary.p99 = percentile(buckets, count, 0.99) / 1000.0;
+            summary.max = histogram.max.load(std::memory_order_relaxed) / 1000.0;
+            summaries.push_back(summary);
+        }
+    }
+    return summaries;
+}
+
+bool FrameProfiler::dump(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    std::vector<Summary> summaries = summarize();
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+
+    if (json) {
+        file << "[\n";
+        for (std::size_t i = 0; i < summaries.size(); i++) {
+            const Summary& s = summaries[i];
+            file << "  { \"thread\": \"" << s.thread << "\", \"stage\": \"" << stageName(s.stage)
+                 << "\", \"count\": " << s.count << ", \"mean_us\": " << s.mean << ", \"p50_us\": " << s.p50
+                 << ", \"p99_us\": " << s.p99 << ", \"max_us\": " << s.max << " }"
+                 << (i + 1 < summaries.size() ? ",\n" : "\n");
+        }
+        file << "]\n";
+    }
+    else {
+        file << "thread,stage,count,mean_us,p50_us,p99_us,max_us\n";
+        for (const Summary& s : summaries) {
+            file << s.thread << ',' << stageName(s.stage) << ',' << s.count << ',' << s.mean << ','
+                 << s.p50 << ',' << s.p99 << ',' << s.max << '\n';
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+const char* FrameProfiler::stageName(Stage stage) {
+    switch (stage) {
+    case Frame: return "frame";
+    case Decode: return "decode";
+    case Analysis: return "analysis";
+    case Geometry: return "geometry";
+    case Draw: return "draw";
+    case Display: return "display";
+    default: return "unknown";
+    }
+}
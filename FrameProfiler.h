@@ -0,0 +1,166 @@
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <SFML/Config.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class FrameProfiler
+ * @brief Process-wide timing histograms of the stages of a frame, kept per thread.
+ *
+ * Every thread records into its own histograms, so recording is a handful of relaxed
+ * atomic stores with no lock and no sharing between threads. Readers (the overlay and
+ * the dump on exit) merge nothing; they report each thread separately, which is what
+ * tells a stalled decoder apart from a slow draw.
+ */
+class FrameProfiler {
+public:
+    /**
+     * @brief Stages that are timed.
+     */
+    enum Stage {
+        Frame,          ///< Whole iteration of a render loop, i.e. the frame interval.
+        Decode,         ///< Reading or decoding samples.
+        Analysis,       ///< FFT or peak analysis.
+        Geometry,       ///< Building and uploading vertices.
+        Draw,           ///< Issuing draw calls.
+        Display,        ///< Presenting the frame, including the wait for the frame limit.
+        StageCount
+    };
+
+    /**
+     * @brief Summary of one stage on one thread. Times are in microseconds.
+     */
+    struct Summary {
+        std::string thread;     ///< Name given with setThreadName().
+        Stage stage;            ///< Timed stage.
+        sf::Uint64 count;       ///< Number of samples.
+        double mean;            ///< Mean duration.
+        double p50;             ///< Median duration.
+        double p99;             ///< 99th percentile duration.
+        double max;             ///< Longest duration.
+    };
+
+    /**
+     * @brief Names the calling thread; its samples are reported under this name.
+     *
+     * A thread that exits gives its histograms back, and the next thread with the same
+     * name continues them, so restarting a visualizer does not add new rows.
+     * @param name Thread name, e.g. "render".
+     */
+    static void setThreadName(const std::string& name);
+
+    /**
+     * @brief Adds one sample for the calling thread.
+     * @param stage Timed stage.
+     * @param nanoseconds Duration of the stage.
+     */
+    static void record(Stage stage, sf::Uint64 nanoseconds);
+
+    /**
+     * @brief Turns recording on or off. Recording is on by default.
+     * @param enabled True to record samples.
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * @brief Checks if samples are recorded.
+     * @return True if recording is on.
+     */
+    static bool isEnabled();
+
+    /**
+     * @brief Summarizes every stage of every thread that has samples.
+     * @return One entry per thread and stage.
+     */
+    static std::vector<Summary> summarize();
+
+    /**
+     * @brief Writes summarize() to a file, as JSON if the path ends in ".json" and as CSV otherwise.
+     * @param path Output file.
+     * @return False if the file cannot be written.
+     */
+    static bool dump(const std::string& path);
+
+    /**
+     * @brief Returns the name of a stage.
+     * @param stage Stage.
+     * @return Lower-case name, e.g. "geometry".
+     */
+    static const char* stageName(Stage stage);
+
+private:
+    static constexpr int BUCKETS = 144;    ///< Log-linear buckets of nanoseconds, four per power of two, up to ~68 s.
+
+    /**
+     * @brief Histogram of one stage. Written by one thread only.
+     */
+    struct Histogram {
+        std::atomic<sf::Uint32> buckets[BUCKETS];
+        std::atomic<sf::Uint64> count;
+        std::atomic<sf::Uint64> sum;
+        std::atomic<sf::Uint64> max;
+    };
+
+    /**
+     * @brief Histograms of one named thread.
+     */
+    struct ThreadHistograms {
+        std::string name;
+        std::atomic<bool> owned;
+        Histogram stages[StageCount];
+    };
+
+    /**
+     * @brief Gives a thread's histograms back when the thread exits.
+     */
+    struct Registration {
+        ThreadHistograms* histograms = nullptr;
+        ~Registration();
+    };
+
+    static ThreadHistograms* claim(const std::string& name);
+    static int bucketOf(sf::Uint64 nanoseconds);
+    static double bucketValue(int bucket);
+    static double percentile(const sf::Uint32* buckets, sf::Uint64 count, double fraction);
+
+    static std::mutex registryMutex;
+    static std::vector<std::unique_ptr<ThreadHistograms>> registry;
+    static std::atomic<bool> enabled;
+    static thread_local Registration registration;
+};
+
+/**
+ * @class ScopedTimer
+ * @brief Times the enclosing scope and records it in the FrameProfiler.
+ */
+class ScopedTimer {
+public:
+    /**
+     * @brief Starts timing.
+     * @param stage Stage the scope belongs to.
+     */
+    explicit ScopedTimer(FrameProfiler::Stage stage) : stage(stage), start(std::chrono::steady_clock::now()) { }
+
+    /**
+     * @brief Records the time since construction.
+     */
+    ~ScopedTimer() {
+        std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+        FrameProfiler::record(stage, static_cast<sf::Uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    FrameProfiler::Stage stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // FRAMEPROFILER_H
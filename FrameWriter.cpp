@@ -0,0 +1,88 @@
+#include "FrameWriter.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+FrameWriter::FrameWriter(const std::string& path, unsigned int width, unsigned int height, unsigned int fps)
+    : path(path), width(width), height(height) {
+    bool y4m = path.size() >= 4 && path.substr(path.size() - 4) == ".y4m";
+    format = y4m ? Y4m : PngSequence;
+
+    if (format == PngSequence) {
+        std::error_code error;
+        std::filesystem::create_directories(path, error);
+        if (error) {
+            throw std::runtime_error("Failed to create output directory!");
+        }
+        return;
+    }
+
+    if (width % 2 != 0 || height % 2 != 0) {
+        throw std::runtime_error("Y4M output needs an even width and height!");
+    }
+    stream.open(path, std::ios::binary);
+    if (!stream) {
+        throw std::runtime_error("Failed to open output file!");
+    }
+    stream << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+}
+
+FrameWriter::Format FrameWriter::getFormat() const {
+    return format;
+}
+
+void FrameWriter::writePng(sf::Uint64 index, const sf::Uint8* rgba) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%06llu.png", static_cast<unsigned long long>(index));
+
+    sf::Image image;
+    image.create(width, height, rgba);
+    if (!image.saveToFile((std::filesystem::path(path) / name).string())) {
+        throw std::runtime_error("Failed to write frame!");
+    }
+}
+
+/**
+ * @brief Converts an RGBA frame to planar BT.601 (full range) YUV 4:2:0.
+ */
+void FrameWriter::convertToYuv(const sf::Uint8* rgba, std::vector<sf::Uint8>& yuv) const {
+    std::size_t lumaSize = static_cast<std::size_t>(width) * height;
+    std::size_t chromaWidth = width / 2;
+    yuv.resize(lumaSize + 2 * (lumaSize / 4));
+
+    sf::Uint8* planeY = yuv.data();
+    sf::Uint8* planeU = planeY + lumaSize;
+    sf::Uint8* planeV = planeU + lumaSize / 4;
+
+    for (unsigned int y = 0; y < height; y++) {
+        const sf::Uint8* pixel = rgba + static_cast<std::size_t>(y) * width * 4;
+        for (unsigned int x = 0; x < width; x++, pixel += 4) {
+            planeY[static_cast<std::size_t>(y) * width + x] = static_cast<sf::Uint8>((77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2] + 128) >> 8);
+        }
+    }
+
+    // Chroma is averaged over each 2x2 block.
+    for (unsigned int y = 0; y < height; y += 2) {
+        for (unsigned int x = 0; x < width; x += 2) {
+            int r = 0, g = 0, b = 0;
+            for (unsigned int dy = 0; dy < 2; dy++) {
+                const sf::Uint8* pixel = rgba + ((static_cast<std::size_t>(y) + dy) * width + x) * 4;
+                r += pixel[0] + pixel[4];
+                g += pixel[1] + pixel[5];
+                b += pixel[2] + pixel[6];
+            }
+            std::size_t index = (y / 2) * chromaWidth + x / 2;
+            planeU[index] = static_cast<sf::Uint8>(std::min(255, std::max(0, 128 + ((-43 * r - 85 * g + 128 * b + 512) >> 10))));
+            planeV[index] = static_cast<sf::Uint8>(std::min(255, std::max(0, 128 + ((128 * r - 107 * g - 21 * b + 512) >> 10))));
+        }
+    }
+}
+
+void FrameWriter::writeY4m(const std::vector<sf::Uint8>& yuv) {
+    stream << "FRAME\n";
+    stream.write(reinterpret_cast<const char*>(yuv.data()), yuv.size());
+    if (!stream) {
+        throw std::runtime_error("Failed to write frame!");
+    }
+}
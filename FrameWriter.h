@@ -0,0 +1,69 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @class FrameWriter
+ * @brief Streams rendered frames to disk as a PNG sequence or a raw Y4M video.
+ *
+ * Outputs ending in ".y4m" are written as one YUV4MPEG2 (4:2:0) stream, in frame order.
+ * Any other output is a directory that receives frame_000000.png, frame_000001.png, ...
+ * PNG frames are independent files, so they may be written from several threads.
+ */
+class FrameWriter {
+public:
+    /**
+     * @brief Output container.
+     */
+    enum Format {
+        PngSequence,    ///< One PNG file per frame.
+        Y4m             ///< Single YUV4MPEG2 stream.
+    };
+
+    /**
+     * @brief Prepares the output; creates the PNG directory or writes the Y4M header.
+     * @param path Output path.
+     * @param width Frame width in pixels; Y4M needs an even width.
+     * @param height Frame height in pixels; Y4M needs an even height.
+     * @param fps Frame rate.
+     * @throws std::runtime_error If the output cannot be created.
+     */
+    FrameWriter(const std::string& path, unsigned int width, unsigned int height, unsigned int fps);
+
+    /**
+     * @brief Retrieves the output container picked from the path.
+     * @return The output format.
+     */
+    Format getFormat() const;
+
+    /**
+     * @brief Writes one PNG frame. Safe to call from several threads at once.
+     * @param index Frame number, used in the file name.
+     * @param rgba width * height * 4 bytes.
+     * @throws std::runtime_error If the file cannot be written.
+     */
+    void writePng(sf::Uint64 index, const sf::Uint8* rgba) const;
+
+    /**
+     * @brief Converts an RGBA frame to planar BT.601 YUV 4:2:0. Safe to call from several threads.
+     * @param rgba width * height * 4 bytes.
+     * @param yuv Receives the Y, U and V planes.
+     */
+    void convertToYuv(const sf::Uint8* rgba, std::vector<sf::Uint8>& yuv) const;
+
+    /**
+     * @brief Appends one converted frame to the Y4M stream. Frames must arrive in order.
+     * @param yuv Planes produced by convertToYuv().
+     * @throws std::runtime_error If the stream cannot be written.
+     */
+    void writeY4m(const std::vector<sf::Uint8>& yuv);
+
+private:
+    Format format;          ///< Output container.
+    std::string path;       ///< Output file or directory.
+    unsigned int width;     ///< Frame width in pixels.
+    unsigned int height;    ///< Frame height in pixels.
+    std::ofstream stream;   ///< Open Y4M stream.
+};
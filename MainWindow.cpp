@@ -1,8 +1,23 @@
 #include "MainWindow.h"
+#include <filesystem>
 #include <iostream>
+#include <system_error>
+
+namespace {
+    const char* describe(LoadHandle::Stage stage) {
+        switch (stage) {
+        case LoadHandle::Decoding: return "Decoding";
+        case LoadHandle::Summarizing: return "Summarizing";
+        case LoadHandle::Ready: return "Ready";
+        case LoadHandle::Failed: return "Failed";
+        case LoadHandle::Cancelled: return "Cancelled";
+        }
+        return "";
+    }
+}
 
 
-MainWindow::MainWindow(int width, int height, const char* title) : waveFormAudio(audioHandler), audioBars(audioHandler) {
+MainWindow::MainWindow(int width, int height, const char* title) : analysisBus(audioHandler), waveFormAudio(analysisBus), audioBars(analysisBus) {
     window.create(sf::VideoMode(width, height), title);
     window.setFramerateLimit(60);
 
@@ -72,11 +87,36 @@ MainWindow::MainWindow(int width, int height, const char* title) : waveFormAudio
     waveFormText.setCharacterSize(24);
     waveFormText.setFillColor(sf::Color::Green);
     waveFormText.setPosition(830, height - 60);
+
+    //Progress of the background load
+    progressTrack.setPosition(20, height - 110);
+    progressTrack.setSize(sf::Vector2f(960, 20));
+    progressTrack.setFillColor(sf::Color::Black);
+    progressTrack.setOutlineThickness(2);
+    progressTrack.setOutlineColor(sf::Color::Green);
+
+    progressBar.setPosition(20, height - 110);
+    progressBar.setSize(sf::Vector2f(0, 20));
+    progressBar.setFillColor(sf::Color::Green);
+
+    statusText.setFont(font);
+    statusText.setCharacterSize(18);
+    statusText.setFillColor(sf::Color::Green);
+    statusText.setPosition(20, height - 140);
+
+    browser.setLayout(font, sf::FloatRect(20, 20, width - 40, height - 170));
 }
 
 void MainWindow::run() {
+    // Both visualizers are built hidden up front, so choosing a mode later only shows a window.
+    audioBars.warmUp();
+    waveFormAudio.warmUp();
     while (window.isOpen()) {
         handleEvents();
+        updateLoading();
+        if (browsing) {
+            browser.update();
+        }
         window.clear(sf::Color::Black);
 
         window.draw(chooseFileButton);
@@ -94,8 +134,27 @@ void MainWindow::run() {
         window.draw(waveFormButton);
         window.draw(waveFormText);
 
+        if (browsing) {
+            browser.draw(window);
+        }
+
+        if (loading.isValid()) {
+            window.draw(progressTrack);
+            window.draw(progressBar);
+            window.draw(statusText);
+        }
+
         window.display();       
     }
+    loading.cancel();
+}
+
+void MainWindow::setAnalysisSize(int fftSize, int bars) {
+    analysisBus.setAnalysisSize(fftSize, bars);
+}
+
+void MainWindow::setBarScale(BandMapping::Scale scale) {
+    analysisBus.setBarScale(scale);
 }
 
 void MainWindow::handleEvents() {
@@ -104,6 +163,23 @@ void MainWindow::handleEvents() {
         if (event.type == sf::Event::Closed) {
             window.close();
         }
+        if (browsing && browser.handleEvent(event)) {
+            selectedFile = browser.getChosenFile();
+            browsing = false;
+            startLoading();
+            continue;
+        }
+        if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Escape) {
+            // Escape closes the browser first, then cancels the load.
+            if (browsing) {
+                browsing = false;
+            }
+            else {
+                loading.cancel();
+                playWhenLoaded = false;
+                visualizeWhenLoaded.clear();
+            }
+        }
         if (event.type == sf::Event::MouseButtonPressed) {
             if (event.mouseButton.button == sf::Mouse::Left) {
                 if (chooseFileButton.getGlobalBounds().contains(event.mouseButton.x, event.mouseButton.y)) {
@@ -115,13 +191,13 @@ void MainWindow::handleEvents() {
                 if (pauseButton.getGlobalBounds().contains(event.mouseButton.x, event.mouseButton.y)) {
                     pause();
                 }
+                // With Shift held, either mode button shows both modes side by side.
+                bool both = sf::Keyboard::isKeyPressed(sf::Keyboard::LShift) || sf::Keyboard::isKeyPressed(sf::Keyboard::RShift);
                 if (waveFormButton.getGlobalBounds().contains(event.mouseButton.x, event.mouseButton.y)) {
-                    setVisualizerMode(&waveFormAudio);
-                    visualize();
+                    requestVisualizers(both ? std::vector<AudioVisualizer*>{ &audioBars, &waveFormAudio } : std::vector<AudioVisualizer*>{ &waveFormAudio });
                 }
                 if (barsModeButton.getGlobalBounds().contains(event.mouseButton.x, event.mouseButton.y)) {
-                    setVisualizerMode(&audioBars);
-                    visualize();
+                    requestVisualizers(both ? std::vector<AudioVisualizer*>{ &audioBars, &waveFormAudio } : std::vector<AudioVisualizer*>{ &audioBars });
                 }
             }
         
@@ -129,39 +205,124 @@ void MainWindow::handleEvents() {
     }
 }
 void MainWindow::chooseFile() {
-    std::cout << "Pass the file name (.wav):" << std::endl;
-    while (true) {
-        std::cin >> selectedFile;
-
-        // Check if file has .wav extension
-        if (selectedFile.size() >= 4 && selectedFile.substr(selectedFile.size() - 4) == ".wav") {
-
-            // Check if file exists using fstream
-            std::ifstream file(selectedFile);
-            if (file.good()) {
-                file.close();
-                break;  // exit the loop if the file exists and is a .wav file
-            }
-            else {
-                std::cout << "The file does not exist. Please enter a valid .wav file:" << std::endl;
-            }
-        }
-        else {
-            std::cout << "Please enter a valid .wav file:" << std::endl;
-        }
+    if (browser.getDirectory().empty()) {
+        std::error_code error;
+        std::filesystem::path start = selectedFile.empty() ? std::filesystem::current_path(error) : std::filesystem::path(selectedFile).parent_path();
+        browser.open(error || start.empty() ? "." : start.string());
     }
-    std::cout << "File is okay, enjoy!" << std::endl;
+    browsing = !browsing;
 }
 
 void MainWindow::play() {
-    if (!selectedFile.empty()) {
-        audioHandler.loadFile(selectedFile);
-        audioHandler.play();
+    if (selectedFile.empty()) {
+        return;
     }
+    if (!loading.isValid() || loading.getStage() == LoadHandle::Cancelled) {
+        startLoading();
+    }
+    playWhenLoaded = true;
+    updateLoading();
 }
 
 void MainWindow::pause() {
+    playWhenLoaded = false;
     audioHandler.pause();
 }
 
+void MainWindow::startLoading() {
+    // The previous load stops at its next chunk; replacing the handle waits for that.
+    loading.cancel();
+    playWhenLoaded = false;
+    visualizeWhenLoaded.clear();
+    loading = AudioLoader::load(selectedFile, audioHandler.getStreamingThreshold());
+}
+
+void MainWindow::updateLoading() {
+    if (!loading.isValid()) {
+        return;
+    }
+
+    LoadHandle::Stage stage = loading.getStage();
+    float progress = stage == LoadHandle::Decoding || stage == LoadHandle::Summarizing ? loading.getProgress() : stage == LoadHandle::Ready ? 1.0f : 0.0f;
+    progressBar.setSize(sf::Vector2f(progressTrack.getSize().x * progress, progressTrack.getSize().y));
+    statusText.setString(std::string(describe(stage)) + " " + std::to_string(static_cast<int>(progress * 100)) + "%");
+
+    if (stage == LoadHandle::Failed) {
+        playWhenLoaded = false;
+        visualizeWhenLoaded.clear();
+        try {
+            loading.get();
+        }
+        catch (const std::exception& e) {
+            std::cout << loading.getPath() << ": " << e.what() << std::endl;
+        }
+        loading = LoadHandle();
+        return;
+    }
+
+    // Both of these are cache lookups now.
+    if (playWhenLoaded && loading.isPlayable()) {
+        playWhenLoaded = false;
+        analysisBus.loadFile(selectedFile);
+        audioHandler.play();
+    }
+    if (!visualizeWhenLoaded.empty() && stage == LoadHandle::Ready) {
+        setVisualizerModes(visualizeWhenLoaded);
+        visualizeWhenLoaded.clear();
+        visualize();
+    }
+}
+
+void MainWindow::requestVisualizers(const std::vector<AudioVisualizer*>& modes) {
+    if (selectedFile.empty()) {
+        return;
+    }
+    if (!loading.isValid() || loading.getStage() == LoadHandle::Cancelled) {
+        startLoading();
+    }
+    visualizeWhenLoaded = modes;
+    updateLoading();
+}
+
+void MainWindow::visualize() {
+    if (visualizers.empty()) {
+        return;
+    }
+    window.setVisible(false);
+    // The bus loads the file once; reloading it would stop playback and reopen the stream for every view.
+    analysisBus.loadFile(selectedFile);
+    for (AudioVisualizer* mode : visualizers) {
+        mode->loadFile();
+    }
+
+    // Views sit next to each other, starting where the main window was.
+    sf::Vector2i position = window.getPosition();
+    for (AudioVisualizer* mode : visualizers) {
+        mode->warmUp();
+        if (visualizers.size() > 1) {
+            mode->getWindow().setPosition(position);
+            position.x += static_cast<int>(mode->getWindow().getSize().x);
+        }
+        mode->begin();
+    }
+
+    // Each view ends on its own; playback pauses when the last one does.
+    bool anyOpen = true;
+    while (anyOpen) {
+        anyOpen = false;
+        for (AudioVisualizer* mode : visualizers) {
+            if (!mode->isOpen()) {
+                continue;
+            }
+            if (mode->update()) {
+                anyOpen = true;
+            }
+            else {
+                mode->end();
+            }
+        }
+    }
+    window.setVisible(true);
+}
+
 
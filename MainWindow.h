@@ -2,11 +2,14 @@
 #define MAINWINDOW_H
 
 #include <SFML/Graphics.hpp>
-#include <fstream>
+#include <vector>
 #include "WaveFormAudio.h"
 #include "AudioHandler.h"
 #include "AudioBars.h"
+#include "AudioLoader.h"
+#include "AnalysisBus.h"
 #include "AudioVisualizer.h"
+#include "FileBrowser.h"
 
 /**
  * @class MainWindow
@@ -14,6 +17,13 @@
  *
  * The MainWindow class provides an interface for choosing audio files,
  * playing/pausing audio, and switching between different audio visualizations.
+ *
+ * Files are chosen in an in-window FileBrowser and loaded by an AudioLoader in the background while the window keeps
+ * rendering a progress bar. Play starts as soon as the samples are decoded and a
+ * visualizer as soon as the peaks are built too; Escape cancels the load.
+ *
+ * Shift-clicking a mode button shows the bars and the waveform side by side, both fed by
+ * one AnalysisBus.
  */
 class MainWindow {
 public:
@@ -30,6 +40,20 @@ public:
      */
     void run();
 
+    /**
+     * @brief Sets the FFT size and bar count of the analysis bus.
+     * @param fftSize Samples per FFT window.
+     * @param bars Number of bars.
+     * @throws std::runtime_error If the configuration is not supported.
+     */
+    void setAnalysisSize(int fftSize, int bars);
+
+    /**
+     * @brief Sets how the bars of the analysis bus are spaced.
+     * @param scale Linear, log, mel or constant-Q spacing.
+     */
+    void setBarScale(BandMapping::Scale scale);
+
 private:
     /**
       * @brief Process and handle SFML window events.
@@ -37,7 +61,7 @@ private:
     void handleEvents();
 
     /**
-     * @brief Lets the user choose an audio file for playback and visualization.
+     * @brief Shows or hides the file browser, starting in the directory of the selected file.
      */
     void chooseFile();
 
@@ -51,35 +75,54 @@ private:
      */
     void pause();
 
+    /**
+     * @brief Starts loading the selected file in the background, cancelling any previous load.
+     */
+    void startLoading();
+
+    /**
+     * @brief Starts the playback or visualizer that waited for the load once it is far enough,
+     * reports failures and updates the progress bar. Called once per frame.
+     */
+    void updateLoading();
+
+    /**
+     * @brief Shows visualizers once the selected file is loaded.
+     * @param modes Visualizers to show side by side.
+     */
+    void requestVisualizers(const std::vector<AudioVisualizer*>& modes);
+
+    /**
+     * @brief Loads the selected audio file and runs the chosen visualizers side by side
+     * until every one of them has ended.
+     */
+    void visualize();
+
     sf::RenderWindow window; ///< The primary SFML window.
     sf::RectangleShape chooseFileButton, playButton, pauseButton, barsModeButton, waveFormButton; ///< UI buttons.
     sf::Text chooseFileText, playText, pauseText, barsText, waveFormText; ///< Text displayed on UI buttons.
+    sf::RectangleShape progressTrack, progressBar; ///< Background and filled part of the load progress bar.
+    sf::Text statusText; ///< Stage of the current load.
     sf::Font font; ///< Font used for button text.
+    FileBrowser browser; ///< In-window file browser, shown while browsing is set.
+    bool browsing = false; ///< True while the file browser is shown.
 
     std::string selectedFile; ///< Path to the currently selected audio file.
     AudioHandler audioHandler; ///< Handler for loading and controlling audio.
+    AnalysisBus analysisBus; ///< Clock, spectra and peaks shared by the visualizers.
     WaveFormAudio waveFormAudio; ///< Audio visualization mode showing waveform.
     AudioBars audioBars; ///< Audio visualization mode showing bars.
-    AudioVisualizer* visualizer; ///< Current audio visualization mode in use.
-
-    /**
-     * @brief Sets the active audio visualization mode.
-     * @param mode Pointer to the AudioVisualizer to use.
-     */
-    void setVisualizerMode(AudioVisualizer* mode) {
-        visualizer = mode;
-    }
+    std::vector<AudioVisualizer*> visualizers; ///< Audio visualization modes in use, shown side by side.
+    LoadHandle loading; ///< Background load of selectedFile.
+    bool playWhenLoaded = false; ///< Play was pressed before the file could play.
+    std::vector<AudioVisualizer*> visualizeWhenLoaded; ///< Visualizers requested before the file was loaded.
 
     /**
-     * @brief Loads the selected audio file into the current visualizer and begins visualization.
+     * @brief Sets the active audio visualization modes.
+     * @param modes Visualizers to use, shown side by side.
      */
-    void visualize() {
-        if (visualizer) {
-            window.setVisible(false);
-            visualizer->loadFile(selectedFile);
-            visualizer->run();
-            window.setVisible(true);
-        }
+    void setVisualizerModes(const std::vector<AudioVisualizer*>& modes) {
+        visualizers = modes;
     }
 };
 
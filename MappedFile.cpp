@@ -0,0 +1,221 @@
+#include "MappedFile.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : mapping(nullptr), length(0), writable(false), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr) { }
+
+/**
+ * @brief Maps an existing file read-only.
+ * @param path Path to the file.
+ * @return True if the file was mapped; empty files cannot be mapped.
+ */
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+    }
+
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle) {
+        close();
+        return false;
+    }
+
+    mapping = static_cast<unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!mapping) {
+        close();
+        return false;
+    }
+
+    length = static_cast<std::size_t>(fileSize.QuadPart);
+    writable = false;
+    return true;
+}
+
+/**
+ * @brief Creates (or truncates) a file of the given size and maps it writable.
+ * @param path Path to the file.
+ * @param size Size of the file in bytes.
+ * @return True if the file was created and mapped.
+ */
+bool MappedFile::create(const std::string& path, std::size_t size) {
+    close();
+
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE || size == 0) {
+        close();
+        return false;
+    }
+
+    ULARGE_INTEGER fileSize;
+    fileSize.QuadPart = size;
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READWRITE, fileSize.HighPart, fileSize.LowPart, nullptr);
+    if (!mappingHandle) {
+        close();
+        return false;
+    }
+
+    mapping = static_cast<unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_WRITE, 0, 0, 0));
+    if (!mapping) {
+        close();
+        return false;
+    }
+
+    length = size;
+    writable = true;
+    return true;
+}
+
+void MappedFile::advise(Advice, std::size_t, std::size_t) const { }
+
+void MappedFile::close() {
+    if (mapping) {
+        if (writable) {
+            FlushViewOfFile(mapping, 0);
+        }
+        UnmapViewOfFile(mapping);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+    }
+    mapping = nullptr;
+    mappingHandle = nullptr;
+    fileHandle = INVALID_HANDLE_VALUE;
+    length = 0;
+    writable = false;
+}
+
+#else
+
+MappedFile::MappedFile() : mapping(nullptr), length(0), writable(false), fileDescriptor(-1) { }
+
+/**
+ * @brief Maps an existing file read-only.
+ * @param path Path to the file.
+ * @return True if the file was mapped; empty files cannot be mapped.
+ */
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    fileDescriptor = ::open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fileDescriptor, &info) != 0 || info.st_size == 0) {
+        close();
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    if (view == MAP_FAILED) {
+        close();
+        return false;
+    }
+
+    mapping = static_cast<unsigned char*>(view);
+    length = static_cast<std::size_t>(info.st_size);
+    writable = false;
+    return true;
+}
+
+/**
+ * @brief Creates (or truncates) a file of the given size and maps it writable.
+ * @param path Path to the file.
+ * @param size Size of the file in bytes.
+ * @return True if the file was created and mapped.
+ */
+bool MappedFile::create(const std::string& path, std::size_t size) {
+    close();
+
+    fileDescriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fileDescriptor < 0 || size == 0 || ftruncate(fileDescriptor, static_cast<off_t>(size)) != 0) {
+        close();
+        return false;
+    }
+
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+    if (view == MAP_FAILED) {
+        close();
+        return false;
+    }
+
+    mapping = static_cast<unsigned char*>(view);
+    length = size;
+    writable = true;
+    return true;
+}
+
+void MappedFile::advise(Advice advice, std::size_t offset, std::size_t size) const {
+    if (!mapping || offset >= length) {
+        return;
+    }
+    // madvise wants a page-aligned start.
+    std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::size_t start = offset / page * page;
+    std::size_t end = std::min(length, offset + std::min(size, length - offset));
+    int flag = advice == Sequential ? MADV_SEQUENTIAL : advice == Random ? MADV_RANDOM : MADV_WILLNEED;
+    madvise(mapping + start, end - start, flag);
+}
+
+void MappedFile::close() {
+    if (mapping) {
+        if (writable) {
+            msync(mapping, length, MS_SYNC);
+        }
+        munmap(mapping, length);
+    }
+    if (fileDescriptor >= 0) {
+        ::close(fileDescriptor);
+    }
+    mapping = nullptr;
+    fileDescriptor = -1;
+    length = 0;
+    writable = false;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::isOpen() const {
+    return mapping != nullptr;
+}
+
+const unsigned char* MappedFile::data() const {
+    return mapping;
+}
+
+unsigned char* MappedFile::data() {
+    return mapping;
+}
+
+std::size_t MappedFile::size() const {
+    return length;
+}
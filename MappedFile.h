@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * @class MappedFile
+ * @brief Maps a file into memory, on Windows and on POSIX systems.
+ *
+ * A read-only mapping exposes an existing file in place; create() sizes a new file
+ * and maps it writable so several threads can fill disjoint parts of it.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief How a range of the mapping is about to be read, passed on to the kernel.
+     */
+    enum Advice {
+        Sequential, ///< Read front to back; read ahead aggressively and drop pages behind.
+        Random,     ///< Read at scattered offsets; do not read ahead.
+        WillNeed    ///< Start reading the range in now.
+    };
+
+    /**
+     * @brief Default constructor; no file is mapped.
+     */
+    MappedFile();
+
+    /**
+     * @brief Unmaps the file, if any.
+     */
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Maps an existing file read-only.
+     * @param path Path to the file.
+     * @return True if the file was mapped; empty files cannot be mapped.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Creates (or truncates) a file of the given size and maps it writable.
+     * @param path Path to the file.
+     * @param size Size of the file in bytes.
+     * @return True if the file was created and mapped.
+     */
+    bool create(const std::string& path, std::size_t size);
+
+    /**
+     * @brief Tells the kernel how a range of the mapping will be read. Only a hint; it may be ignored.
+     * On Windows the file is opened for sequential scanning and this does nothing.
+     * @param advice Expected access pattern.
+     * @param offset First byte of the range.
+     * @param length Length of the range in bytes; clamped to the end of the mapping.
+     */
+    void advise(Advice advice, std::size_t offset, std::size_t length) const;
+
+    /**
+     * @brief Flushes a writable mapping to disk and unmaps the file.
+     */
+    void close();
+
+    /**
+     * @brief Checks whether a file is mapped.
+     * @return True if data() is valid.
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Retrieves the start of the mapping.
+     * @return Pointer to the first byte of the file.
+     */
+    const unsigned char* data() const;
+
+    /**
+     * @brief Retrieves the start of a writable mapping.
+     * @return Pointer to the first byte of the file.
+     */
+    unsigned char* data();
+
+    /**
+     * @brief Retrieves the size of the mapping.
+     * @return Size of the file in bytes.
+     */
+    std::size_t size() const;
+
+private:
+    unsigned char* mapping;     ///< Start of the mapped view.
+    std::size_t length;         ///< Size of the mapped view.
+    bool writable;              ///< True if the view was created by create().
+#ifdef _WIN32
+    void* fileHandle;           ///< Handle of the open file.
+    void* mappingHandle;        ///< Handle of the file mapping object.
+#else
+    int fileDescriptor;         ///< Descriptor of the open file.
+#endif
+};
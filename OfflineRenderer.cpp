@@ -0,0 +1,236 @@
+#include "OfflineRenderer.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "AudioBars.h"
+#include "DspKernels.h"
+#include "FrameWriter.h"
+#include "SoftwareCanvas.h"
+#include "SpectrumAnalyzer.h"
+#include "ThreadPool.h"
+
+namespace {
+    const unsigned int WINDOW_PER_THREAD = 2;   ///< Frames in flight per worker thread.
+
+    /**
+     * @brief One frame in flight: rendered by a worker, then written in order by render().
+     */
+    struct FrameSlot {
+        FrameSlot(unsigned int width, unsigned int height) : canvas(width, height), done(false) { }
+
+        SoftwareCanvas canvas;          ///< Pixels of the frame.
+        std::vector<sf::Uint8> yuv;     ///< Frame converted for a Y4M stream.
+        std::string error;              ///< Message of an exception the worker caught.
+        bool done;                      ///< Set by the worker under the slot mutex once the frame is ready.
+    };
+}
+
+OfflineRenderer::Worker::Worker() : opened(false) { }
+
+OfflineRenderer::Worker::~Worker() { }
+
+OfflineRenderer::OfflineRenderer(const Options& options) : options(options) {
+    sf::InputSoundFile input;
+    if (!input.openFromFile(options.input)) {
+        throw std::runtime_error("Failed to open file!");
+    }
+    channels = input.getChannelCount();
+    sampleRate = input.getSampleRate();
+    frames = input.getSampleCount() / channels;
+
+    if (options.fps == 0 || options.width == 0 || options.height == 0) {
+        throw std::runtime_error("Invalid frame size or rate!");
+    }
+    if (options.mode == Wave) {
+        buildPeaks();
+    }
+}
+
+sf::Uint64 OfflineRenderer::getFrameCount() const {
+    return frames * options.fps / sampleRate;
+}
+
+/**
+ * @brief Renders every frame of the file and writes it out.
+ * @throws std::runtime_error If the output cannot be written.
+ */
+void OfflineRenderer::render() {
+    FrameWriter writer(options.output, options.width, options.height, options.fps);
+    unsigned int threadCount = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    sf::Uint64 frameCount = getFrameCount();
+
+    // Frames run up to WINDOW_PER_THREAD slots per thread ahead of the writer, so one slow
+    // frame holds up the output but not the workers.
+    std::vector<FrameSlot> slots(WINDOW_PER_THREAD * threadCount, FrameSlot(options.width, options.height));
+    std::mutex slotMutex;
+    std::condition_variable slotDone;
+
+    // Decoders and FFT plans belong to a worker and survive across frames; a task borrows
+    // one for its frame, and no more tasks than workers run at once.
+    std::vector<std::unique_ptr<Worker>> state;
+    std::vector<Worker*> idleWorkers;
+    for (unsigned int t = 0; t < threadCount; t++) {
+        state.push_back(std::make_unique<Worker>());
+        idleWorkers.push_back(state.back().get());
+    }
+
+    // Declared last, so its destructor drains the remaining tasks before the slots go.
+    ThreadPool pool(threadCount);
+    auto submit = [&](sf::Uint64 index) {
+        pool.submit([&, index]() {
+            FrameSlot& slot = slots[index % slots.size()];
+            Worker* worker;
+            {
+                std::lock_guard<std::mutex> lock(slotMutex);
+                worker = idleWorkers.back();
+                idleWorkers.pop_back();
+            }
+            try {
+                renderFrame(index, slot.canvas, *worker);
+                if (writer.getFormat() == FrameWriter::PngSequence) {
+                    writer.writePng(index, slot.canvas.getPixels());
+                }
+                else {
+                    writer.convertToYuv(slot.canvas.getPixels(), slot.yuv);
+                }
+            }
+            catch (const std::exception& e) {
+                slot.error = e.what();
+            }
+            {
+                std::lock_guard<std::mutex> lock(slotMutex);
+                idleWorkers.push_back(worker);
+                slot.done = true;
+            }
+            slotDone.notify_all();
+        });
+    };
+
+    sf::Uint64 submitted = 0;
+    for (sf::Uint64 next = 0; next < frameCount; next++) {
+        while (submitted < frameCount && submitted < next + slots.size()) {
+            submit(submitted++);
+        }
+        FrameSlot& slot = slots[next % slots.size()];
+        {
+            std::unique_lock<std::mutex> lock(slotMutex);
+            slotDone.wait(lock, [&slot]() { return slot.done; });
+        }
+        if (!slot.error.empty()) {
+            throw std::runtime_error(slot.error);
+        }
+        if (writer.getFormat() == FrameWriter::Y4m) {
+            writer.writeY4m(slot.yuv);
+        }
+        slot.done = false;
+    }
+}
+
+/**
+ * @brief Renders a single frame into a canvas of the configured size.
+ * @param index Frame number on the virtual clock.
+ * @param canvas Target canvas.
+ * @param worker State owned by the calling thread.
+ * @throws std::runtime_error If the input cannot be read.
+ */
+void OfflineRenderer::renderFrame(sf::Uint64 index, SoftwareCanvas& canvas, Worker& worker) const {
+    sf::Uint64 playhead = index * sampleRate / options.fps;
+
+    canvas.clear(sf::Color::Black);
+    if (options.mode == Bars) {
+        renderBars(playhead, canvas, worker);
+    }
+    else {
+        renderWave(playhead, canvas);
+    }
+}
+
+/**
+ * @brief Analyses the mono window starting at the playhead and draws it like AudioBars.
+ */
+void OfflineRenderer::renderBars(sf::Uint64 playhead, SoftwareCanvas& canvas, Worker& worker) const {
+    const int fftSize = options.fftSize;
+    const int bars = options.bars;
+
+    if (!worker.opened) {
+        if (!worker.input.openFromFile(options.input)) {
+            throw std::runtime_error("Failed to open file!");
+        }
+        worker.opened = true;
+        worker.analyzer = SpectrumAnalyzer::create(fftSize, bars, options.scale, sampleRate);
+        worker.magnitudes.resize(bars);
+        worker.vertices.resize(4 * bars);
+    }
+
+    std::vector<sf::Int16>& interleaved = worker.interleaved;
+    std::vector<sf::Int16>& mono = worker.mono;
+    interleaved.assign(static_cast<std::size_t>(fftSize) * channels, 0);
+    mono.resize(fftSize);
+
+    worker.input.seek(playhead * channels);
+    worker.input.read(interleaved.data(), interleaved.size());
+
+    dsp::downmix(interleaved.data(), mono.data(), fftSize, channels);
+
+    worker.analyzer->analyze(mono.data(), worker.magnitudes.data());
+    AudioBars::buildBarGeometry(worker.magnitudes.data(), bars, static_cast<float>(canvas.getWidth()), static_cast<float>(canvas.getHeight()), worker.vertices.data());
+    canvas.drawQuads(worker.vertices.data(), 4 * bars);
+}
+
+/**
+ * @brief Draws the waveform that WaveFormAudio would show at the playhead, plus its timeline.
+ */
+void OfflineRenderer::renderWave(sf::Uint64 playhead, SoftwareCanvas& canvas) const {
+    int width = static_cast<int>(canvas.getWidth());
+    int height = static_cast<int>(canvas.getHeight());
+    int graphWidth = width * 4 / 5;
+    int graphHeight = height * 35 / 100;
+    int left = (width - graphWidth) / 2;
+    int top = (height - graphHeight) / 5;
+    int centre = top + graphHeight / 2;
+
+    // One column per video frame of audio, newest on the right, as in the live view.
+    sf::Uint64 framesPerColumn = std::max(1u, sampleRate / options.fps);
+    for (int column = 0; column < graphWidth; column++) {
+        sf::Uint64 age = static_cast<sf::Uint64>(graphWidth - 1 - column) * framesPerColumn;
+        if (age + framesPerColumn > playhead) {
+            continue;
+        }
+        sf::Uint64 end = playhead - age;
+        PeakPyramid::Peak peak = peaks.query(end - framesPerColumn, end);
+        int low = centre + peak.min * graphHeight / 65536;
+        int high = centre + peak.max * graphHeight / 65536;
+        canvas.drawVerticalLine(left + column, low, high, sf::Color::Green);
+    }
+    canvas.fillHorizontalGradient(left, top, left + graphWidth, top + graphHeight, sf::Color::Black, sf::Color::Transparent);
+
+    int timelineY = height * 9 / 10;
+    canvas.fillRect(left, timelineY, left + graphWidth, timelineY + 1, sf::Color::Green);
+    int seekX = left + static_cast<int>(frames ? playhead * graphWidth / frames : 0);
+    canvas.fillRect(seekX - 3, timelineY - 3, seekX + 3, timelineY + 3, sf::Color::Green);
+}
+
+/**
+ * @brief Summarizes the whole file once, with bounded memory.
+ */
+void OfflineRenderer::buildPeaks() {
+    sf::InputSoundFile input;
+    if (!input.openFromFile(options.input)) {
+        throw std::runtime_error("Failed to open file!");
+    }
+
+    peaks.reset(channels, frames);
+    std::vector<sf::Int16> chunk(65536 * channels);
+    while (true) {
+        std::size_t read = static_cast<std::size_t>(input.read(chunk.data(), chunk.size()));
+        peaks.append(chunk.data(), read / channels);
+        if (read < chunk.size()) {
+            break;
+        }
+    }
+    peaks.finish();
+}
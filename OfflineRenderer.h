@@ -0,0 +1,104 @@
+#pragma once
+#include <SFML/Audio.hpp>
+#include <SFML/Graphics.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BandMapping.h"
+#include "PeakPyramid.h"
+
+class SoftwareCanvas;
+class SpectrumAnalyzer;
+
+/**
+ * @class OfflineRenderer
+ * @brief Renders a visualizer for a whole file to disk, without a window and faster than real time.
+ *
+ * Frames are timed by a virtual clock (frame n shows the audio at n / fps seconds)
+ * instead of the sf::Sound playing offset, and drawn into a SoftwareCanvas, so no
+ * display or GL context is needed. Every frame depends only on its own timestamp,
+ * so frames are rendered in parallel on a ThreadPool, a few frames per thread ahead
+ * of the output, and written in order through a FrameWriter.
+ */
+class OfflineRenderer {
+public:
+    /**
+     * @brief Visualizer to render.
+     */
+    enum Mode {
+        Bars,   ///< Spectrum bars, as drawn by AudioBars.
+        Wave    ///< Scrolling waveform, as drawn by WaveFormAudio.
+    };
+
+    /**
+     * @brief What to render and where.
+     */
+    struct Options {
+        Mode mode = Bars;               ///< Visualizer to render.
+        std::string input;              ///< Audio file.
+        std::string output;             ///< ".y4m" file or directory for a PNG sequence.
+        unsigned int width = 1000;      ///< Frame width in pixels.
+        unsigned int height = 600;      ///< Frame height in pixels.
+        unsigned int fps = 60;          ///< Frames per second of audio.
+        unsigned int threads = 0;       ///< Worker threads; 0 uses every core.
+        int fftSize = 512;              ///< Samples per FFT window in bars mode.
+        int bars = 128;                 ///< Number of bars in bars mode.
+        BandMapping::Scale scale = BandMapping::Log; ///< Spacing of the bars in bars mode.
+    };
+
+    /**
+     * @brief Per-thread rendering state, kept across frames.
+     */
+    struct Worker {
+        Worker();
+        ~Worker();
+
+        sf::InputSoundFile input;                   ///< Decoder for bars mode, opened on first use.
+        bool opened;                                ///< True once input has been opened.
+        std::unique_ptr<SpectrumAnalyzer> analyzer; ///< FFT plan for bars mode, created on first use.
+        std::vector<sf::Int16> interleaved;         ///< Window as read from the file.
+        std::vector<sf::Int16> mono;                ///< Window after downmixing.
+        std::vector<float> magnitudes;              ///< Bar magnitudes of the current frame.
+        std::vector<sf::Vertex> vertices;           ///< Bar quads of the current frame.
+    };
+
+    /**
+     * @brief Opens the input file.
+     * @param options What to render and where.
+     * @throws std::runtime_error If the input cannot be opened.
+     */
+    explicit OfflineRenderer(const Options& options);
+
+    /**
+     * @brief Renders every frame of the file and writes it out.
+     * @throws std::runtime_error If the output cannot be written.
+     */
+    void render();
+
+    /**
+     * @brief Renders a single frame into a canvas of the configured size.
+     * @param index Frame number on the virtual clock.
+     * @param canvas Target canvas.
+     * @param worker State owned by the calling thread.
+     * @throws std::runtime_error If the input cannot be read.
+     */
+    void renderFrame(sf::Uint64 index, SoftwareCanvas& canvas, Worker& worker) const;
+
+    /**
+     * @brief Retrieves the number of frames the file spans on the virtual clock.
+     * @return The frame count.
+     */
+    sf::Uint64 getFrameCount() const;
+
+private:
+    void renderBars(sf::Uint64 playhead, SoftwareCanvas& canvas, Worker& worker) const;
+    void renderWave(sf::Uint64 playhead, SoftwareCanvas& canvas) const;
+    void buildPeaks();
+
+    Options options;            ///< What to render and where.
+    unsigned int channels;      ///< Channels of the input file.
+    unsigned int sampleRate;    ///< Sample rate of the input file.
+    sf::Uint64 frames;          ///< Audio frames in the input file.
+    PeakPyramid peaks;          ///< Summary of the file for wave mode.
+};
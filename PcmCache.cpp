@@ -0,0 +1,274 @@
+#include "PcmCache.h"
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+    /**
+     * @brief Reports progress, if anyone listens, and throws if the listener cancelled.
+     */
+    void report(const DecodedAudio::Progress& progress, std::size_t done, std::size_t total) {
+        if (progress && !progress(total > 0 ? static_cast<float>(done) / total : 1.0f)) {
+            throw std::runtime_error("Loading cancelled!");
+        }
+    }
+}
+
+DecodedAudio::DecodedAudio(const std::string& path, const Progress& progress) : samples(nullptr), sampleCount(0) {
+    if (wav.open(path)) {
+        sampleRate = wav.getSampleRate();
+        channels = wav.getChannelCount();
+        sampleCount = static_cast<std::size_t>(wav.getFrameCount() * channels);
+        samples = wav.getInt16();
+        if (!samples) {
+            // Other encodings are converted once, straight from the mapping.
+            storage.resize(sampleCount);
+            std::size_t frames = sampleCount / channels;
+            std::size_t chunkFrames = std::max<std::size_t>(1, DECODE_CHUNK_SAMPLES / channels);
+            for (std::size_t frame = 0; frame < frames; frame += chunkFrames) {
+                report(progress, frame, frames);
+                wav.read(frame, std::min(chunkFrames, frames - frame), storage.data() + frame * channels);
+            }
+            samples = storage.data();
+            wav.close();
+        }
+        else {
+            // Playback starts at the beginning; read its first second ahead.
+            wav.prefetch(0, sampleRate);
+        }
+        report(progress, sampleCount, sampleCount);
+        return;
+    }
+
+    sf::InputSoundFile input;
+    if (!input.openFromFile(path)) {
+        throw std::runtime_error("Failed to open file!");
+    }
+    sampleRate = input.getSampleRate();
+    channels = std::max(1u, input.getChannelCount());
+
+    storage.resize(static_cast<std::size_t>(input.getSampleCount()));
+    std::size_t got = 0;
+    while (got < storage.size()) {
+        report(progress, got, storage.size());
+        std::size_t read = static_cast<std::size_t>(input.read(storage.data() + got, std::min(DECODE_CHUNK_SAMPLES, storage.size() - got)));
+        if (read == 0) {
+            break;
+        }
+        got += read;
+    }
+    storage.resize(got - got % channels);
+    samples = storage.data();
+    sampleCount = storage.size();
+    report(progress, sampleCount, sampleCount);
+}
+
+const sf::Int16* DecodedAudio::getSamples() const {
+    return samples;
+}
+
+std::size_t DecodedAudio::getSampleCount() const {
+    return sampleCount;
+}
+
+DownmixView DecodedAudio::getMix() const {
+    return DownmixView(samples, getFrameCount(), channels);
+}
+
+ChannelView DecodedAudio::getChannel(unsigned int channel) const {
+    return ChannelView(samples, getFrameCount(), channels, channel);
+}
+
+unsigned int DecodedAudio::getSampleRate() const {
+    return sampleRate;
+}
+
+unsigned int DecodedAudio::getChannelCount() const {
+    return channels;
+}
+
+sf::Uint64 DecodedAudio::getFrameCount() const {
+    return sampleCount / channels;
+}
+
+bool DecodedAudio::isMapped() const {
+    return wav.isOpen();
+}
+
+void DecodedAudio::prefetch(sf::Uint64 first, sf::Uint64 count) const {
+    if (wav.isOpen()) {
+        wav.prefetch(first, count);
+    }
+}
+
+std::size_t DecodedAudio::getMemoryUsage() const {
+    return storage.size() * sizeof(sf::Int16);
+}
+
+std::mutex PcmCache::mutex;
+PcmCache::ItemList PcmCache::items;
+std::map<std::string, PcmCache::ItemList::iterator> PcmCache::index;
+std::size_t PcmCache::capacity = PcmCache::DEFAULT_CAPACITY;
+std::size_t PcmCache::usage = 0;
+
+/**
+ * @brief Resolves the path and reads the size and modification time of the file.
+ * @return False if the file does not exist.
+ */
+bool PcmCache::identify(const std::string& path, std::string& canonical, Stamp& stamp) {
+    std::error_code error;
+    std::filesystem::path resolved = std::filesystem::weakly_canonical(path, error);
+    if (error) {
+        return false;
+    }
+    stamp.size = std::filesystem::file_size(resolved, error);
+    if (error) {
+        return false;
+    }
+    std::filesystem::file_time_type modified = std::filesystem::last_write_time(resolved, error);
+    if (error) {
+        return false;
+    }
+    stamp.modified = static_cast<long long>(modified.time_since_epoch().count());
+    canonical = resolved.string();
+    return true;
+}
+
+/**
+ * @brief Finds an entry made from the same file contents and marks it most recently used.
+ * Entries for an older version of the file are dropped. Call with the mutex held.
+ */
+PcmCache::Item* PcmCache::lookup(const std::string& canonical, const Stamp& stamp) {
+    std::map<std::string, ItemList::iterator>::iterator found = index.find(canonical);
+    if (found == index.end()) {
+        return nullptr;
+    }
+    ItemList::iterator item = found->second;
+    if (item->stamp.size != stamp.size || item->stamp.modified != stamp.modified) {
+        usage -= item->bytes;
+        items.erase(item);
+        index.erase(found);
+        return nullptr;
+    }
+    items.splice(items.begin(), items, item);
+    return &*item;
+}
+
+/**
+ * @brief Returns the entry for a file, creating an empty one at the front. Call with the mutex held.
+ */
+PcmCache::Item& PcmCache::insert(const std::string& canonical, const Stamp& stamp) {
+    Item* existing = lookup(canonical, stamp);
+    if (existing) {
+        return *existing;
+    }
+    items.push_front(Item{ canonical, stamp, nullptr, nullptr, 0 });
+    index[canonical] = items.begin();
+    return items.front();
+}
+
+/**
+ * @brief Recomputes the memory charged for an entry. Call with the mutex held.
+ */
+void PcmCache::charge(Item& item) {
+    usage -= item.bytes;
+    // A mapping costs no private memory, but it holds its file open and its address space
+    // reserved; charged at its size, it is evicted like a decoded copy.
+    std::size_t audioBytes = 0;
+    if (item.audio) {
+        audioBytes = item.audio->isMapped() ? item.audio->getSampleCount() * sizeof(sf::Int16) : item.audio->getMemoryUsage();
+    }
+    item.bytes = audioBytes + (item.peaks ? item.peaks->getMemoryUsage() : 0);
+    usage += item.bytes;
+}
+
+/**
+ * @brief Drops least recently used entries until the budget is met. Call with the mutex held.
+ */
+void PcmCache::evict() {
+    while (usage > capacity && !items.empty()) {
+        usage -= items.back().bytes;
+        index.erase(items.back().path);
+        items.pop_back();
+    }
+}
+
+std::shared_ptr<const DecodedAudio> PcmCache::acquire(const std::string& path, const DecodedAudio::Progress& progress) {
+    std::shared_ptr<const DecodedAudio> audio = find(path);
+    if (audio) {
+        return audio;
+    }
+
+    // Decoding takes long; other files stay available meanwhile.
+    audio = std::make_shared<const DecodedAudio>(path, progress);
+
+    std::string canonical;
+    Stamp stamp;
+    if (!identify(path, canonical, stamp)) {
+        return audio;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    Item& item = insert(canonical, stamp);
+    if (item.audio) {
+        // Another thread decoded the same file meanwhile; share its copy.
+        return item.audio;
+    }
+    item.audio = audio;
+    charge(item);
+    evict();
+    return audio;
+}
+
+std::shared_ptr<const DecodedAudio> PcmCache::find(const std::string& path) {
+    std::string canonical;
+    Stamp stamp;
+    if (!identify(path, canonical, stamp)) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    Item* item = lookup(canonical, stamp);
+    return item ? item->audio : nullptr;
+}
+
+std::shared_ptr<const PeakPyramid> PcmCache::findPeaks(const std::string& path) {
+    std::string canonical;
+    Stamp stamp;
+    if (!identify(path, canonical, stamp)) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    Item* item = lookup(canonical, stamp);
+    return item ? item->peaks : nullptr;
+}
+
+void PcmCache::storePeaks(const std::string& path, std::shared_ptr<const PeakPyramid> peaks) {
+    std::string canonical;
+    Stamp stamp;
+    if (!peaks || !identify(path, canonical, stamp)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    Item& item = insert(canonical, stamp);
+    item.peaks = peaks;
+    charge(item);
+    evict();
+}
+
+void PcmCache::setCapacity(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = bytes;
+    evict();
+}
+
+std::size_t PcmCache::getMemoryUsage() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return usage;
+}
+
+void PcmCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    items.clear();
+    index.clear();
+    usage = 0;
+}
@@ -0,0 +1,215 @@
+#pragma once
+#include <SFML/Audio.hpp>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ChannelView.h"
+#include "PeakPyramid.h"
+#include "WavFile.h"
+
+/**
+ * @class DecodedAudio
+ * @brief Whole-file interleaved PCM, immutable once decoded.
+ *
+ * 16-bit WAV files are not decoded at all: the samples are the data chunk of a read-only
+ * mapping, so opening them is O(1) and costs no private memory. Other WAV encodings are
+ * converted from the mapping, and everything else goes through the SFML decoder.
+ *
+ * Instances are only handed out as std::shared_ptr<const DecodedAudio> by PcmCache, so
+ * any number of visualizers and threads can read the same samples without copying them.
+ * Single channels and the mono mix are views into the one interleaved buffer.
+ */
+class DecodedAudio {
+public:
+    /**
+     * @brief Called between decoded chunks with the fraction done, from 0 to 1; returning false cancels the decode.
+     */
+    typedef std::function<bool(float)> Progress;
+
+    static constexpr std::size_t DECODE_CHUNK_SAMPLES = std::size_t(1) << 18; ///< Samples decoded between progress reports.
+
+    /**
+     * @brief Decodes a whole file.
+     * @param path Audio file.
+     * @param progress Optional progress report and cancellation check.
+     * @throws std::runtime_error If the file cannot be decoded, or progress cancelled the decode.
+     */
+    explicit DecodedAudio(const std::string& path, const Progress& progress = Progress());
+
+    DecodedAudio(const DecodedAudio&) = delete;
+    DecodedAudio& operator=(const DecodedAudio&) = delete;
+
+    /**
+     * @brief Retrieves the interleaved samples.
+     * @return getSampleCount() samples.
+     */
+    const sf::Int16* getSamples() const;
+
+    /**
+     * @brief Retrieves the number of interleaved samples.
+     * @return getFrameCount() * getChannelCount().
+     */
+    std::size_t getSampleCount() const;
+
+    /**
+     * @brief Views the mono mix; spans are mixed when read.
+     * @return View over getSamples().
+     */
+    DownmixView getMix() const;
+
+    /**
+     * @brief Views a single channel.
+     * @param channel Channel index, below getChannelCount().
+     * @return Strided view over getSamples().
+     */
+    ChannelView getChannel(unsigned int channel) const;
+
+    /**
+     * @brief Retrieves the sample rate.
+     * @return Frames per second.
+     */
+    unsigned int getSampleRate() const;
+
+    /**
+     * @brief Retrieves the channel count.
+     * @return Samples per frame.
+     */
+    unsigned int getChannelCount() const;
+
+    /**
+     * @brief Retrieves the length of the file.
+     * @return Number of frames.
+     */
+    sf::Uint64 getFrameCount() const;
+
+    /**
+     * @brief Checks whether the samples are read in place from a mapped WAV file.
+     * @return True if getSamples() points into the mapping.
+     */
+    bool isMapped() const;
+
+    /**
+     * @brief Asks the kernel to read a span of a mapped file ahead of use; does nothing otherwise.
+     * @param first First frame.
+     * @param count Number of frames.
+     */
+    void prefetch(sf::Uint64 first, sf::Uint64 count) const;
+
+    /**
+     * @brief Retrieves the private memory held by the samples; mapped pages belong to the page cache.
+     * @return Size in bytes.
+     */
+    std::size_t getMemoryUsage() const;
+
+private:
+    WavFile wav;                                ///< Mapping the samples are read from in place, if any.
+    std::vector<sf::Int16> storage;             ///< Decoded samples when the file is not mapped.
+    const sf::Int16* samples;                   ///< Interleaved samples, in the mapping or in storage.
+    std::size_t sampleCount;                    ///< Number of interleaved samples.
+    unsigned int sampleRate;                    ///< Frames per second.
+    unsigned int channels;                      ///< Samples per frame.
+};
+
+/**
+ * @class PcmCache
+ * @brief Process-wide, size-bounded LRU cache of decoded files and their peak pyramids.
+ *
+ * A session touches the same file several times: MainWindow loads it to play it, every
+ * visualizer loads it again, and the AnalysisBus summarizes it. Entries are keyed by the
+ * canonical path and stamped with the file size and modification time, so an edited file
+ * is decoded again while switching modes or replaying an unchanged one costs a lookup.
+ *
+ * Entries are shared and immutable. Evicting one only drops the cache's reference; users
+ * that still hold it keep it alive.
+ */
+class PcmCache {
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = std::size_t(1) << 30; ///< 1 GiB of samples and pyramids.
+
+    /**
+     * @brief Returns the decoded file, decoding it on a miss.
+     * @param path Audio file.
+     * @param progress Optional progress report and cancellation check, called only while decoding.
+     * @return Shared samples; valid even if the entry is evicted later.
+     * @throws std::runtime_error If the file cannot be decoded, or progress cancelled the decode.
+     */
+    static std::shared_ptr<const DecodedAudio> acquire(const std::string& path, const DecodedAudio::Progress& progress = DecodedAudio::Progress());
+
+    /**
+     * @brief Returns the decoded file if it is cached and unchanged on disk.
+     * @param path Audio file.
+     * @return Shared samples, or nullptr.
+     */
+    static std::shared_ptr<const DecodedAudio> find(const std::string& path);
+
+    /**
+     * @brief Returns the finished peak pyramid of a file if it is cached and unchanged on disk.
+     * @param path Audio file.
+     * @return Shared pyramid, or nullptr.
+     */
+    static std::shared_ptr<const PeakPyramid> findPeaks(const std::string& path);
+
+    /**
+     * @brief Stores the finished peak pyramid of a file, whether or not its samples are cached.
+     * @param path Audio file.
+     * @param peaks Pyramid on which finish() has been called.
+     */
+    static void storePeaks(const std::string& path, std::shared_ptr<const PeakPyramid> peaks);
+
+    /**
+     * @brief Sets the memory budget and evicts least recently used entries down to it.
+     * @param bytes Budget in bytes; 0 disables caching.
+     */
+    static void setCapacity(std::size_t bytes);
+
+    /**
+     * @brief Retrieves the memory charged for the cached entries; mapped files count at their mapped size.
+     * @return Size in bytes.
+     */
+    static std::size_t getMemoryUsage();
+
+    /**
+     * @brief Drops every entry.
+     */
+    static void clear();
+
+private:
+    /**
+     * @brief Identity of the file contents an entry was made from.
+     */
+    struct Stamp {
+        std::uintmax_t size;    ///< File size in bytes.
+        long long modified;     ///< Modification time, in ticks of the file clock.
+    };
+
+    /**
+     * @brief A cached file, most recently used first in the LRU list.
+     */
+    struct Item {
+        std::string path;                           ///< Canonical path.
+        Stamp stamp;                                ///< File identity when the entry was made.
+        std::shared_ptr<const DecodedAudio> audio;  ///< Decoded samples, or nullptr.
+        std::shared_ptr<const PeakPyramid> peaks;   ///< Finished pyramid, or nullptr.
+        std::size_t bytes;                          ///< Memory charged for audio, mapped or decoded, and peaks.
+    };
+
+    typedef std::list<Item> ItemList;
+
+    static bool identify(const std::string& path, std::string& canonical, Stamp& stamp);
+    static Item* lookup(const std::string& canonical, const Stamp& stamp);
+    static Item& insert(const std::string& canonical, const Stamp& stamp);
+    static void charge(Item& item);
+    static void evict();
+
+    static std::mutex mutex;                                    ///< Guards every field below.
+    static ItemList items;                                      ///< Entries, most recently used first.
+    static std::map<std::string, ItemList::iterator> index;     ///< Entries by canonical path.
+    static std::size_t capacity;                                ///< Memory budget in bytes.
+    static std::size_t usage;                                   ///< Memory charged to the entries.
+};
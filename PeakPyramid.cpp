@@ -0,0 +1,193 @@
+#include "PeakPyramid.h"
+#include <algorithm>
+#include <cmath>
+
+#include "DspKernels.h"
+
+namespace {
+    const float EMPTY_SUM = 0.0f;
+    const std::size_t DOWNMIX_BLOCK = 1024;    ///< Frames downmixed per step of append().
+}
+
+PeakPyramid::PeakPyramid() : channels(1), totalFrames(0), appendedFrames(0), builtFrames(0), finished(false), pending{ 32767, -32768, EMPTY_SUM }, pendingFrames(0) { }
+
+/**
+ * @brief Drops the previous file and allocates the levels for a new one.
+ * @param channelCount Number of interleaved channels passed to append().
+ * @param frames Number of frames that will be appended.
+ */
+void PeakPyramid::reset(unsigned int channelCount, sf::Uint64 frames) {
+    channels = std::max(1u, channelCount);
+    totalFrames = frames;
+    appendedFrames = 0;
+    builtFrames = 0;
+    finished = false;
+    pending = Entry{ 32767, -32768, EMPTY_SUM };
+    pendingFrames = 0;
+
+    levels.clear();
+    counts.clear();
+    std::size_t entries = static_cast<std::size_t>((frames + BASE_BLOCK - 1) / BASE_BLOCK);
+    while (entries > 0) {
+        levels.emplace_back(entries);
+        counts.push_back(0);
+        if (entries == 1) {
+            break;
+        }
+        entries = (entries + 1) / 2;
+    }
+}
+
+/**
+ * @brief Adds interleaved frames; they are downmixed to mono on the fly.
+ * @param samples Interleaved samples.
+ * @param frames Number of frames (samples per channel).
+ */
+void PeakPyramid::append(const sf::Int16* samples, std::size_t frames) {
+    frames = static_cast<std::size_t>(std::min<sf::Uint64>(frames, totalFrames - appendedFrames));
+
+    if (channels == 1) {
+        accumulate(samples, frames);
+    }
+    else if (channels == 2) {
+        sf::Int16 mono[DOWNMIX_BLOCK];
+        for (std::size_t done = 0; done < frames; done += DOWNMIX_BLOCK) {
+            std::size_t count = std::min(DOWNMIX_BLOCK, frames - done);
+            dsp::downmixStereo(samples + 2 * done, mono, count);
+            accumulate(mono, count);
+        }
+    }
+    else {
+        sf::Int16 mono[DOWNMIX_BLOCK];
+        for (std::size_t done = 0; done < frames; done += DOWNMIX_BLOCK) {
+            std::size_t count = std::min(DOWNMIX_BLOCK, frames - done);
+            for (std::size_t i = 0; i < count; i++) {
+                int sum = 0;
+                for (unsigned int c = 0; c < channels; c++) {
+                    sum += samples[(done + i) * channels + c];
+                }
+                mono[i] = static_cast<sf::Int16>(sum / static_cast<int>(channels));
+            }
+            accumulate(mono, count);
+        }
+    }
+    appendedFrames += frames;
+}
+
+/**
+ * @brief Folds mono frames into the level-0 block being accumulated.
+ */
+void PeakPyramid::accumulate(const sf::Int16* mono, std::size_t frames) {
+    for (std::size_t i = 0; i < frames; i++) {
+        pending.min = std::min(pending.min, mono[i]);
+        pending.max = std::max(pending.max, mono[i]);
+        pending.sumSquares += static_cast<float>(mono[i]) * mono[i];
+
+        if (++pendingFrames == BASE_BLOCK) {
+            push(0, pending);
+            pending = Entry{ 32767, -32768, EMPTY_SUM };
+            pendingFrames = 0;
+            builtFrames.store(builtFrames.load(std::memory_order_relaxed) + BASE_BLOCK, std::memory_order_release);
+        }
+    }
+}
+
+/**
+ * @brief Summarizes the last, partial blocks once all frames have been appended.
+ */
+void PeakPyramid::finish() {
+    if (levels.empty()) {
+        return;
+    }
+
+    if (pendingFrames > 0) {
+        levels[0][counts[0]++] = pending;
+        pendingFrames = 0;
+    }
+
+    // Entries left without a sibling are promoted on their own.
+    for (std::size_t level = 0; level + 1 < levels.size(); level++) {
+        std::size_t wanted = (counts[level] + 1) / 2;
+        for (std::size_t i = counts[level + 1]; i < wanted; i++) {
+            std::size_t child = 2 * i;
+            levels[level + 1][i] = child + 1 < counts[level] ? merge(levels[level][child], levels[level][child + 1]) : levels[level][child];
+        }
+        counts[level + 1] = wanted;
+    }
+
+    builtFrames.store(appendedFrames, std::memory_order_release);
+    finished.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief Summarizes a span of frames in O(1).
+ * @param first First frame of the span.
+ * @param last One past the last frame of the span.
+ * @return The peak range of the span; spans shorter than BASE_BLOCK get the enclosing block.
+ */
+PeakPyramid::Peak PeakPyramid::query(sf::Uint64 first, sf::Uint64 last) const {
+    sf::Uint64 built = builtFrames.load(std::memory_order_acquire);
+    bool complete = finished.load(std::memory_order_acquire);
+    last = std::min(last, built);
+    if (first >= last) {
+        return Peak{ 0, 0, 0.0f };
+    }
+
+    // Largest level whose blocks still fit into the span at least twice: at most five entries.
+    std::size_t level = 0;
+    sf::Uint64 span = last - first;
+    while (level + 1 < levels.size() && (static_cast<sf::Uint64>(BASE_BLOCK) << (level + 2)) <= span) {
+        level++;
+    }
+
+    sf::Uint64 start = first / (static_cast<sf::Uint64>(BASE_BLOCK) << level) * (static_cast<sf::Uint64>(BASE_BLOCK) << level);
+    sf::Uint64 position = start;
+    Entry total{ 32767, -32768, EMPTY_SUM };
+
+    // While building, the newest frames are not summarized at the upper levels yet;
+    // they are picked up from the levels below, at most one entry per level.
+    for (std::size_t current = level + 1; current-- > 0 && position < last; ) {
+        sf::Uint64 blockFrames = static_cast<sf::Uint64>(BASE_BLOCK) << current;
+        sf::Uint64 available = complete ? (built + blockFrames - 1) / blockFrames : built / blockFrames;
+        sf::Uint64 end = std::min((last - 1) / blockFrames + 1, available);
+
+        for (sf::Uint64 i = position / blockFrames; i < end; i++) {
+            total = merge(total, levels[current][static_cast<std::size_t>(i)]);
+        }
+        position = std::max(position, end * blockFrames);
+    }
+
+    sf::Uint64 covered = std::min(position, built) - start;
+    if (covered == 0) {
+        return Peak{ 0, 0, 0.0f };
+    }
+    return Peak{ total.min, total.max, std::sqrt(total.sumSquares / static_cast<float>(covered)) };
+}
+
+sf::Uint64 PeakPyramid::getBuiltFrames() const {
+    return builtFrames.load(std::memory_order_acquire);
+}
+
+std::size_t PeakPyramid::getMemoryUsage() const {
+    std::size_t bytes = 0;
+    for (const std::vector<Entry>& level : levels) {
+        bytes += level.capacity() * sizeof(Entry);
+    }
+    return bytes;
+}
+
+PeakPyramid::Entry PeakPyramid::merge(const Entry& a, const Entry& b) {
+    return Entry{ std::min(a.min, b.min), std::max(a.max, b.max), a.sumSquares + b.sumSquares };
+}
+
+/**
+ * @brief Stores a complete entry and builds the parents it completes.
+ */
+void PeakPyramid::push(std::size_t level, const Entry& entry) {
+    std::size_t index = counts[level]++;
+    levels[level][index] = entry;
+
+    if (index % 2 == 1 && level + 1 < levels.size()) {
+        push(level + 1, merge(levels[level][index - 1], entry));
+    }
+}
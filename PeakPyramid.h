@@ -0,0 +1,99 @@
+#pragma once
+#include <SFML/Audio.hpp>
+#include <atomic>
+#include <vector>
+
+/**
+ * @class PeakPyramid
+ * @brief Mip-mapped min/max/RMS summary of a file, built once per file.
+ *
+ * Level 0 summarizes blocks of BASE_BLOCK mono frames, and every level above halves
+ * the resolution. A query over any span picks the level whose blocks are about a
+ * quarter of the span wide and combines at most a handful of entries, so a pixel
+ * column costs the same whether it covers ten milliseconds or ten minutes. The whole
+ * pyramid takes about half a byte per frame, a fraction of even a mono 16-bit copy.
+ *
+ * Levels are allocated up front from the expected frame count, so one thread may
+ * append() while another thread queries the part that has already been built.
+ */
+class PeakPyramid {
+public:
+    static constexpr std::size_t BASE_BLOCK = 32;   ///< Frames summarized by one level-0 entry.
+
+    /**
+     * @brief Summary of a span of frames.
+     */
+    struct Peak {
+        sf::Int16 min;  ///< Lowest mono sample.
+        sf::Int16 max;  ///< Highest mono sample.
+        float rms;      ///< Root mean square of the mono samples.
+    };
+
+    /**
+     * @brief Default constructor; the pyramid is empty.
+     */
+    PeakPyramid();
+
+    /**
+     * @brief Drops the previous file and allocates the levels for a new one.
+     * @param channels Number of interleaved channels passed to append().
+     * @param totalFrames Number of frames that will be appended.
+     */
+    void reset(unsigned int channels, sf::Uint64 totalFrames);
+
+    /**
+     * @brief Adds interleaved frames; they are downmixed to mono on the fly.
+     * @param samples Interleaved samples.
+     * @param frames Number of frames (samples per channel).
+     */
+    void append(const sf::Int16* samples, std::size_t frames);
+
+    /**
+     * @brief Summarizes the last, partial blocks once all frames have been appended.
+     */
+    void finish();
+
+    /**
+     * @brief Summarizes a span of frames in O(1).
+     * @param first First frame of the span.
+     * @param last One past the last frame of the span.
+     * @return The peak range of the span; spans shorter than BASE_BLOCK get the enclosing block.
+     */
+    Peak query(sf::Uint64 first, sf::Uint64 last) const;
+
+    /**
+     * @brief Retrieves the number of frames that can be queried so far.
+     * @return The built frame count.
+     */
+    sf::Uint64 getBuiltFrames() const;
+
+    /**
+     * @brief Retrieves the memory held by all levels.
+     * @return Size in bytes.
+     */
+    std::size_t getMemoryUsage() const;
+
+private:
+    /**
+     * @brief Summary of one block at one level.
+     */
+    struct Entry {
+        sf::Int16 min;      ///< Lowest mono sample of the block.
+        sf::Int16 max;      ///< Highest mono sample of the block.
+        float sumSquares;   ///< Sum of the squared mono samples of the block.
+    };
+
+    static Entry merge(const Entry& a, const Entry& b);
+    void accumulate(const sf::Int16* mono, std::size_t frames);
+    void push(std::size_t level, const Entry& entry);
+
+    std::vector<std::vector<Entry>> levels; ///< levels[k] has one entry per BASE_BLOCK << k frames.
+    std::vector<std::size_t> counts;        ///< Entries written per level.
+    unsigned int channels;                  ///< Number of interleaved channels.
+    sf::Uint64 totalFrames;                 ///< Expected number of frames.
+    sf::Uint64 appendedFrames;              ///< Frames passed to append() so far.
+    std::atomic<sf::Uint64> builtFrames;    ///< Frames covered by complete level-0 entries.
+    std::atomic<bool> finished;             ///< Set by finish(); partial blocks are then summarized too.
+    Entry pending;                          ///< Level-0 block being accumulated.
+    std::size_t pendingFrames;              ///< Frames in pending.
+};
@@ -0,0 +1,262 @@
+#include "PitchAnalyzer.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "DspKernels.h"
+#include "FftPlanCache.h"
+
+namespace {
+    const float MAJOR_PROFILE[12] = { 6.35f, 2.23f, 3.48f, 2.33f, 4.38f, 4.09f, 2.52f, 5.19f, 2.39f, 3.66f, 2.29f, 2.88f }; ///< Krumhansl-Kessler, C major.
+    const float MINOR_PROFILE[12] = { 6.33f, 2.68f, 3.52f, 5.38f, 2.60f, 3.53f, 2.54f, 4.75f, 3.98f, 2.69f, 3.34f, 3.17f }; ///< Krumhansl-Kessler, C minor.
+
+    const char* const CHORD_NAMES[24] = {
+        "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B",
+        "Cm", "C#m", "Dm", "D#m", "Em", "Fm", "F#m", "Gm", "G#m", "Am", "A#m", "Bm"
+    };
+
+    /**
+     * @brief Key profiles with their mean removed and unit length, so a dot product is a correlation.
+     */
+    struct KeyProfiles {
+        float major[12];
+        float minor[12];
+
+        KeyProfiles() {
+            normalize(MAJOR_PROFILE, major);
+            normalize(MINOR_PROFILE, minor);
+        }
+
+        static void normalize(const float* profile, float* result) {
+            float mean = 0.0f;
+            for (int i = 0; i < 12; i++) {
+                mean += profile[i] / 12.0f;
+            }
+            float length = 0.0f;
+            for (int i = 0; i < 12; i++) {
+                result[i] = profile[i] - mean;
+                length += result[i] * result[i];
+            }
+            for (int i = 0; i < 12; i++) {
+                result[i] /= std::sqrt(length);
+            }
+        }
+    };
+}
+
+PitchAnalyzer::PitchAnalyzer() : windowSize(0), sampleRate(0), minLag(1), maxLag(2), keyDecay(1.0f), in(nullptr), out(nullptr), plan(nullptr),
+    keyChroma(), energy(0.0f) { }
+
+PitchAnalyzer::~PitchAnalyzer() {
+    fftwf_free(out);
+    fftwf_free(in);
+}
+
+void PitchAnalyzer::configure(int windowSize, unsigned int sampleRate, std::size_t hopFrames) {
+    if (windowSize < FftPlanCache::MIN_SIZE || windowSize > FftPlanCache::MAX_SIZE || (windowSize & (windowSize - 1)) != 0 || sampleRate == 0) {
+        throw std::runtime_error("Unsupported pitch window size!");
+    }
+    if (windowSize != this->windowSize) {
+        plan = FftPlanCache::acquire(windowSize, FftPlanCache::RealToComplex);
+        fftwf_free(out);
+        fftwf_free(in);
+        in = static_cast<float*>(fftwf_malloc(sizeof(float) * windowSize));
+        out = static_cast<fftwf_complex*>(fftwf_malloc(sizeof(fftwf_complex) * (windowSize / 2 + 1)));
+    }
+    this->windowSize = windowSize;
+    this->sampleRate = sampleRate;
+
+    // The difference is summed over the first half of the window, so lags reach at most the other half.
+    maxLag = std::min<std::size_t>(windowSize / 2, static_cast<std::size_t>(std::ceil(sampleRate / MIN_FREQUENCY)));
+    minLag = std::min(maxLag - 1, std::max<std::size_t>(2, static_cast<std::size_t>(sampleRate / MAX_FREQUENCY)));
+    signal.assign(windowSize, 0.0f);
+    difference.assign(maxLag + 2, 0.0f);
+
+    const double pi = 3.14159265358979323846;
+    window.resize(windowSize);
+    for (int i = 0; i < windowSize; i++) {
+        window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * i / windowSize));
+    }
+
+    binClass.assign(windowSize / 2 + 1, -1);
+    for (int k = 1; k <= windowSize / 2; k++) {
+        double frequency = static_cast<double>(k) * sampleRate / windowSize;
+        if (frequency >= MIN_CHROMA_FREQUENCY && frequency <= MAX_CHROMA_FREQUENCY) {
+            // MIDI note 60 is middle C, so the note number modulo 12 counts semitones from C.
+            long note = std::lround(69.0 + 12.0 * std::log2(frequency / 440.0));
+            binClass[k] = static_cast<int>(((note % 12) + 12) % 12);
+        }
+    }
+
+    double windowsPerSecond = static_cast<double>(sampleRate) / std::max<std::size_t>(1, hopFrames);
+    keyDecay = static_cast<float>(std::exp(-1.0 / (KEY_SECONDS * windowsPerSecond)));
+    reset();
+}
+
+void PitchAnalyzer::reset() {
+    keyChroma.fill(0.0f);
+    features = Features();
+}
+
+void PitchAnalyzer::analyze(const sf::Int16* samples) {
+    dsp::convert(samples, signal.data(), windowSize, 1.0f / 32768.0f);
+    energy = 0.0f;
+    for (int i = 0; i < windowSize; i++) {
+        energy += signal[i] * signal[i];
+    }
+    energy /= windowSize;
+
+    estimateFrequency();
+    computeChroma();
+    matchChord();
+    matchKey();
+}
+
+/**
+ * @brief YIN on the converted window: difference per lag, cumulative mean normalisation, first dip below the threshold.
+ */
+void PitchAnalyzer::estimateFrequency() {
+    features.frequency = 0.0f;
+    features.periodicity = 0.0f;
+    if (energy < SILENCE_ENERGY) {
+        return;
+    }
+
+    std::size_t span = static_cast<std::size_t>(windowSize / 2);
+    const float* x = signal.data();
+    // The normalisation needs the running sum from lag 1, so the short lags are computed too.
+    difference[0] = 1.0f;
+    float runningSum = 0.0f;
+    for (std::size_t lag = 1; lag <= maxLag; lag++) {
+        float d = dsp::squaredDistance(x, x + lag, span);
+        runningSum += d;
+        difference[lag] = runningSum > 0.0f ? d * lag / runningSum : 1.0f;
+    }
+
+    std::size_t best = 0;
+    for (std::size_t lag = minLag; lag < maxLag; lag++) {
+        if (difference[lag] < YIN_THRESHOLD) {
+            // Follow the dip down to its bottom.
+            while (lag + 1 < maxLag && difference[lag + 1] < difference[lag]) {
+                lag++;
+            }
+            best = lag;
+            break;
+        }
+    }
+    if (best == 0) {
+        best = static_cast<std::size_t>(std::min_element(difference.begin() + minLag, difference.begin() + maxLag) - difference.begin());
+        if (difference[best] > UNVOICED_THRESHOLD) {
+            return;
+        }
+    }
+
+    // Refine the period between lags with a parabola through the dip and its neighbours.
+    // The difference is known from lag 1 to maxLag, so this works at minLag too; there the
+    // dip may still be falling towards shorter lags, so the shift stays within half a lag.
+    double period = static_cast<double>(best);
+    if (best + 1 <= maxLag) {
+        double left = difference[best - 1], centre = difference[best], right = difference[best + 1];
+        double curvature = left - 2.0 * centre + right;
+        if (curvature > 0.0) {
+            period += std::min(0.5, std::max(-0.5, 0.5 * (left - right) / curvature));
+        }
+    }
+    features.frequency = static_cast<float>(sampleRate / period);
+    features.periodicity = std::max(0.0f, 1.0f - difference[best]);
+}
+
+/**
+ * @brief Folds the bin magnitudes of the windowed FFT onto the 12 pitch classes.
+ */
+void PitchAnalyzer::computeChroma() {
+    features.chroma.fill(0.0f);
+    if (energy < SILENCE_ENERGY) {
+        return;
+    }
+    std::copy(signal.begin(), signal.end(), in);
+    dsp::multiply(in, window.data(), windowSize);
+    fftwf_execute_dft_r2c(plan, in, out);
+
+    for (std::size_t k = 0; k < binClass.size(); k++) {
+        if (binClass[k] >= 0) {
+            features.chroma[binClass[k]] += std::sqrt(out[k][0] * out[k][0] + out[k][1] * out[k][1]);
+        }
+    }
+    float largest = *std::max_element(features.chroma.begin(), features.chroma.end());
+    if (largest > 0.0f) {
+        for (float& value : features.chroma) {
+            value /= largest;
+        }
+    }
+}
+
+/**
+ * @brief Picks the major or minor triad whose notes hold the most chroma energy.
+ */
+void PitchAnalyzer::matchChord() {
+    features.chord = -1;
+    float bestScore = 0.0f;
+    for (int root = 0; root < 12; root++) {
+        float fifth = features.chroma[(root + 7) % 12] + features.chroma[root];
+        float major = fifth + features.chroma[(root + 4) % 12];
+        float minor = fifth + features.chroma[(root + 3) % 12];
+        if (major > bestScore) {
+            bestScore = major;
+            features.chord = root;
+        }
+        if (minor > bestScore) {
+            bestScore = minor;
+            features.chord = root + 12;
+        }
+    }
+}
+
+/**
+ * @brief Adds the chroma to the decaying average and correlates it with the 24 key profiles.
+ */
+void PitchAnalyzer::matchKey() {
+    static const KeyProfiles profiles;
+    float mean = 0.0f;
+    for (int i = 0; i < 12; i++) {
+        keyChroma[i] = keyDecay * keyChroma[i] + features.chroma[i];
+        mean += keyChroma[i] / 12.0f;
+    }
+    if (mean <= 0.0f) {
+        return;
+    }
+
+    float bestScore = -2.0f;
+    for (int root = 0; root < 12; root++) {
+        float major = 0.0f, minor = 0.0f;
+        for (int i = 0; i < 12; i++) {
+            float value = keyChroma[(root + i) % 12] - mean;
+            major += value * profiles.major[i];
+            minor += value * profiles.minor[i];
+        }
+        if (major > bestScore) {
+            bestScore = major;
+            features.key = root;
+        }
+        if (minor > bestScore) {
+            bestScore = minor;
+            features.key = root + 12;
+        }
+    }
+}
+
+const PitchAnalyzer::Features& PitchAnalyzer::getFeatures() const {
+    return features;
+}
+
+int PitchAnalyzer::getWindowSize() const {
+    return windowSize;
+}
+
+unsigned int PitchAnalyzer::getSampleRate() const {
+    return sampleRate;
+}
+
+const char* PitchAnalyzer::chordName(int chord) {
+    return chord >= 0 && chord < 24 ? CHORD_NAMES[chord] : "";
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <SFML/Config.hpp>
+#include <fftw3.h>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class PitchAnalyzer
+ * @brief Fundamental frequency, chroma, chord and key of one window of samples.
+ *
+ * The fundamental comes from YIN: the difference function of the window against itself
+ * at every lag, one dsp::squaredDistance() call per lag, normalised by its cumulative
+ * mean; the first dip below a threshold gives the period. Chroma folds the magnitudes
+ * of an FFT of the same window onto the 12 pitch classes through a bin table built in
+ * configure(). The chord is the best matching major or minor triad of the chroma, and
+ * the key the best matching Krumhansl-Kessler profile of a decaying chroma average.
+ *
+ * configure() allocates and fetches the FFT plan from FftPlanCache; analyze() never
+ * allocates and takes no lock, so one instance per thread can run next to the spectrum
+ * analysis.
+ */
+class PitchAnalyzer {
+public:
+    static constexpr int WINDOW_SIZE = 4096;            ///< Default window; long enough for YIN down to MIN_FREQUENCY.
+    static constexpr float MIN_FREQUENCY = 50.0f;       ///< Lowest fundamental searched, in Hz.
+    static constexpr float MAX_FREQUENCY = 2000.0f;     ///< Highest fundamental searched, in Hz.
+
+    /**
+     * @brief Features of the last window.
+     */
+    struct Features {
+        std::array<float, 12> chroma{}; ///< Energy per pitch class from C, scaled so the largest is 1; all 0 in silence.
+        float frequency = 0.0f;         ///< Fundamental in Hz; 0 if the window is not periodic.
+        float periodicity = 0.0f;       ///< How periodic the window is, from 0 to 1.
+        int chord = -1;                 ///< Best matching triad, see chordName(); -1 in silence.
+        int key = -1;                   ///< Best matching key so far, see chordName(); -1 until there was sound.
+    };
+
+    /**
+     * @brief Creates an analyzer that needs configure() before use.
+     */
+    PitchAnalyzer();
+
+    /**
+     * @brief Frees the FFT buffers; the plan stays in FftPlanCache.
+     */
+    ~PitchAnalyzer();
+
+    PitchAnalyzer(const PitchAnalyzer&) = delete;
+    PitchAnalyzer& operator=(const PitchAnalyzer&) = delete;
+
+    /**
+     * @brief Sizes the buffers and tables and clears the key history. Allocates.
+     * @param windowSize Samples per window; a power of two of at least 2 * sampleRate / MIN_FREQUENCY
+     * for the full pitch range, shorter windows raise the lowest fundamental found.
+     * @param sampleRate Frames per second.
+     * @param hopFrames Frames between consecutive windows; sets how fast the key follows the music.
+     * @throws std::runtime_error If the window size is not supported.
+     */
+    void configure(int windowSize, unsigned int sampleRate, std::size_t hopFrames);
+
+    /**
+     * @brief Forgets the key history, keeping the configuration.
+     */
+    void reset();
+
+    /**
+     * @brief Analyses the next window.
+     * @param samples Mono samples, as many as the window size.
+     */
+    void analyze(const sf::Int16* samples);
+
+    /**
+     * @brief Retrieves the features of the last window.
+     * @return Features.
+     */
+    const Features& getFeatures() const;
+
+    /**
+     * @brief Retrieves the number of samples per window.
+     * @return Window size; 0 before configure().
+     */
+    int getWindowSize() const;
+
+    /**
+     * @brief Retrieves the sample rate the tables were built for.
+     * @return Frames per second; 0 before configure().
+     */
+    unsigned int getSampleRate() const;
+
+    /**
+     * @brief Names a chord or key.
+     * @param chord Root from 0 (C) to 11 (B), plus 12 for minor.
+     * @return E.g. "F#" or "Am"; an empty string for -1.
+     */
+    static const char* chordName(int chord);
+
+private:
+    void estimateFrequency();
+    void computeChroma();
+    void matchChord();
+    void matchKey();
+
+    static constexpr float YIN_THRESHOLD = 0.15f;       ///< Normalised difference below which a lag is a period.
+    static constexpr float UNVOICED_THRESHOLD = 0.4f;   ///< Smallest normalised difference above which there is no pitch.
+    static constexpr float MIN_CHROMA_FREQUENCY = 80.0f;   ///< Lowest bin folded into the chroma, in Hz.
+    static constexpr float MAX_CHROMA_FREQUENCY = 5000.0f; ///< Highest bin folded into the chroma, in Hz.
+    static constexpr float SILENCE_ENERGY = 1e-6f;      ///< Mean squared sample below which a window is silent.
+    static constexpr float KEY_SECONDS = 10.0f;         ///< Time constant of the chroma average the key is taken from.
+
+    int windowSize;                     ///< Samples per window.
+    unsigned int sampleRate;            ///< Frames per second.
+    std::size_t minLag;                 ///< Shortest period searched, at MAX_FREQUENCY.
+    std::size_t maxLag;                 ///< Longest period searched, at MIN_FREQUENCY or half the window.
+    float keyDecay;                     ///< Per-window decay of keyChroma.
+
+    std::vector<float> signal;          ///< Window converted to float.
+    std::vector<float> difference;      ///< YIN difference, then its cumulative mean normalised form, per lag.
+    std::vector<float> window;          ///< Hann window for the chroma FFT.
+    std::vector<int> binClass;          ///< Pitch class of every FFT bin; -1 outside the chroma range.
+    float* in;                          ///< FFT input buffer.
+    fftwf_complex* out;                 ///< FFT output buffer.
+    fftwf_plan plan;                    ///< Shared plan for the real-to-complex transform.
+
+    std::array<float, 12> keyChroma;    ///< Decaying average of the chroma.
+    float energy;                       ///< Mean squared sample of the last window.
+    Features features;                  ///< Features of the last window.
+};
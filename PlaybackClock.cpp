@@ -0,0 +1,136 @@
+#include "PlaybackClock.h"
+#include <algorithm>
+
+namespace {
+    const sf::Int64 RESYNC_MILLISECONDS = 50;   ///< Larger differences from the driver re-anchor at once.
+    const sf::Int64 SLEW_DIVISOR = 4;           ///< Smaller ones are corrected by this fraction per reading.
+}
+
+PlaybackClock::PlaybackClock() : sequence(0), frame(0), time(0), sampleRate(44100), channels(2), frameCount(0),
+    playing(false), lastDriverFrame(0) { }
+
+sf::Int64 PlaybackClock::nanoseconds(Clock::time_point when) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(when.time_since_epoch()).count();
+}
+
+/**
+ * @brief Publishes a new anchor; readers retry while it is half written.
+ */
+void PlaybackClock::publish(const Snapshot& state) {
+    sf::Uint32 start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    frame.store(state.frame, std::memory_order_relaxed);
+    time.store(state.time, std::memory_order_relaxed);
+    sampleRate.store(state.sampleRate, std::memory_order_relaxed);
+    channels.store(state.channels, std::memory_order_relaxed);
+    frameCount.store(state.frameCount, std::memory_order_relaxed);
+    playing.store(state.playing, std::memory_order_relaxed);
+
+    sequence.store(start + 2, std::memory_order_release);
+}
+
+PlaybackClock::Snapshot PlaybackClock::snapshot() const {
+    Snapshot state;
+    for (;;) {
+        sf::Uint32 before = sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        state.frame = frame.load(std::memory_order_relaxed);
+        state.time = time.load(std::memory_order_relaxed);
+        state.sampleRate = sampleRate.load(std::memory_order_relaxed);
+        state.channels = channels.load(std::memory_order_relaxed);
+        state.frameCount = frameCount.load(std::memory_order_relaxed);
+        state.playing = playing.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) {
+            return state;
+        }
+    }
+}
+
+sf::Uint64 PlaybackClock::frameAt(const Snapshot& state, sf::Int64 when) {
+    sf::Uint64 result = state.frame;
+    if (state.playing && when > state.time) {
+        result += static_cast<sf::Uint64>((when - state.time) * static_cast<sf::Int64>(state.sampleRate) / 1000000000);
+    }
+    return state.frameCount ? std::min(result, state.frameCount) : result;
+}
+
+void PlaybackClock::reset(unsigned int rate, unsigned int channelCount, sf::Uint64 frames) {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    Snapshot state;
+    state.frame = 0;
+    state.time = nanoseconds(Clock::now());
+    state.sampleRate = std::max(1u, rate);
+    state.channels = std::max(1u, channelCount);
+    state.frameCount = frames;
+    state.playing = false;
+    lastDriverFrame = 0;
+    publish(state);
+}
+
+void PlaybackClock::update(sf::Time offset, bool nowPlaying) {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    Snapshot state = snapshot();
+    sf::Int64 now = nanoseconds(Clock::now());
+    sf::Uint64 driverFrame = static_cast<sf::Uint64>(offset.asMicroseconds()) * state.sampleRate / 1000000;
+
+    if (!nowPlaying || !state.playing) {
+        // Starting, pausing or stopped: the driver position is exact while nothing advances.
+        lastDriverFrame = driverFrame;
+        state.frame = driverFrame;
+        state.time = now;
+        state.playing = nowPlaying;
+        publish(state);
+        return;
+    }
+
+    // The driver position moves in steps; between them the extrapolation is better.
+    if (driverFrame == lastDriverFrame) {
+        return;
+    }
+    lastDriverFrame = driverFrame;
+
+    sf::Int64 predicted = static_cast<sf::Int64>(frameAt(state, now));
+    sf::Int64 error = static_cast<sf::Int64>(driverFrame) - predicted;
+    sf::Int64 resync = static_cast<sf::Int64>(state.sampleRate) * RESYNC_MILLISECONDS / 1000;
+
+    state.frame = static_cast<sf::Uint64>(std::max<sf::Int64>(0, error > resync || error < -resync ? driverFrame : predicted + error / SLEW_DIVISOR));
+    state.time = now;
+    publish(state);
+}
+
+sf::Uint64 PlaybackClock::getFrame() const {
+    return frameAt(snapshot(), nanoseconds(Clock::now()));
+}
+
+sf::Uint64 PlaybackClock::getFrame(Clock::time_point when) const {
+    return frameAt(snapshot(), nanoseconds(when));
+}
+
+sf::Uint64 PlaybackClock::getSampleOffset() const {
+    Snapshot state = snapshot();
+    return frameAt(state, nanoseconds(Clock::now())) * state.channels;
+}
+
+sf::Time PlaybackClock::getPlayingOffset() const {
+    Snapshot state = snapshot();
+    sf::Uint64 current = frameAt(state, nanoseconds(Clock::now()));
+    return sf::microseconds(static_cast<sf::Int64>(current * 1000000 / state.sampleRate));
+}
+
+unsigned int PlaybackClock::getSampleRate() const {
+    return snapshot().sampleRate;
+}
+
+unsigned int PlaybackClock::getChannelCount() const {
+    return snapshot().channels;
+}
+
+bool PlaybackClock::isPlaying() const {
+    return snapshot().playing;
+}
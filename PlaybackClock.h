@@ -0,0 +1,129 @@
+#pragma once
+#include <SFML/System.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+/**
+ * @class PlaybackClock
+ * @brief Lock-free, sample-accurate playhead shared by every thread that follows the audio.
+ *
+ * The audio driver reports the playing position only now and then and querying it means
+ * going through OpenAL. The clock keeps an anchor instead: a frame index, the
+ * steady_clock time it was heard and the real sample rate. Readers extrapolate from the
+ * anchor, which costs a couple of atomic loads. One thread feeds driver readings through
+ * update(), typically once per rendered frame. Small differences between the prediction
+ * and the driver are slewed out gradually so the playhead never jumps; large ones (a
+ * seek or a stall) re-anchor at once.
+ *
+ * The anchor is published through a sequence lock built on atomics, so a reader always
+ * sees a consistent frame, time and format, and never blocks the writer.
+ */
+class PlaybackClock {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @brief A consistent copy of the clock state.
+     */
+    struct Snapshot {
+        sf::Uint64 frame;           ///< Frame heard at time.
+        sf::Int64 time;             ///< steady_clock time of frame, in nanoseconds since its epoch.
+        unsigned int sampleRate;    ///< Frames per second.
+        unsigned int channels;      ///< Samples per frame in the interleaved data.
+        sf::Uint64 frameCount;      ///< Frames in the file; 0 if unknown.
+        bool playing;               ///< True if the playhead advances.
+    };
+
+    /**
+     * @brief Creates a stopped clock at frame 0, at 44.1 kHz stereo.
+     */
+    PlaybackClock();
+
+    /**
+     * @brief Sets the format of a newly loaded file and stops the clock at frame 0.
+     * @param sampleRate Frames per second.
+     * @param channels Samples per frame.
+     * @param frameCount Frames in the file; the playhead never goes past it.
+     */
+    void reset(unsigned int sampleRate, unsigned int channels, sf::Uint64 frameCount);
+
+    /**
+     * @brief Feeds a reading of the audio driver. Call from one thread at a time.
+     * @param offset Playing offset reported by the driver.
+     * @param playing True if the driver is playing.
+     */
+    void update(sf::Time offset, bool playing);
+
+    /**
+     * @brief Reads the clock state.
+     * @return A consistent snapshot.
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * @brief Retrieves the frame heard now, extrapolated from the last anchor.
+     * @return Frame index.
+     */
+    sf::Uint64 getFrame() const;
+
+    /**
+     * @brief Retrieves the frame heard at a given time, extrapolated from the last anchor.
+     * @param when Point in time; may lie in the future.
+     * @return Frame index.
+     */
+    sf::Uint64 getFrame(Clock::time_point when) const;
+
+    /**
+     * @brief Retrieves the first interleaved sample of the frame heard now.
+     * @return getFrame() times the channel count.
+     */
+    sf::Uint64 getSampleOffset() const;
+
+    /**
+     * @brief Retrieves the playhead as a time.
+     * @return Time of the frame heard now.
+     */
+    sf::Time getPlayingOffset() const;
+
+    /**
+     * @brief Retrieves the real sample rate of the loaded file.
+     * @return Frames per second.
+     */
+    unsigned int getSampleRate() const;
+
+    /**
+     * @brief Retrieves the channel layout of the loaded file.
+     * @return Samples per frame.
+     */
+    unsigned int getChannelCount() const;
+
+    /**
+     * @brief Checks if the playhead advances.
+     * @return True while playing.
+     */
+    bool isPlaying() const;
+
+    /**
+     * @brief Extrapolates a snapshot to a point in time.
+     * @param state Clock state.
+     * @param time steady_clock time in nanoseconds since its epoch.
+     * @return Frame heard at that time.
+     */
+    static sf::Uint64 frameAt(const Snapshot& state, sf::Int64 time);
+
+private:
+    static sf::Int64 nanoseconds(Clock::time_point when);
+    void publish(const Snapshot& state);
+
+    std::atomic<sf::Uint32> sequence;       ///< Odd while the writer is publishing.
+    std::atomic<sf::Uint64> frame;          ///< Snapshot::frame.
+    std::atomic<sf::Int64> time;           ///< Snapshot::time.
+    std::atomic<unsigned int> sampleRate;   ///< Snapshot::sampleRate.
+    std::atomic<unsigned int> channels;     ///< Snapshot::channels.
+    std::atomic<sf::Uint64> frameCount;     ///< Snapshot::frameCount.
+    std::atomic<bool> playing;              ///< Snapshot::playing.
+
+    std::mutex writerMutex;                 ///< Serializes reset() and update().
+    sf::Uint64 lastDriverFrame;             ///< Driver position of the last update(), to spot fresh readings.
+};
@@ -0,0 +1,67 @@
+#include "ProfilerOverlay.h"
+#include <cstdio>
+#include <string>
+
+ProfilerOverlay::ProfilerOverlay() : visible(false), fontLoaded(false) {
+    fontLoaded = font.loadFromFile("arial.ttf");
+    text.setFont(font);
+    text.setCharacterSize(12);
+    text.setFillColor(sf::Color::White);
+    text.setPosition(8, 6);
+    panel.setFillColor(sf::Color(0, 0, 0, 180));
+}
+
+bool ProfilerOverlay::handleEvent(const sf::Event& event) {
+    if (event.type == sf::Event::KeyPressed && event.key.code == TOGGLE_KEY) {
+        setVisible(!visible);
+        return true;
+    }
+    return false;
+}
+
+void ProfilerOverlay::setVisible(bool show) {
+    visible = show;
+    if (visible) {
+        refresh();
+        sinceRefresh.restart();
+    }
+}
+
+bool ProfilerOverlay::isVisible() const {
+    return visible;
+}
+
+/**
+ * @brief Rebuilds the table from the current histograms.
+ */
+void ProfilerOverlay::refresh() {
+    std::string table = "thread     stage      count    p50 ms  p99 ms  max ms\n";
+    char line[96];
+    for (const FrameProfiler::Summary& s : FrameProfiler::summarize()) {
+        std::snprintf(line, sizeof(line), "%-10s %-9s %7llu %7.2f %7.2f %7.2f\n", s.thread.c_str(),
+            FrameProfiler::stageName(s.stage), static_cast<unsigned long long>(s.count), s.p50 / 1000.0, s.p99 / 1000.0, s.max / 1000.0);
+        table += line;
+    }
+    text.setString(table);
+
+    sf::FloatRect bounds = text.getLocalBounds();
+    panel.setPosition(0, 0);
+    panel.setSize(sf::Vector2f(bounds.left + bounds.width + 16, bounds.top + bounds.height + 16));
+}
+
+void ProfilerOverlay::draw(sf::RenderTarget& target) {
+    if (!visible || !fontLoaded) {
+        return;
+    }
+    if (sinceRefresh.getElapsedTime() >= sf::milliseconds(250)) {
+        refresh();
+        sinceRefresh.restart();
+    }
+
+    // Drawn in pixel coordinates regardless of the target's current view.
+    sf::View view = target.getView();
+    target.setView(target.getDefaultView());
+    target.draw(panel);
+    target.draw(text);
+    target.setView(view);
+}
@@ -0,0 +1,59 @@
+#ifndef PROFILEROVERLAY_H
+#define PROFILEROVERLAY_H
+
+#include <SFML/Graphics.hpp>
+#include "FrameProfiler.h"
+
+/**
+ * @class ProfilerOverlay
+ * @brief On-screen table of the FrameProfiler histograms, drawn over a visualizer.
+ *
+ * The text is rebuilt a few times per second rather than every frame, so showing the
+ * overlay does not itself show up as jank.
+ */
+class ProfilerOverlay {
+public:
+    static constexpr sf::Keyboard::Key TOGGLE_KEY = sf::Keyboard::F3; ///< Key that shows and hides the overlay.
+
+    /**
+     * @brief Loads the overlay font. The overlay starts hidden.
+     */
+    ProfilerOverlay();
+
+    /**
+     * @brief Toggles the overlay if the event is a press of TOGGLE_KEY.
+     * @param event Window event.
+     * @return True if the event was consumed.
+     */
+    bool handleEvent(const sf::Event& event);
+
+    /**
+     * @brief Shows or hides the overlay.
+     * @param visible True to show it.
+     */
+    void setVisible(bool visible);
+
+    /**
+     * @brief Checks if the overlay is shown.
+     * @return True if it is shown.
+     */
+    bool isVisible() const;
+
+    /**
+     * @brief Draws the overlay in the top-left corner of the target, if it is shown.
+     * @param target Window or texture to draw on.
+     */
+    void draw(sf::RenderTarget& target);
+
+private:
+    void refresh();
+
+    bool visible;               ///< Whether draw() does anything.
+    bool fontLoaded;            ///< False if arial.ttf is missing; nothing is drawn then.
+    sf::Font font;              ///< Font of the table.
+    sf::Text text;              ///< The table.
+    sf::RectangleShape panel;   ///< Translucent background behind the table.
+    sf::Clock sinceRefresh;     ///< Time since the text was rebuilt.
+};
+
+#endif // PROFILEROVERLAY_H
@@ -0,0 +1,97 @@
+#include "SoftwareCanvas.h"
+#include <algorithm>
+
+SoftwareCanvas::SoftwareCanvas(unsigned int width, unsigned int height) : width(width), height(height), pixels(width * height * 4) {
+    clear();
+}
+
+void SoftwareCanvas::clear(const sf::Color& color) {
+    for (std::size_t i = 0; i < pixels.size(); i += 4) {
+        pixels[i] = color.r;
+        pixels[i + 1] = color.g;
+        pixels[i + 2] = color.b;
+        pixels[i + 3] = color.a;
+    }
+}
+
+void SoftwareCanvas::fillRect(int left, int top, int right, int bottom, const sf::Color& color) {
+    top = std::max(top, 0);
+    bottom = std::min(bottom, static_cast<int>(height));
+    for (int row = top; row < bottom; row++) {
+        blendSpan(row, left, right, color);
+    }
+}
+
+void SoftwareCanvas::drawQuads(const sf::Vertex* vertices, std::size_t count) {
+    for (std::size_t i = 0; i + 3 < count; i += 4) {
+        float left = vertices[i].position.x, right = left;
+        float top = vertices[i].position.y, bottom = top;
+        for (std::size_t v = 1; v < 4; v++) {
+            left = std::min(left, vertices[i + v].position.x);
+            right = std::max(right, vertices[i + v].position.x);
+            top = std::min(top, vertices[i + v].position.y);
+            bottom = std::max(bottom, vertices[i + v].position.y);
+        }
+        fillRect(static_cast<int>(left + 0.5f), static_cast<int>(top + 0.5f), static_cast<int>(right + 0.5f), static_cast<int>(bottom + 0.5f), vertices[i].color);
+    }
+}
+
+void SoftwareCanvas::drawVerticalLine(int x, int y0, int y1, const sf::Color& color) {
+    if (y0 > y1) {
+        std::swap(y0, y1);
+    }
+    fillRect(x, y0, x + 1, y1 + 1, color);
+}
+
+void SoftwareCanvas::fillHorizontalGradient(int left, int top, int right, int bottom, const sf::Color& from, const sf::Color& to) {
+    int span = std::max(right - left, 1);
+    for (int x = std::max(left, 0); x < std::min(right, static_cast<int>(width)); x++) {
+        int t = x - left;
+        sf::Color color(
+            static_cast<sf::Uint8>(from.r + (to.r - from.r) * t / span),
+            static_cast<sf::Uint8>(from.g + (to.g - from.g) * t / span),
+            static_cast<sf::Uint8>(from.b + (to.b - from.b) * t / span),
+            static_cast<sf::Uint8>(from.a + (to.a - from.a) * t / span));
+        fillRect(x, top, x + 1, bottom, color);
+    }
+}
+
+const sf::Uint8* SoftwareCanvas::getPixels() const {
+    return pixels.data();
+}
+
+unsigned int SoftwareCanvas::getWidth() const {
+    return width;
+}
+
+unsigned int SoftwareCanvas::getHeight() const {
+    return height;
+}
+
+/**
+ * @brief Blends one row segment with source-over alpha compositing.
+ */
+void SoftwareCanvas::blendSpan(int row, int left, int right, const sf::Color& color) {
+    left = std::max(left, 0);
+    right = std::min(right, static_cast<int>(width));
+    sf::Uint8* pixel = pixels.data() + (static_cast<std::size_t>(row) * width + left) * 4;
+
+    if (color.a == 255) {
+        for (int x = left; x < right; x++, pixel += 4) {
+            pixel[0] = color.r;
+            pixel[1] = color.g;
+            pixel[2] = color.b;
+            pixel[3] = 255;
+        }
+        return;
+    }
+
+    unsigned int alpha = color.a;
+    unsigned int inverse = 255 - alpha;
+    for (int x = left; x < right; x++, pixel += 4) {
+        pixel[0] = static_cast<sf::Uint8>((color.r * alpha + pixel[0] * inverse + 127) / 255);
+        pixel[1] = static_cast<sf::Uint8>((color.g * alpha + pixel[1] * inverse + 127) / 255);
+        pixel[2] = static_cast<sf::Uint8>((color.b * alpha + pixel[2] * inverse + 127) / 255);
+        pixel[3] = static_cast<sf::Uint8>(alpha + (pixel[3] * inverse + 127) / 255);
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+/**
+ * @class SoftwareCanvas
+ * @brief RGBA framebuffer in CPU memory for rendering without a display or GL context.
+ *
+ * Supports exactly what the visualizers draw: axis-aligned quads (bars), vertical
+ * lines (waveform columns) and horizontal gradients, all alpha-blended over the
+ * current contents.
+ */
+class SoftwareCanvas {
+public:
+    /**
+     * @brief Allocates a canvas cleared to black.
+     * @param width Width in pixels.
+     * @param height Height in pixels.
+     */
+    SoftwareCanvas(unsigned int width, unsigned int height);
+
+    /**
+     * @brief Fills the whole canvas with one colour.
+     * @param color Fill colour; alpha is copied, not blended.
+     */
+    void clear(const sf::Color& color = sf::Color::Black);
+
+    /**
+     * @brief Blends a rectangle; the edges are clipped to the canvas.
+     * @param left Leftmost column.
+     * @param top Topmost row.
+     * @param right One past the rightmost column.
+     * @param bottom One past the bottom row.
+     * @param color Fill colour.
+     */
+    void fillRect(int left, int top, int right, int bottom, const sf::Color& color);
+
+    /**
+     * @brief Blends axis-aligned quads, e.g. those written by AudioBars::buildBarGeometry.
+     * @param vertices Four vertices per quad; the colour of the first vertex fills the quad.
+     * @param count Number of vertices.
+     */
+    void drawQuads(const sf::Vertex* vertices, std::size_t count);
+
+    /**
+     * @brief Blends a one pixel wide vertical line.
+     * @param x Column of the line.
+     * @param y0 One end of the line.
+     * @param y1 Other end of the line (inclusive).
+     * @param color Line colour.
+     */
+    void drawVerticalLine(int x, int y0, int y1, const sf::Color& color);
+
+    /**
+     * @brief Blends a rectangle whose colour goes linearly from left to right.
+     * @param left Leftmost column.
+     * @param top Topmost row.
+     * @param right One past the rightmost column.
+     * @param bottom One past the bottom row.
+     * @param from Colour at the left edge.
+     * @param to Colour at the right edge.
+     */
+    void fillHorizontalGradient(int left, int top, int right, int bottom, const sf::Color& from, const sf::Color& to);
+
+    /**
+     * @brief Retrieves the pixels, row by row, four bytes (RGBA) per pixel.
+     * @return Pointer to width * height * 4 bytes.
+     */
+    const sf::Uint8* getPixels() const;
+
+    unsigned int getWidth() const;
+    unsigned int getHeight() const;
+
+private:
+    void blendSpan(int row, int left, int right, const sf::Color& color);
+
+    unsigned int width;             ///< Width in pixels.
+    unsigned int height;            ///< Height in pixels.
+    std::vector<sf::Uint8> pixels;  ///< RGBA pixels, row by row.
+};
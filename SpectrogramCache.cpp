@@ -0,0 +1,230 @@
+#include "SpectrogramCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "DspKernels.h"
+#include "SpectrumAnalyzer.h"
+#include "UserCache.h"
+
+namespace {
+    const char MAGIC[8] = { 'A', 'V', 'S', 'P', 'E', 'C', 'T', 'R' };
+    const std::size_t BLOCK_COLUMNS = 256;  ///< Columns decoded per read in the build workers.
+}
+
+SpectrogramCache::SpectrogramCache() : columns(nullptr), columnCount(0), hopSize(1), bars(0), ready(false), cancelled(false) {
+    static_assert(sizeof(Header) == 64, "SpectrogramCache header must stay 64 bytes");
+}
+
+/**
+ * @brief Maps the cached matrix for a file, computing it first if needed. Blocks until done.
+ * @param audioFile Path to the audio file.
+ * @param fftSize Number of frames per window.
+ * @param hop Distance in frames between consecutive windows.
+ * @param barCount Number of bars per column.
+ * @param scale Spacing of the bars.
+ * @return True if the matrix is available; false on error or cancellation.
+ */
+bool SpectrogramCache::load(const std::string& audioFile, int fftSize, std::size_t hop, int barCount, BandMapping::Scale scale) {
+    close();
+    cancelled = false;
+
+    std::string directory = userCacheDirectory();
+    if (directory.empty()) {
+        return false;
+    }
+
+    sf::InputSoundFile input;
+    if (!input.openFromFile(audioFile)) {
+        return false;
+    }
+    sf::Uint64 frameCount = input.getSampleCount() / std::max(1u, input.getChannelCount());
+
+    Header expected = {};
+    std::memcpy(expected.magic, MAGIC, sizeof(MAGIC));
+    expected.version = FORMAT_VERSION;
+    expected.fftSize = fftSize;
+    expected.hopSize = static_cast<sf::Uint32>(hop);
+    expected.bars = barCount;
+    expected.columnCount = frameCount > static_cast<sf::Uint64>(fftSize) ? (frameCount - fftSize) / hop + 1 : 0;
+    expected.complete = 1;
+    expected.scale = scale;
+
+    {
+        MappedFile audio;
+        if (!audio.open(audioFile)) {
+            return false;
+        }
+        expected.contentHash = contentHash(audio.data(), audio.size());
+    }
+
+    char name[96];
+    std::snprintf(name, sizeof(name), "%016llx-%u-%u-%u-%s.spec", static_cast<unsigned long long>(expected.contentHash),
+        expected.fftSize, expected.hopSize, expected.bars, BandMapping::scaleName(scale));
+    std::string path = (std::filesystem::path(directory) / name).string();
+
+    if (!mapCacheFile(path, expected)) {
+        if (!build(audioFile, path, expected) || !mapCacheFile(path, expected)) {
+            return false;
+        }
+    }
+
+    hopSize = hop;
+    bars = barCount;
+    ready.store(true, std::memory_order_release);
+    return true;
+}
+
+void SpectrogramCache::cancel() {
+    cancelled = true;
+}
+
+void SpectrogramCache::close() {
+    ready = false;
+    file.close();
+    columns = nullptr;
+    columnCount = 0;
+}
+
+bool SpectrogramCache::isReady() const {
+    return ready.load(std::memory_order_acquire);
+}
+
+const float* SpectrogramCache::getColumn(sf::Uint64 frame) const {
+    sf::Uint64 index = frame / hopSize;
+    if (index >= columnCount) {
+        return nullptr;
+    }
+    return columns + index * bars;
+}
+
+sf::Uint64 SpectrogramCache::getColumnCount() const {
+    return columnCount;
+}
+
+/**
+ * @brief 64-bit FNV-1a over the file contents, eight bytes per step.
+ */
+sf::Uint64 SpectrogramCache::contentHash(const unsigned char* data, std::size_t size) {
+    const sf::Uint64 prime = 1099511628211ull;
+    sf::Uint64 hash = 14695981039346656037ull ^ size;
+
+    std::size_t i = 0;
+    for (; i + sizeof(sf::Uint64) <= size; i += sizeof(sf::Uint64)) {
+        sf::Uint64 word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ data[i]) * prime;
+    }
+    return hash;
+}
+
+/**
+ * @brief Maps an existing cache file if it matches the expected header.
+ */
+bool SpectrogramCache::mapCacheFile(const std::string& path, const Header& expected) {
+    if (!file.open(path)) {
+        return false;
+    }
+
+    Header header;
+    std::size_t matrixBytes = static_cast<std::size_t>(expected.columnCount) * expected.bars * sizeof(float);
+    if (file.size() != sizeof(Header) + matrixBytes) {
+        file.close();
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (std::memcmp(&header, &expected, sizeof(Header)) != 0) {
+        file.close();
+        return false;
+    }
+
+    columns = reinterpret_cast<const float*>(file.data() + sizeof(Header));
+    columnCount = header.columnCount;
+    return true;
+}
+
+/**
+ * @brief Computes the whole matrix on all cores into a temporary file, then moves it into place.
+ */
+bool SpectrogramCache::build(const std::string& audioFile, const std::string& path, const Header& expected) {
+    // Unique per writer, so concurrent builds of the same file never share a temporary file.
+    std::string temporary = temporaryPath(path);
+    std::size_t matrixBytes = static_cast<std::size_t>(expected.columnCount) * expected.bars * sizeof(float);
+
+    MappedFile output;
+    if (expected.columnCount == 0 || !output.create(temporary, sizeof(Header) + matrixBytes)) {
+        return false;
+    }
+    float* matrix = reinterpret_cast<float*>(output.data() + sizeof(Header));
+
+    unsigned int workerCount = std::max(1u, std::thread::hardware_concurrency());
+    sf::Uint64 columnsPerWorker = (expected.columnCount + workerCount - 1) / workerCount;
+    std::atomic<bool> failed(false);
+
+    auto worker = [&](sf::Uint64 first, sf::Uint64 last) {
+        sf::InputSoundFile input;
+        if (!input.openFromFile(audioFile)) {
+            failed = true;
+            return;
+        }
+        std::unique_ptr<SpectrumAnalyzer> analyzer = SpectrumAnalyzer::create(expected.fftSize, expected.bars,
+            static_cast<BandMapping::Scale>(expected.scale), input.getSampleRate());
+        unsigned int channels = std::max(1u, input.getChannelCount());
+        std::size_t blockFrames = (BLOCK_COLUMNS - 1) * expected.hopSize + expected.fftSize;
+        std::vector<sf::Int16> interleaved(blockFrames * channels);
+        std::vector<sf::Int16> block(blockFrames);
+
+        for (sf::Uint64 column = first; column < last && !cancelled && !failed; column += BLOCK_COLUMNS) {
+            sf::Uint64 count = std::min<sf::Uint64>(BLOCK_COLUMNS, last - column);
+            std::size_t wanted = static_cast<std::size_t>((count - 1) * expected.hopSize + expected.fftSize);
+
+            // InputSoundFile positions are interleaved samples; the windows are mono frames.
+            input.seek(column * expected.hopSize * channels);
+            std::size_t got = static_cast<std::size_t>(input.read(interleaved.data(), wanted * channels));
+            std::fill(interleaved.begin() + got, interleaved.begin() + wanted * channels, sf::Int16(0));
+            dsp::downmix(interleaved.data(), block.data(), wanted, channels);
+
+            for (sf::Uint64 k = 0; k < count; k++) {
+                analyzer->analyze(block.data() + k * expected.hopSize, matrix + (column + k) * expected.bars);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int w = 0; w < workerCount; w++) {
+        sf::Uint64 first = w * columnsPerWorker;
+        sf::Uint64 last = std::min(expected.columnCount, first + columnsPerWorker);
+        if (first < last) {
+            workers.emplace_back(worker, first, last);
+        }
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+
+    std::error_code error;
+    if (cancelled || failed) {
+        output.close();
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+
+    std::memcpy(output.data(), &expected, sizeof(Header));
+    output.close();
+
+    // rename() replaces the target atomically; a reader that has the old file mapped keeps it.
+    // Where it fails, e.g. on Windows while another process maps a finished copy, the caller
+    // validates whatever file is in place.
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+    }
+    return true;
+}
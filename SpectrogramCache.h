@@ -0,0 +1,100 @@
+#pragma once
+#include <SFML/Audio.hpp>
+#include <atomic>
+#include <string>
+
+#include "BandMapping.h"
+#include "MappedFile.h"
+
+/**
+ * @class SpectrogramCache
+ * @brief Whole-file matrix of bar magnitudes, stored in a memory-mapped cache file.
+ *
+ * load() looks for a cache file keyed by the content hash of the audio file and the
+ * analysis parameters. If none exists, the matrix is computed once, in parallel on all
+ * cores, written to the user cache directory and mapped. Afterwards every column is a
+ * plain read at a fixed offset, so replaying a file costs no FFT work at all.
+ *
+ * Windows are taken from the mono downmix of the file, so positions are frame indices.
+ *
+ * File layout (version 4): a 64-byte Header followed by columnCount * bars floats,
+ * column after column. A file is only valid if its header says it is complete.
+ */
+class SpectrogramCache {
+public:
+    static constexpr sf::Uint32 FORMAT_VERSION = 4;    ///< Version of the on-disk layout and of the bar reduction.
+
+    /**
+     * @brief Default constructor; no matrix is available.
+     */
+    SpectrogramCache();
+
+    /**
+     * @brief Maps the cached matrix for a file, computing it first if needed. Blocks until done.
+     * @param audioFile Path to the audio file.
+     * @param fftSize Number of frames per window.
+     * @param hopSize Distance in frames between consecutive windows.
+     * @param bars Number of bars per column.
+     * @param scale Spacing of the bars.
+     * @return True if the matrix is available; false on error or cancellation.
+     */
+    bool load(const std::string& audioFile, int fftSize, std::size_t hopSize, int bars, BandMapping::Scale scale = BandMapping::Linear);
+
+    /**
+     * @brief Asks a running load() to stop as soon as possible.
+     */
+    void cancel();
+
+    /**
+     * @brief Unmaps the matrix. Readers must not be using it any more.
+     */
+    void close();
+
+    /**
+     * @brief Checks whether columns can be read.
+     * @return True once load() has succeeded.
+     */
+    bool isReady() const;
+
+    /**
+     * @brief Retrieves the column of the window starting at the given frame.
+     * @param frame First frame of the window; a multiple of the hop size.
+     * @return Pointer to bars magnitudes, or nullptr if the cache has no such column.
+     */
+    const float* getColumn(sf::Uint64 frame) const;
+
+    /**
+     * @brief Retrieves the number of columns in the matrix.
+     * @return The column count.
+     */
+    sf::Uint64 getColumnCount() const;
+
+private:
+    /**
+     * @brief Fixed-size header at the start of every cache file.
+     */
+    struct Header {
+        char magic[8];              ///< "AVSPECTR".
+        sf::Uint32 version;         ///< FORMAT_VERSION.
+        sf::Uint32 fftSize;         ///< Number of frames per window.
+        sf::Uint32 hopSize;         ///< Distance in frames between consecutive windows.
+        sf::Uint32 bars;            ///< Number of bars per column.
+        sf::Uint64 contentHash;     ///< Hash of the audio file the matrix belongs to.
+        sf::Uint64 columnCount;     ///< Number of columns.
+        sf::Uint32 complete;        ///< 1 once every column has been written.
+        sf::Uint32 scale;           ///< BandMapping::Scale of the bars.
+        sf::Uint32 reserved[4];     ///< Pads the header to 64 bytes.
+    };
+
+    static sf::Uint64 contentHash(const unsigned char* data, std::size_t size);
+    bool mapCacheFile(const std::string& path, const Header& expected);
+    bool build(const std::string& audioFile, const std::string& path, const Header& expected);
+
+    MappedFile file;                ///< Mapping of the cache file.
+    const float* columns;           ///< First column of the matrix.
+    sf::Uint64 columnCount;         ///< Number of columns.
+    std::size_t hopSize;            ///< Distance between consecutive windows.
+    int bars;                       ///< Number of bars per column.
+    std::atomic<bool> ready;        ///< Set once columns may be read.
+    std::atomic<bool> cancelled;    ///< Set by cancel() to abort a running build.
+};
@@ -0,0 +1,184 @@
+#include "SpectrumAnalyzer.h"
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "DspKernels.h"
+#include "FftPlanCache.h"
+#include "FixedSpectrumAnalyzer.h"
+
+namespace {
+
+    /**
+     * @brief Hann window of the given length, computed at run time.
+     */
+    std::vector<float> hannWindow(int fftSize) {
+        // The factor 2 compensates the 0.5 coherent gain of the Hann window, so a pure tone
+        // keeps the bar height it had without windowing.
+        const double pi = 3.14159265358979323846;
+        std::vector<float> window(fftSize);
+        for (int i = 0; i < fftSize; i++) {
+            window[i] = static_cast<float>(1.0 - std::cos(2.0 * pi * i / fftSize));
+        }
+        return window;
+    }
+
+    /**
+     * @brief SpectrumAnalyzer for configurations without a specialization; same tables, built at run time.
+     */
+    class GenericSpectrumAnalyzer : public SpectrumAnalyzer {
+    public:
+        GenericSpectrumAnalyzer(int fftSize, int bars) : SpectrumAnalyzer(fftSize, bars), window(hannWindow(fftSize)),
+            edges(bars + 1), scales(bars), binMagnitudes(fftSize / 2 + 1) {
+            for (int bar = 0; bar <= bars; bar++) {
+                edges[bar] = barEdge(bar, fftSize / 2 + 1, bars);
+            }
+            for (int bar = 0; bar < bars; bar++) {
+                scales[bar] = 1.0f / (edges[bar + 1] - edges[bar]);
+            }
+        }
+
+        void analyze(const sf::Int16* samples, float* magnitudes) override {
+            transform(samples, window.data());
+
+            for (std::size_t k = 0; k < binMagnitudes.size(); k++) {
+                binMagnitudes[k] = std::sqrt(out[k][0] * out[k][0] + out[k][1] * out[k][1]);
+            }
+            for (int bar = 0; bar < bars; bar++) {
+                float sum = 0;
+                for (int k = edges[bar]; k < edges[bar + 1]; k++) {
+                    sum += binMagnitudes[k];
+                }
+                magnitudes[bar] = sum * scales[bar];
+            }
+        }
+
+    private:
+        std::vector<float> window;          ///< Hann window scaled to unit coherent gain.
+        std::vector<int> edges;             ///< First bin of each bar, plus the end of the last one.
+        std::vector<float> scales;          ///< Reciprocal bin count of each bar.
+        std::vector<float> binMagnitudes;   ///< Magnitude of every bin of the current window.
+    };
+
+    /**
+     * @brief SpectrumAnalyzer for log, mel and constant-Q bars, reduced through a BandMapping.
+     */
+    class MappedSpectrumAnalyzer : public SpectrumAnalyzer {
+    public:
+        MappedSpectrumAnalyzer(int fftSize, int bars, BandMapping::Scale scale, unsigned int sampleRate)
+            : SpectrumAnalyzer(fftSize, bars), window(hannWindow(fftSize)), power(fftSize / 2 + 1) {
+            mapping.configure(scale, fftSize, bars, sampleRate);
+        }
+
+        void analyze(const sf::Int16* samples, float* magnitudes) override {
+            transform(samples, window.data());
+
+            // Power only; the mapping takes one square root per bar instead of one per bin.
+            for (std::size_t k = 0; k < power.size(); k++) {
+                power[k] = out[k][0] * out[k][0] + out[k][1] * out[k][1];
+            }
+            mapping.apply(power.data(), magnitudes);
+        }
+
+    private:
+        std::vector<float> window;  ///< Hann window scaled to unit coherent gain.
+        std::vector<float> power;   ///< Power of every bin of the current window.
+        BandMapping mapping;        ///< Bin-to-bar weights.
+    };
+
+    typedef std::unique_ptr<SpectrumAnalyzer>(*Factory)();
+
+    template <int FftSize, int Bars>
+    std::unique_ptr<SpectrumAnalyzer> makeFixed() {
+        return std::unique_ptr<SpectrumAnalyzer>(new FixedSpectrumAnalyzer<FftSize, Bars>());
+    }
+
+    /**
+     * @brief A compiled-in configuration.
+     */
+    struct Specialization {
+        int fftSize;
+        int bars;
+        Factory factory;
+    };
+
+    // Configurations with compile-time tables; anything else valid falls back to GenericSpectrumAnalyzer.
+    const Specialization specializations[] = {
+        { 256, 32, &makeFixed<256, 32> },   { 256, 64, &makeFixed<256, 64> },   { 256, 128, &makeFixed<256, 128> },
+        { 512, 32, &makeFixed<512, 32> },   { 512, 64, &makeFixed<512, 64> },   { 512, 128, &makeFixed<512, 128> },   { 512, 256, &makeFixed<512, 256> },
+        { 1024, 32, &makeFixed<1024, 32> }, { 1024, 64, &makeFixed<1024, 64> }, { 1024, 128, &makeFixed<1024, 128> }, { 1024, 256, &makeFixed<1024, 256> },
+        { 2048, 32, &makeFixed<2048, 32> }, { 2048, 64, &makeFixed<2048, 64> }, { 2048, 128, &makeFixed<2048, 128> }, { 2048, 256, &makeFixed<2048, 256> },
+        { 4096, 32, &makeFixed<4096, 32> }, { 4096, 64, &makeFixed<4096, 64> }, { 4096, 128, &makeFixed<4096, 128> }, { 4096, 256, &makeFixed<4096, 256> },
+    };
+
+    const Specialization* findSpecialization(int fftSize, int bars) {
+        for (const Specialization& s : specializations) {
+            if (s.fftSize == fftSize && s.bars == bars) {
+                return &s;
+            }
+        }
+        return nullptr;
+    }
+}
+
+std::unique_ptr<SpectrumAnalyzer> SpectrumAnalyzer::create(int fftSize, int bars, BandMapping::Scale scale, unsigned int sampleRate) {
+    if (!isValid(fftSize, bars)) {
+        throw std::runtime_error("Unsupported FFT size or bar count!");
+    }
+    if (scale != BandMapping::Linear) {
+        return std::unique_ptr<SpectrumAnalyzer>(new MappedSpectrumAnalyzer(fftSize, bars, scale, sampleRate));
+    }
+    const Specialization* specialization = findSpecialization(fftSize, bars);
+    if (specialization) {
+        return specialization->factory();
+    }
+    return std::unique_ptr<SpectrumAnalyzer>(new GenericSpectrumAnalyzer(fftSize, bars));
+}
+
+bool SpectrumAnalyzer::isValid(int fftSize, int bars) {
+    bool powerOfTwo = fftSize > 0 && (fftSize & (fftSize - 1)) == 0;
+    return powerOfTwo && fftSize >= MIN_FFT_SIZE && fftSize <= MAX_FFT_SIZE && bars >= 1 && bars <= fftSize / 2 + 1;
+}
+
+bool SpectrumAnalyzer::isSpecialized(int fftSize, int bars) {
+    return findSpecialization(fftSize, bars) != nullptr;
+}
+
+/**
+ * @brief Allocates the buffers and fetches the FFT plan for the given window size.
+ * @param fftSize Number of samples per window.
+ * @param bars Number of bars the spectrum is reduced to.
+ */
+SpectrumAnalyzer::SpectrumAnalyzer(int fftSize, int bars) : fftSize(fftSize), bars(bars) {
+    if (!isValid(fftSize, bars)) {
+        throw std::runtime_error("Unsupported FFT size or bar count!");
+    }
+    plan = FftPlanCache::acquire(fftSize, FftPlanCache::RealToComplex);
+    in = static_cast<float*>(fftwf_malloc(sizeof(float) * fftSize));
+    out = static_cast<fftwf_complex*>(fftwf_malloc(sizeof(fftwf_complex) * (fftSize / 2 + 1)));
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+    fftwf_free(out);
+    fftwf_free(in);
+}
+
+/**
+ * @brief Converts and windows the samples, then runs the FFT into out.
+ * @param samples fftSize samples.
+ * @param window fftSize window coefficients.
+ */
+void SpectrumAnalyzer::transform(const sf::Int16* samples, const float* window) {
+    dsp::convert(samples, in, fftSize, 1.0f / 32768.0f);
+    dsp::multiply(in, window, fftSize);
+
+    fftwf_execute_dft_r2c(plan, in, out);
+}
+
+int SpectrumAnalyzer::getFftSize() const {
+    return fftSize;
+}
+
+int SpectrumAnalyzer::getBarCount() const {
+    return bars;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <SFML/Audio.hpp>
+#include <fftw3.h>
+#include <memory>
+
+#include "BandMapping.h"
+#include "FftPlanCache.h"
+
+/**
+ * @class SpectrumAnalyzer
+ * @brief Turns one window of samples into bar magnitudes.
+ *
+ * Owns the FFT buffers, so each thread that analyses audio needs its own instance. The
+ * plan itself comes from FftPlanCache and is shared, so creating an analyzer for a size
+ * that was used before costs no planning; analyze() runs without locking.
+ *
+ * Instances come from create(). Linear bars average the bin magnitudes; create() returns
+ * a FixedSpectrumAnalyzer with compile-time window and band tables for the common
+ * configurations and a table-driven generic analyzer for any other valid one. Log, mel
+ * and constant-Q bars go through a BandMapping, which accumulates power and takes one
+ * square root per bar.
+ */
+class SpectrumAnalyzer {
+public:
+    static constexpr int MIN_FFT_SIZE = FftPlanCache::MIN_SIZE; ///< Smallest supported window.
+    static constexpr int MAX_FFT_SIZE = FftPlanCache::MAX_SIZE; ///< Largest supported window.
+
+    /**
+     * @brief Creates the fastest analyzer available for a configuration.
+     * @param fftSize Number of samples per window; a power of two in [MIN_FFT_SIZE, MAX_FFT_SIZE].
+     * @param bars Number of bars the spectrum is reduced to; at most fftSize / 2 + 1.
+     * @param scale Spacing of the bars.
+     * @param sampleRate Sample rate of the analysed audio; places the bands of non-linear scales.
+     * @return The analyzer.
+     * @throws std::runtime_error If the configuration is invalid.
+     */
+    static std::unique_ptr<SpectrumAnalyzer> create(int fftSize, int bars, BandMapping::Scale scale = BandMapping::Linear, unsigned int sampleRate = 44100);
+
+    /**
+     * @brief Checks if a configuration can be analysed.
+     * @param fftSize Number of samples per window.
+     * @param bars Number of bars.
+     * @return True if create() accepts it.
+     */
+    static bool isValid(int fftSize, int bars);
+
+    /**
+     * @brief Checks if a configuration has a compile-time specialization.
+     * @param fftSize Number of samples per window.
+     * @param bars Number of bars.
+     * @return True if create() returns a FixedSpectrumAnalyzer for it with linear bars.
+     */
+    static bool isSpecialized(int fftSize, int bars);
+
+    /**
+     * @brief Frees the buffers; the plan stays in FftPlanCache.
+     */
+    virtual ~SpectrumAnalyzer();
+
+    SpectrumAnalyzer(const SpectrumAnalyzer&) = delete;
+    SpectrumAnalyzer& operator=(const SpectrumAnalyzer&) = delete;
+
+    /**
+     * @brief Computes the bar magnitudes of one window.
+     * @param samples fftSize samples.
+     * @param magnitudes Receives bars magnitudes: the mean bin magnitude of each bar on a linear
+     * scale, the root of the weighted mean bin power otherwise.
+     */
+    virtual void analyze(const sf::Int16* samples, float* magnitudes) = 0;
+
+    /**
+     * @brief Retrieves the number of samples per window.
+     * @return The FFT size.
+     */
+    int getFftSize() const;
+
+    /**
+     * @brief Retrieves the number of bars.
+     * @return The bar count.
+     */
+    int getBarCount() const;
+
+    /**
+     * @brief First FFT bin of a bar. Bins 0 to fftSize / 2 are split as evenly as possible,
+     * so every bin, including the top ones, belongs to exactly one bar.
+     * @param bar Bar index; bars gives the end of the last bar.
+     * @param bins Number of bins, fftSize / 2 + 1.
+     * @param bars Number of bars.
+     * @return Index of the first bin.
+     */
+    static constexpr int barEdge(int bar, int bins, int bars) {
+        return static_cast<int>(static_cast<long long>(bar) * bins / bars);
+    }
+
+protected:
+    /**
+     * @brief Allocates the buffers and fetches the FFT plan for the given window size.
+     * @param fftSize Number of samples per window.
+     * @param bars Number of bars the spectrum is reduced to.
+     * @throws std::runtime_error If the configuration is invalid.
+     */
+    SpectrumAnalyzer(int fftSize, int bars);
+
+    /**
+     * @brief Converts and windows the samples, then runs the FFT into out.
+     * @param samples fftSize samples.
+     * @param window fftSize window coefficients.
+     */
+    void transform(const sf::Int16* samples, const float* window);
+
+    int fftSize;                    ///< Number of samples per window.
+    int bars;                       ///< Number of bars.
+    float* in;                      ///< FFT input buffer.
+    fftwf_complex* out;             ///< FFT output buffer.
+    fftwf_plan plan;                ///< Shared plan for the real-to-complex transform.
+};
@@ -0,0 +1,127 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace {
+    thread_local const ThreadPool* currentPool = nullptr;   ///< Pool the calling thread works for, if any.
+    thread_local unsigned int currentIndex = 0;             ///< Index of the calling worker in currentPool.
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount) : queued(0), pending(0), nextQueue(0), stopping(false) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned int i = 0; i < threadCount; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned int i = 0; i < threadCount; i++) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        idle.wait(lock, [this]() { return pending.load() == 0; });
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    unsigned int index = currentPool == this ? currentIndex
+        : nextQueue.fetch_add(1, std::memory_order_relaxed) % static_cast<unsigned int>(queues.size());
+
+    // Counted before it becomes visible, so a worker never takes it before it is counted.
+    pending.fetch_add(1);
+    queued.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+
+    // Taking the lock orders the increment before any worker's check of the predicate.
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wake.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    idle.wait(lock, [this]() { return pending.load() == 0; });
+    if (firstError) {
+        std::exception_ptr error = firstError;
+        firstError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+unsigned int ThreadPool::getThreadCount() const {
+    return static_cast<unsigned int>(threads.size());
+}
+
+/**
+ * @brief Takes the newest task of the worker's own deque, or else the oldest task of another one.
+ */
+bool ThreadPool::take(unsigned int index, Task& task) {
+    {
+        Queue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (std::size_t offset = 1; offset < queues.size(); offset++) {
+        Queue& victim = *queues[(index + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Accounts for a task that has run and wakes wait() after the last one.
+ */
+void ThreadPool::finish(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    if (error && !firstError) {
+        firstError = error;
+    }
+    if (pending.fetch_sub(1) == 1) {
+        idle.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop(unsigned int index) {
+    currentPool = this;
+    currentIndex = index;
+
+    while (true) {
+        Task task;
+        if (take(index, task)) {
+            queued.fetch_sub(1);
+            std::exception_ptr error;
+            try {
+                task();
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            finish(error);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this]() { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
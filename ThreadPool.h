@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief Fixed set of worker threads with one task deque each and work stealing.
+ *
+ * A task submitted from inside a worker goes to the back of that worker's own deque
+ * and is taken from there again, so a task that splits itself keeps its pieces on a
+ * warm core. Tasks from other threads are spread round-robin. A worker whose deque is
+ * empty steals from the front of the others before going to sleep, so uneven tasks
+ * still keep every core busy.
+ */
+class ThreadPool {
+public:
+    typedef std::function<void()> Task;
+
+    /**
+     * @brief Starts the workers.
+     * @param threads Number of workers; 0 uses every core.
+     */
+    explicit ThreadPool(unsigned int threads = 0);
+
+    /**
+     * @brief Runs the remaining tasks, then stops and joins the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Queues a task. Safe to call from any thread, including from inside a task.
+     * @param task Work to run on one of the workers.
+     */
+    void submit(Task task);
+
+    /**
+     * @brief Blocks until every submitted task, and every task those submitted, has run.
+     * @throws The first exception a task threw since the last wait().
+     */
+    void wait();
+
+    /**
+     * @brief Retrieves the number of workers.
+     * @return The thread count.
+     */
+    unsigned int getThreadCount() const;
+
+private:
+    /**
+     * @brief Tasks owned by one worker; the owner works at the back, thieves at the front.
+     */
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(unsigned int index);
+    bool take(unsigned int index, Task& task);
+    void finish(std::exception_ptr error);
+
+    std::vector<std::unique_ptr<Queue>> queues;  ///< One deque per worker.
+    std::vector<std::thread> threads;            ///< The workers.
+    std::atomic<std::size_t> queued;             ///< Tasks waiting in any deque.
+    std::atomic<std::size_t> pending;            ///< Tasks queued or running.
+    std::atomic<unsigned int> nextQueue;         ///< Round-robin target for outside submissions.
+
+    std::mutex sleepMutex;                       ///< Guards the sleeping and the fields below.
+    std::condition_variable wake;                ///< Signalled when a task is queued or on shutdown.
+    std::condition_variable idle;                ///< Signalled when pending drops to zero.
+    bool stopping;                               ///< Set by the destructor.
+    std::exception_ptr firstError;               ///< First exception thrown by a task.
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+
+/**
+ * @class TripleBuffer
+ * @brief Wait-free single-producer/single-consumer exchange of fixed-size frames.
+ *
+ * The producer fills writeBuffer() and calls publish(); the consumer calls update()
+ * and reads readBuffer(). The three slots rotate through one atomic index, so neither
+ * side ever locks, allocates or waits, and the consumer always sees the newest frame
+ * that was completely written. Frames published faster than they are consumed are
+ * replaced by newer ones rather than queued.
+ *
+ * @tparam T Frame type. It is default-constructed three times and never copied.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    /**
+     * @brief Constructs the buffer with all three slots value-initialized.
+     */
+    TripleBuffer() : buffers(), back(0), middle(1), front(2) { }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /**
+     * @brief Slot owned by the producer. Only call from the producer thread.
+     * @return Reference to the frame being written.
+     */
+    T& writeBuffer() {
+        return buffers[back].value;
+    }
+
+    /**
+     * @brief Hands the written frame over to the consumer. Only call from the producer thread.
+     */
+    void publish() {
+        unsigned int previous = middle.exchange(back | DIRTY, std::memory_order_acq_rel);
+        back = previous & INDEX;
+    }
+
+    /**
+     * @brief Takes the newest published frame, if any. Only call from the consumer thread.
+     * @return True if readBuffer() now refers to a frame that was not seen before.
+     */
+    bool update() {
+        if ((middle.load(std::memory_order_relaxed) & DIRTY) == 0) {
+            return false;
+        }
+        unsigned int previous = middle.exchange(front, std::memory_order_acq_rel);
+        front = previous & INDEX;
+        return true;
+    }
+
+    /**
+     * @brief Slot owned by the consumer. Only call from the consumer thread.
+     * @return Reference to the newest frame taken by update().
+     */
+    const T& readBuffer() const {
+        return buffers[front].value;
+    }
+
+private:
+    static constexpr unsigned int INDEX = 3;  ///< Mask selecting the slot index.
+    static constexpr unsigned int DIRTY = 4;  ///< Set while the middle slot holds an unread frame.
+
+    /**
+     * @brief Slot padded to its own cache line so producer and consumer do not share lines.
+     */
+    struct alignas(64) Slot {
+        T value;
+    };
+
+    Slot buffers[3];                               ///< Storage for the three frames.
+    alignas(64) unsigned int back;                 ///< Producer's slot.
+    alignas(64) std::atomic<unsigned int> middle;  ///< Slot in transit, plus the DIRTY flag.
+    alignas(64) unsigned int front;                ///< Consumer's slot.
+};
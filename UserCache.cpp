@@ -0,0 +1,54 @@
+#include "UserCache.h"
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <sstream>
+#include <system_error>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+std::string userCacheDirectory() {
+    std::filesystem::path base;
+
+#ifdef _WIN32
+    if (const char* localAppData = std::getenv("LOCALAPPDATA")) {
+        base = localAppData;
+    }
+#else
+    if (const char* xdgCache = std::getenv("XDG_CACHE_HOME")) {
+        base = xdgCache;
+    }
+    else if (const char* home = std::getenv("HOME")) {
+        base = std::filesystem::path(home) / ".cache";
+    }
+#endif
+
+    if (base.empty()) {
+        return std::string();
+    }
+
+    std::filesystem::path directory = base / "AudioVisualizer";
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        return std::string();
+    }
+    return directory.string();
+}
+
+std::string temporaryPath(const std::string& path) {
+#ifdef _WIN32
+    long processId = _getpid();
+#else
+    long processId = static_cast<long>(getpid());
+#endif
+    // The random part keeps threads of one process apart too.
+    std::random_device random;
+    std::ostringstream name;
+    name << path << '.' << processId << '.' << std::hex << random() << random() << ".tmp";
+    return name.str();
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+
+/**
+ * @brief Retrieves the per-user cache directory of the application, creating it if needed.
+ *
+ * Uses %LOCALAPPDATA% on Windows and $XDG_CACHE_HOME (or ~/.cache) elsewhere.
+ *
+ * @return Path to the directory, or an empty string if it cannot be created.
+ */
+std::string userCacheDirectory();
+
+/**
+ * @brief Names a temporary file next to a cache file, unique to this process and call.
+ *
+ * Writers fill the temporary file and rename() it over the target, so concurrent
+ * writers, even in other processes, never share a half-written file and readers only
+ * ever see a complete one.
+ *
+ * @param path Path to the cache file.
+ * @return Path of the form path.<process id>.<random>.tmp.
+ */
+std::string temporaryPath(const std::string& path);
@@ -0,0 +1,233 @@
+#include "WavFile.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    const unsigned int FORMAT_PCM = 0x0001;
+    const unsigned int FORMAT_FLOAT = 0x0003;
+    const unsigned int FORMAT_EXTENSIBLE = 0xFFFE;
+    const sf::Uint64 SIZE_IN_DS64 = 0xFFFFFFFF; ///< 32-bit size field of an RF64 file; the real size is in ds64.
+
+    unsigned int readU16(const unsigned char* p) {
+        return p[0] | p[1] << 8;
+    }
+
+    sf::Uint64 readU32(const unsigned char* p) {
+        return static_cast<sf::Uint64>(p[0]) | static_cast<sf::Uint64>(p[1]) << 8 | static_cast<sf::Uint64>(p[2]) << 16 | static_cast<sf::Uint64>(p[3]) << 24;
+    }
+
+    sf::Uint64 readU64(const unsigned char* p) {
+        return readU32(p) | readU32(p + 4) << 32;
+    }
+
+    bool isTag(const unsigned char* p, const char* tag) {
+        return std::memcmp(p, tag, 4) == 0;
+    }
+
+    /**
+     * @brief Scales a float sample to 16 bits, clipping out-of-range values and mapping NaN to silence.
+     */
+    sf::Int16 floatToInt16(double value) {
+        double scaled = value * 32768.0;
+        if (scaled >= 32767.0) {
+            return 32767;
+        }
+        if (scaled <= -32768.0) {
+            return -32768;
+        }
+        return scaled == scaled ? static_cast<sf::Int16>(scaled) : 0;
+    }
+
+    /**
+     * @brief Keeps the two most significant bytes of little-endian integer samples.
+     */
+    void truncateToInt16(const unsigned char* src, sf::Int16* dst, std::size_t count, unsigned int bytes) {
+        src += bytes - 2;
+        for (std::size_t i = 0; i < count; i++, src += bytes) {
+            dst[i] = static_cast<sf::Int16>(static_cast<std::uint16_t>(src[0] | src[1] << 8));
+        }
+    }
+}
+
+WavFile::WavFile() : encoding(Unsupported), sampleRate(0), channels(0), frameBytes(0), dataOffset(0), frames(0) { }
+
+bool WavFile::open(const std::string& path) {
+    close();
+    if (!file.open(path)) {
+        return false;
+    }
+    if (!parse()) {
+        close();
+        return false;
+    }
+    // Playback and analysis walk the data front to back.
+    file.advise(MappedFile::Sequential, dataOffset, file.size() - dataOffset);
+    return true;
+}
+
+/**
+ * @brief Walks the chunk headers and locates the format and data chunks.
+ * @return False if the file is not a WAVE file or uses an unsupported encoding.
+ */
+bool WavFile::parse() {
+    const unsigned char* bytes = file.data();
+    sf::Uint64 size = file.size();
+    if (size < 12 || !isTag(bytes + 8, "WAVE")) {
+        return false;
+    }
+    bool rf64 = isTag(bytes, "RF64");
+    if (!rf64 && !isTag(bytes, "RIFF")) {
+        return false;
+    }
+
+    sf::Uint64 ds64DataSize = SIZE_IN_DS64;
+    unsigned int format = 0;
+    unsigned int bits = 0;
+    bool haveFormat = false;
+
+    sf::Uint64 pos = 12;
+    while (pos + 8 <= size) {
+        const unsigned char* chunk = bytes + pos;
+        sf::Uint64 length = readU32(chunk + 4);
+        sf::Uint64 body = pos + 8;
+        sf::Uint64 available = size - body;
+
+        if (isTag(chunk, "ds64") && length >= 24 && available >= 24) {
+            ds64DataSize = readU64(chunk + 16);
+        }
+        else if (isTag(chunk, "fmt ") && length >= 16 && available >= 16) {
+            format = readU16(chunk + 8);
+            channels = readU16(chunk + 10);
+            sampleRate = static_cast<unsigned int>(readU32(chunk + 12));
+            frameBytes = readU16(chunk + 20);
+            bits = readU16(chunk + 22);
+            if (format == FORMAT_EXTENSIBLE && length >= 40 && available >= 40) {
+                // The sub-format GUID starts with the plain format tag.
+                format = readU16(chunk + 32);
+            }
+            haveFormat = true;
+        }
+        else if (isTag(chunk, "data")) {
+            if (!haveFormat) {
+                return false;
+            }
+            if (rf64 && length == SIZE_IN_DS64) {
+                length = ds64DataSize;
+            }
+            // Captures that were cut short, or whose size was never patched, end with the file.
+            if (length > available) {
+                length = available;
+            }
+
+            if (format == FORMAT_PCM) {
+                encoding = bits == 8 ? UInt8 : bits == 16 ? Int16 : bits == 24 ? Int24 : bits == 32 ? Int32 : Unsupported;
+            }
+            else if (format == FORMAT_FLOAT) {
+                encoding = bits == 32 ? Float32 : bits == 64 ? Float64 : Unsupported;
+            }
+            if (encoding == Unsupported || channels == 0 || sampleRate == 0 || frameBytes != channels * (bits / 8)) {
+                encoding = Unsupported;
+                return false;
+            }
+            dataOffset = static_cast<std::size_t>(body);
+            frames = length / frameBytes;
+            return true;
+        }
+        pos = body + length + (length & 1);
+    }
+    return false;
+}
+
+void WavFile::close() {
+    file.close();
+    encoding = Unsupported;
+    sampleRate = 0;
+    channels = 0;
+    frameBytes = 0;
+    dataOffset = 0;
+    frames = 0;
+}
+
+bool WavFile::isOpen() const {
+    return file.isOpen();
+}
+
+WavFile::Encoding WavFile::getEncoding() const {
+    return encoding;
+}
+
+unsigned int WavFile::getSampleRate() const {
+    return sampleRate;
+}
+
+unsigned int WavFile::getChannelCount() const {
+    return channels;
+}
+
+sf::Uint64 WavFile::getFrameCount() const {
+    return frames;
+}
+
+const unsigned char* WavFile::getData() const {
+    return file.isOpen() ? file.data() + dataOffset : nullptr;
+}
+
+const sf::Int16* WavFile::getInt16() const {
+    // Chunks start on even offsets, but a malformed file could still misalign the data.
+    if (encoding != Int16 || dataOffset % alignof(sf::Int16) != 0) {
+        return nullptr;
+    }
+    return reinterpret_cast<const sf::Int16*>(getData());
+}
+
+std::size_t WavFile::read(sf::Uint64 first, std::size_t count, sf::Int16* dst) const {
+    std::size_t available = first < frames ? static_cast<std::size_t>(std::min<sf::Uint64>(count, frames - first)) : 0;
+    std::size_t samples = available * channels;
+    const unsigned char* src = getData() + first * frameBytes;
+
+    if (samples > 0) {
+        switch (encoding) {
+        case UInt8:
+            for (std::size_t i = 0; i < samples; i++) {
+                dst[i] = static_cast<sf::Int16>((src[i] - 128) * 256);
+            }
+            break;
+        case Int16:
+            std::memcpy(dst, src, samples * sizeof(sf::Int16));
+            break;
+        case Int24:
+            truncateToInt16(src, dst, samples, 3);
+            break;
+        case Int32:
+            truncateToInt16(src, dst, samples, 4);
+            break;
+        case Float32:
+            for (std::size_t i = 0; i < samples; i++) {
+                float value;
+                std::memcpy(&value, src + i * sizeof(float), sizeof(float));
+                dst[i] = floatToInt16(value);
+            }
+            break;
+        case Float64:
+            for (std::size_t i = 0; i < samples; i++) {
+                double value;
+                std::memcpy(&value, src + i * sizeof(double), sizeof(double));
+                dst[i] = floatToInt16(value);
+            }
+            break;
+        case Unsupported:
+            break;
+        }
+    }
+    std::fill(dst + samples, dst + count * channels, sf::Int16(0));
+    return available;
+}
+
+void WavFile::prefetch(sf::Uint64 first, sf::Uint64 count) const {
+    if (first >= frames) {
+        return;
+    }
+    count = std::min(count, frames - first);
+    file.advise(MappedFile::WillNeed, static_cast<std::size_t>(dataOffset + first * frameBytes), static_cast<std::size_t>(count * frameBytes));
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <SFML/Config.hpp>
+#include <cstddef>
+#include <string>
+
+#include "MappedFile.h"
+
+/**
+ * @class WavFile
+ * @brief Memory-mapped RIFF/WAVE and RF64 reader that exposes the PCM data in place.
+ *
+ * open() maps the file and walks the chunk headers; nothing is decoded or copied, so
+ * opening a multi-gigabyte capture costs the same as opening a short clip, and reading
+ * only the header is cheap enough for a file browser. The data chunk is advised for
+ * sequential reading, and only the pages that are touched are read.
+ *
+ * Supported encodings are 8, 16, 24 and 32-bit integer PCM and 32 and 64-bit float, in
+ * plain or WAVE_FORMAT_EXTENSIBLE headers. 16-bit files can be played straight from the
+ * mapping through getInt16(); the others are converted span by span with read().
+ * Samples are little-endian, as on every platform the project builds for.
+ */
+class WavFile {
+public:
+    /**
+     * @brief Sample encoding of the data chunk.
+     */
+    enum Encoding {
+        Unsupported,    ///< No file open, or an encoding read() cannot convert.
+        UInt8,          ///< Unsigned 8-bit integer, silence at 128.
+        Int16,          ///< Signed 16-bit integer.
+        Int24,          ///< Signed 24-bit integer, packed in three bytes.
+        Int32,          ///< Signed 32-bit integer.
+        Float32,        ///< IEEE float, full scale at +-1.
+        Float64         ///< IEEE double, full scale at +-1.
+    };
+
+    /**
+     * @brief Default constructor; no file is open.
+     */
+    WavFile();
+
+    /**
+     * @brief Maps a file and parses its header.
+     * @param path Path to the file.
+     * @return False if the file cannot be mapped, is not a WAVE file or uses an unsupported encoding.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Unmaps the file.
+     */
+    void close();
+
+    /**
+     * @brief Checks whether a file is open.
+     * @return True after a successful open().
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Retrieves the sample encoding.
+     * @return Encoding of the data chunk.
+     */
+    Encoding getEncoding() const;
+
+    /**
+     * @brief Retrieves the sample rate.
+     * @return Frames per second.
+     */
+    unsigned int getSampleRate() const;
+
+    /**
+     * @brief Retrieves the channel count.
+     * @return Samples per frame.
+     */
+    unsigned int getChannelCount() const;
+
+    /**
+     * @brief Retrieves the length of the data chunk.
+     * @return Number of whole frames.
+     */
+    sf::Uint64 getFrameCount() const;
+
+    /**
+     * @brief Retrieves the raw data chunk inside the mapping.
+     * @return First byte of frame 0.
+     */
+    const unsigned char* getData() const;
+
+    /**
+     * @brief Retrieves the samples of a 16-bit file in place.
+     * @return getFrameCount() * getChannelCount() interleaved samples, or nullptr for other encodings.
+     */
+    const sf::Int16* getInt16() const;
+
+    /**
+     * @brief Converts a span of interleaved frames to 16-bit samples; frames past the end read as silence.
+     * @param first First frame.
+     * @param count Number of frames.
+     * @param dst Destination, count * getChannelCount() samples.
+     * @return Number of frames that were inside the file.
+     */
+    std::size_t read(sf::Uint64 first, std::size_t count, sf::Int16* dst) const;
+
+    /**
+     * @brief Asks the kernel to start reading a span of frames, ahead of a seek or a read.
+     * @param first First frame.
+     * @param count Number of frames.
+     */
+    void prefetch(sf::Uint64 first, sf::Uint64 count) const;
+
+private:
+    bool parse();
+
+    MappedFile file;            ///< Mapping of the whole file.
+    Encoding encoding;          ///< Sample encoding.
+    unsigned int sampleRate;    ///< Frames per second.
+    unsigned int channels;      ///< Samples per frame.
+    unsigned int frameBytes;    ///< Bytes per interleaved frame.
+    std::size_t dataOffset;     ///< Offset of the data chunk in the file.
+    sf::Uint64 frames;          ///< Whole frames in the data chunk.
+};
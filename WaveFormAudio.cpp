@@ -1,126 +1,236 @@
 #include "WaveFormAudio.h"
+#include "FrameProfiler.h"
+#include <algorithm>
 
-WaveFormAudio::WaveFormAudio(AudioHandler& handler) : AudioVisualizer(handler) { }
+WaveFormAudio::WaveFormAudio(AnalysisBus& bus) : AudioVisualizer(bus), vertexBuffer(sf::Lines, sf::VertexBuffer::Stream) {
+    setGraphWidth(TEXTURE_X);
+}
 
-void WaveFormAudio::loadFile(const std::string& filename) {
-    // Delegate to AudioHandler.
-    audioHandler.loadFile(filename);
+WaveFormAudio::~WaveFormAudio() {
+    if (running) {
+        end();
+    }
+}
 
+void WaveFormAudio::loadFile() {
+    // The bus has loaded the file into the shared AudioHandler already.
     origChannelCount = audioHandler.getChannelCount();
     duration = audioHandler.getDuration();
     origSampleCount = audioHandler.getSampleCount();
-    origSampleRate = audioHandler.getSampleRate();
-    origSamples = audioHandler.getSamples();
+    peaks = bus.getPeaks();
+}
 
-    mergeChannel();
+void WaveFormAudio::mapBuffer(int high, int low) {
+    mapHigh = high;
+    mapLow = low;
 }
 
-void WaveFormAudio::mergeChannel() {
-    if (origChannelCount == 1) {
-        return;
-    }
+int WaveFormAudio::mapAmplitude(int sample) const {
+    return mapLow + ((sample + 32768) * (mapHigh - mapLow) / 65535);
+}
 
-    for (int i = 0; i < origSampleCount; i += 2) {
-        monoSamples.push_back((origSamples[i] + origSamples[i + 1]) / 2);
+PeakPyramid::Peak WaveFormAudio::getColumn(sf::Uint64 fromFrame, sf::Uint64 toFrame) const {
+    if (toFrame <= fromFrame) {
+        toFrame = fromFrame + 1;
     }
+    return peaks ? peaks->query(fromFrame, toFrame) : PeakPyramid::Peak{ 0, 0, 0.0f };
+}
 
-    monoBuffer.loadFromSamples(&monoSamples[0], origSampleCount / 2, 1, origSampleRate);
-
-    audioHandler.sound.setBuffer(monoBuffer);
+void WaveFormAudio::setGraphWidth(int width) {
+    graphWidth = std::max(width, 1);
+    windowWidth = std::max(WINDOW_X, graphWidth + (WINDOW_X - TEXTURE_X));
 }
 
-void WaveFormAudio::mapBuffer(int high, int low) {
-    mappedSamples.clear();
+void WaveFormAudio::writeColumns(sf::Uint64 nowFrame, unsigned int sampleRate) {
+    sf::Uint64 framesPerColumn = std::max(1u, sampleRate / WINDOW_FPS);
 
-    int newRange = high - low;
+    // Seeked backwards, or fell more than a whole graph behind: restart at the playhead.
+    if (nowFrame + framesPerColumn < columnFrame || nowFrame > columnFrame + graphWidth * framesPerColumn) {
+        columnFrame = nowFrame;
+    }
+
+    int first = writeHead;
+    int written = 0;
+    while (columnFrame + framesPerColumn <= nowFrame) {
+        PeakPyramid::Peak peak = getColumn(columnFrame, columnFrame + framesPerColumn);
+        columnFrame += framesPerColumn;
 
-    for (int i = 0; i < origSampleCount / 2; i++) {
-        mappedSamples.push_back(low + ((monoSamples[i] + 32768) * newRange / 65535));
+        vertices[2 * writeHead].position.y = TEXTURE_Y / 2 + mapAmplitude(peak.min);
+        vertices[2 * writeHead + 1].position.y = TEXTURE_Y / 2 + mapAmplitude(peak.max) + 1;
+        writeHead = (writeHead + 1) % graphWidth;
+        written++;
     }
-}
 
-int WaveFormAudio::getHeight() {
-    int val = mappedSamples[audioHandler.sound.getPlayingOffset().asSeconds() * origSampleRate];
-    return val;
+    if (written == 0 || !useVertexBuffer) {
+        return;
+    }
+
+    // Upload only the new columns; a range that wraps around the ring takes two updates.
+    int tail = std::min(written, graphWidth - first);
+    vertexBuffer.update(&vertices[2 * first], 2 * tail, 2 * first);
+    if (written > tail) {
+        vertexBuffer.update(&vertices[0], 2 * (written - tail), 0);
+    }
 }
 
-void WaveFormAudio::initializeWindow() {
-    waveFormWindow.create(sf::VideoMode(WINDOW_X, WINDOW_Y), "Wave Form");
-    waveFormWindow.setFramerateLimit(WINDOW_FPS);
+void WaveFormAudio::drawGraph() {
+    // Oldest column is the one after the write head; it goes to the left edge.
+    int oldest = writeHead;
+    int olderCount = graphWidth - oldest;
+
+    sf::RenderStates older(sf::Transform().translate(-static_cast<float>(oldest), 0));
+    sf::RenderStates newer(sf::Transform().translate(static_cast<float>(olderCount), 0));
+
+    if (useVertexBuffer) {
+        renderGraph.draw(vertexBuffer, 2 * oldest, 2 * olderCount, older);
+        renderGraph.draw(vertexBuffer, 0, 2 * oldest, newer);
+    }
+    else {
+        renderGraph.draw(&vertices[2 * oldest], 2 * olderCount, sf::Lines, older);
+        renderGraph.draw(&vertices[0], 2 * oldest, sf::Lines, newer);
+    }
+    renderGraph.draw(fade, 4, sf::Quads);
 }
 
-void WaveFormAudio::mainLoop() {
-    int dur = duration.asSeconds();
-    sf::Event ev;
+void WaveFormAudio::warmUp() {
+    if (warm && builtWidth == graphWidth) {
+        return;
+    }
+    mapBuffer(TEXTURE_Y / 2, -TEXTURE_Y / 2);
+    waveFormWindow.create(sf::VideoMode(windowWidth, WINDOW_Y), "Wave Form");
+    waveFormWindow.setVisible(false);
+    waveFormWindow.setFramerateLimit(WINDOW_FPS);
 
-    sf::RectangleShape timeline(sf::Vector2f(TEXTURE_X, 1));
+    timeline.setSize(sf::Vector2f(graphWidth, 1));
     timeline.setFillColor(sf::Color::Green);
-    timeline.setPosition((WINDOW_X - TEXTURE_X) / 2, 0.9 * WINDOW_Y);
+    timeline.setPosition((windowWidth - graphWidth) / 2, 0.9 * WINDOW_Y);
 
-    sf::CircleShape seek(3);
+    seek.setRadius(3);
     seek.setPointCount(64);
     seek.setOrigin(3, 3);
     seek.setFillColor(sf::Color::Green);
 
-    for (int i = 0; i < TEXTURE_X; i++) {
-        vertices[i].position.y = TEXTURE_Y / 2;
-        vertices[i].color = sf::Color(0, 255, 0, i * 255 / TEXTURE_X);
-    }
+    // Older columns fade out towards the left edge.
+    fade[0] = sf::Vertex(sf::Vector2f(0, 0), sf::Color::Black);
+    fade[1] = sf::Vertex(sf::Vector2f(graphWidth, 0), sf::Color::Transparent);
+    fade[2] = sf::Vertex(sf::Vector2f(graphWidth, TEXTURE_Y), sf::Color::Transparent);
+    fade[3] = sf::Vertex(sf::Vector2f(0, TEXTURE_Y), sf::Color::Black);
+
+    vertices.assign(2 * graphWidth, sf::Vertex());
+    useVertexBuffer = sf::VertexBuffer::isAvailable() && vertexBuffer.create(vertices.size());
 
-    sf::VertexBuffer vertexBuffer(sf::LineStrip);
-    vertexBuffer.create(TEXTURE_X);
+    renderGraph.create(graphWidth, TEXTURE_Y);
+    graph.setTexture(renderGraph.getTexture(), true);
+    graph.setPosition((windowWidth - graphWidth) / 2, (WINDOW_Y - TEXTURE_Y) * 0.2);
+
+    builtWidth = graphWidth;
+    warm = true;
+}
 
-    renderGraph.create(TEXTURE_X, TEXTURE_Y);
-    graph.setTexture(renderGraph.getTexture());
-    graph.setPosition((WINDOW_X - TEXTURE_X) / 2, (WINDOW_Y - TEXTURE_Y) * 0.2);
+void WaveFormAudio::begin() {
+    warmUp();
 
-    audioHandler.play();
+    // Every column is a vertical line from the lowest to the highest sample it covers.
+    // Columns live in a ring at fixed x positions; drawGraph() rotates them into place.
+    for (int i = 0; i < graphWidth; i++) {
+        for (int v = 0; v < 2; v++) {
+            vertices[2 * i + v] = sf::Vertex(sf::Vector2f(i, TEXTURE_Y / 2), sf::Color::Green);
+        }
+    }
+    if (useVertexBuffer) {
+        vertexBuffer.update(vertices.data());
+    }
+    writeHead = 0;
+    columnFrame = audioHandler.getClock().getFrame();
+    durationSeconds = std::max(1, static_cast<int>(duration.asSeconds()));
+
+    FrameProfiler::setThreadName("render");
+    waveFormWindow.setVisible(true);
+    // Peaks not in the cache are summarized in the background; the waveform fills in as the pass moves ahead of the playhead.
+    subscription = bus.subscribe(AnalysisBus::Peaks);
+    peaks = bus.getPeaks();
+    running = true;
+}
 
-    while (waveFormWindow.isOpen()) {
-        while (waveFormWindow.pollEvent(ev)) {
-            if (ev.type == sf::Event::Closed || (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::Escape)) {
-                waveFormWindow.close();
+bool WaveFormAudio::update() {
+    if (!running) {
+        return false;
+    }
+    ScopedTimer frameTimer(FrameProfiler::Frame);
+    bus.updateClock();
+    sf::Event ev;
+    while (waveFormWindow.pollEvent(ev)) {
+        if (profilerOverlay.handleEvent(ev)) {
+            continue;
+        }
+        if (ev.type == sf::Event::Closed || (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::Escape)) {
+            running = false;
+        }
+        else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::Space) {
+            if (audioHandler.getStatus() == sf::Sound::Paused) {
+                audioHandler.play();
             }
-            else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::Space) {
-                if (audioHandler.getStatus() == sf::Sound::Paused) {
-                    audioHandler.play();
-                }
-                else {
-                    audioHandler.pause();
-                }
+            else {
+                audioHandler.pause();
             }
         }
-        for (int i = 0; i < TEXTURE_X; i++) {
-            vertices[i].position = sf::Vector2f(i, vertices[i + 1].position.y);
-        }
-
-        vertices[TEXTURE_X - 1].position = sf::Vector2f(TEXTURE_X - 1, TEXTURE_Y / 2 + getHeight());
+    }
 
-        vertexBuffer.update(vertices);
+    // One clock reading per frame keeps the graph and the seek marker in step.
+    // The rate is 0 until a file is loaded; there is nothing to draw then.
+    sf::Uint64 nowFrame = audioHandler.getClock().getFrame();
+    unsigned int sampleRate = audioHandler.getClock().getSampleRate();
+    if (sampleRate == 0) {
+        waveFormWindow.clear(sf::Color::Black);
+        waveFormWindow.display();
+        return running;
+    }
+    {
+        ScopedTimer timer(FrameProfiler::Geometry);
+        writeColumns(nowFrame, sampleRate);
+    }
 
-        int nowSec = audioHandler.sound.getPlayingOffset().asSeconds();
-        int pos = (WINDOW_X - TEXTURE_X) / 2 + nowSec * TEXTURE_X / dur;
-        seek.setPosition(pos, WINDOW_Y * 0.9);
+    int nowSec = static_cast<int>(nowFrame / sampleRate);
+    int pos = (windowWidth - graphWidth) / 2 + nowSec * graphWidth / durationSeconds;
+    seek.setPosition(pos, WINDOW_Y * 0.9);
 
+    {
+        ScopedTimer timer(FrameProfiler::Draw);
         renderGraph.clear(sf::Color::Black);
-        renderGraph.draw(vertexBuffer);
+        drawGraph();
+        renderGraph.display();
 
         waveFormWindow.clear(sf::Color::Black);
         waveFormWindow.draw(graph);
         waveFormWindow.draw(timeline);
         waveFormWindow.draw(seek);
+        profilerOverlay.draw(waveFormWindow);
+    }
+    {
+        ScopedTimer timer(FrameProfiler::Display);
         waveFormWindow.display();
+    }
 
-        if (dur == nowSec) {
-            audioHandler.pause();
-            waveFormWindow.close();
-        }
+    if (nowSec >= durationSeconds) {
+        running = false;
     }
-    audioHandler.pause();
+    return running;
 }
 
-void WaveFormAudio::run() {
-    mapBuffer(TEXTURE_Y / 2, -TEXTURE_Y / 2);
-    initializeWindow();
-    mainLoop();
+bool WaveFormAudio::isOpen() const {
+    return running;
+}
+
+void WaveFormAudio::end() {
+    if (subscription) {
+        // The last view to leave pauses playback.
+        bus.unsubscribe(subscription);
+        subscription = nullptr;
+    }
+    waveFormWindow.setVisible(false);
+    running = false;
+}
+
+sf::Window& WaveFormAudio::getWindow() {
+    return waveFormWindow;
 }
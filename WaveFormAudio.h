@@ -2,9 +2,12 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio.hpp>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 #include "AudioHandler.h"
 #include "AudioVisualizer.h"
+#include "PeakPyramid.h"
 
 /**
  * \class WaveFormAudio
@@ -17,63 +20,106 @@ class WaveFormAudio : public AudioVisualizer
 public:
 
     /**
-     * \brief Constructor that initializes the WaveFormAudio with a reference to an AudioHandler.
-     * \param audioHandler Reference to the AudioHandler object.
+     * \brief Constructor that initializes the WaveFormAudio on an analysis bus.
+     * \param bus Bus that supplies the clock and the peak pyramid.
      */
-    WaveFormAudio(AudioHandler& audioHandler);
+    WaveFormAudio(AnalysisBus& bus);
 
     /**
-     * \brief Loads the given audio file and retrieves necessary data from it.
-     * \param filename Path to the audio file.
+     * \brief Ends a running visualization.
      */
-    void loadFile(const std::string& filename) override;
+    ~WaveFormAudio();
 
     /**
-     * \brief Maps the amplitude of audio samples onto the visual space of the window.
+     * \brief Retrieves the data the waveform needs from the file the bus has loaded.
+     */
+    void loadFile() override;
+
+    /**
+     * \brief Sets the range the amplitude of audio samples is mapped onto in the visual space of the window.
      * \param high The maximum value for mapping.
      * \param low The minimum value for mapping.
      */
     void mapBuffer(int high, int low);
 
     /**
-     * \brief Retrieves the height of a given sample for visualization.
-     * \return An integer representing the height value.
+     * \brief Retrieves the peak range of the audio between two frames for one waveform column.
+     * \param fromFrame First frame covered by the column.
+     * \param toFrame One past the last frame; spans shorter than one frame are widened to one frame.
+     * \return Lowest, highest and RMS mono sample of the span.
+     */
+    PeakPyramid::Peak getColumn(sf::Uint64 fromFrame, sf::Uint64 toFrame) const;
+
+    /**
+     * \brief Sets the width of the scrolling waveform in pixels (one column per rendered frame).
+     * The window grows with it if needed, and is rebuilt by the next warmUp() or begin().
+     * \param width Width of the waveform in pixels.
+     */
+    void setGraphWidth(int width);
+
+    /**
+     * \brief Creates the hidden window, the column vertex buffer and the render texture,
+     * or rebuilds them if the graph width changed since.
+     */
+    void warmUp() override;
+
+    /**
+     * \brief Clears the column ring, shows the window and subscribes to the peaks of the bus.
+     */
+    void begin() override;
+
+    /**
+     * \brief Writes the columns due since the last frame and renders them.
+     * \return False once the window is closed, Escape is pressed or the file has played to its end.
      */
-    int getHeight();
+    bool update() override;
 
     /**
-     * \brief Begins the waveform visualization process.
+     * \brief Checks whether a run is in progress.
+     * \return True between begin() and the update() that ends the run.
      */
-    void run() override;
+    bool isOpen() const override;
+
+    /**
+     * \brief Unsubscribes from the bus and hides the window, keeping it and its render resources for the next run.
+     */
+    void end() override;
+
+    /**
+     * \brief Retrieves the waveform window.
+     * \return Window created by warmUp().
+     */
+    sf::Window& getWindow() override;
 
 private:
 
     /**
-     * \brief Converts stereo audio samples to mono.
-     * If the audio is stereo (2 channels), it merges both channels into a mono channel.
+     * \brief Maps a sample value onto the range set by mapBuffer().
+     * \param sample Sample value.
+     * \return Offset from the centre line of the waveform.
      */
-    void mergeChannel();
+    int mapAmplitude(int sample) const;
 
     /**
-     * \brief Sets up the SFML window for waveform rendering.
+     * \brief Writes the columns that became due since the last frame at the write head
+     * and uploads only those columns to the vertex buffer.
+     * \param nowFrame Current playing position in frames.
+     * \param sampleRate Frames per second of the playing file.
      */
-    void initializeWindow();
+    void writeColumns(sf::Uint64 nowFrame, unsigned int sampleRate);
 
     /**
-     * \brief Core loop for rendering the waveform and handling events.
+     * \brief Draws the column ring oldest-first into the render texture, plus the fade overlay.
      */
-    void mainLoop();
+    void drawGraph();
 
     sf::Time duration; ///< Duration of the loaded audio file.
-    sf::SoundBuffer origBuffer; ///< Buffer to store the original audio samples.
-    const sf::Int16* origSamples; ///< Pointer to the original audio samples.
-    unsigned int origChannelCount; ///< Number of channels in the original audio (e.g., 2 for stereo).
-    unsigned int origSampleRate; ///< Sample rate of the original audio.
-    sf::Uint64 origSampleCount; ///< Number of samples in the original audio.
-    sf::SoundBuffer monoBuffer; ///< Buffer to store mono audio samples.
-    std::vector<sf::Int16> monoSamples; ///< Vector storing the mono audio samples.
-    unsigned int monoSampleRate; ///< Sample rate of the mono audio.
-    std::vector<sf::Int16> mappedSamples; ///< Vector storing mapped audio samples for visualization.
+    unsigned int origChannelCount = 0; ///< Number of channels in the original audio (e.g., 2 for stereo).
+    sf::Uint64 origSampleCount = 0; ///< Number of samples in the original audio.
+    std::shared_ptr<const PeakPyramid> peaks; ///< Min/max/RMS summary of the whole file from the bus, used for every waveform column.
+    AnalysisBus::Subscription* subscription = nullptr; ///< Subscription to the bus while running.
+    int mapHigh = 0; ///< Upper bound of the mapped amplitude range.
+    int mapLow = 0; ///< Lower bound of the mapped amplitude range.
 
     const int WINDOW_X = 600; ///< Width of the window.
     const int WINDOW_Y = 600; ///< Height of the window.
@@ -81,9 +127,23 @@ private:
     const int TEXTURE_X = 0.8 * WINDOW_X; ///< Width of the texture for rendering the waveform.
     const int TEXTURE_Y = 0.35 * WINDOW_Y; ///< Height of the texture for rendering the waveform.
 
+    int graphWidth; ///< Width of the scrolling waveform, in columns and pixels.
+    int windowWidth; ///< Width of the window, at least WINDOW_X.
+
     sf::RenderWindow waveFormWindow; ///< Window for rendering the waveform.
-    sf::Vertex vertices[480]; ///< Vertices for rendering the waveform.
+    std::vector<sf::Vertex> vertices; ///< Ring of waveform columns, two vertices per column.
+    sf::VertexBuffer vertexBuffer; ///< GPU copy of vertices, updated column by column.
+    bool useVertexBuffer = false; ///< False if the driver lacks vertex buffer support.
+    int writeHead = 0; ///< Ring column that receives the next waveform column.
+    sf::Uint64 columnFrame = 0; ///< First audio frame of the next waveform column.
+    sf::Vertex fade[4]; ///< Overlay that fades older columns out towards the left edge.
     sf::RenderTexture renderGraph; ///< Render texture for the waveform.
     sf::Sprite graph; ///< Sprite for displaying the waveform.
+    sf::RectangleShape timeline; ///< Line along which the seek marker moves.
+    sf::CircleShape seek; ///< Marker of the playing position on the timeline.
+    int durationSeconds = 1; ///< Length of the timeline in seconds, at least one.
+    int builtWidth = 0; ///< Graph width the render resources were created for.
+    bool warm = false; ///< True once warmUp() has created the window and render resources.
+    bool running = false; ///< True between begin() and the update() that ends the run.
 };
 
@@ -0,0 +1,482 @@
+//! \file Benchmark.cpp
+//! \brief Microbenchmarks for the analysis and render pipelines, reported as JSON.
+//!
+//! Usage: AudioVisualizerBench [--output results.json] [--filter name] [--quick]
+//! FFT wisdom from the application is used but never written, so "fft_plan" shows
+//! what a start with the current wisdom costs. "mode_switch_first_frame" opens windows
+//! and plays audio, so it only runs when the filter names it.
+//!
+#include <SFML/Audio.hpp>
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "AnalysisBus.h"
+#include "AudioBars.h"
+#include "AudioHandler.h"
+#include "BandMapping.h"
+#include "BeatMap.h"
+#include "BeatTracker.h"
+#include "DspKernels.h"
+#include "FftPlanCache.h"
+#include "OfflineRenderer.h"
+#include "PeakPyramid.h"
+#include "PitchAnalyzer.h"
+#include "SoftwareCanvas.h"
+#include "SpectrumAnalyzer.h"
+#include "WaveFormAudio.h"
+
+namespace {
+
+    /**
+     * \brief One measured configuration.
+     */
+    struct Result {
+        std::string name;                                   ///< Benchmark name.
+        std::vector<std::pair<std::string, double>> params; ///< Configuration, e.g. fft_size.
+        double nsPerOp;                                     ///< Mean wall time per operation.
+        sf::Uint64 iterations;                              ///< Operations timed.
+        double itemsPerSecond;                              ///< Throughput in items (see unit).
+        std::string unit;                                   ///< What an item is, e.g. "samples".
+    };
+
+    /**
+     * \brief Command-line settings.
+     */
+    struct Settings {
+        std::string output;         ///< JSON file; empty writes to stdout.
+        std::string filter;         ///< Only run benchmarks whose name contains this.
+        bool quick = false;         ///< Shorter runs and smaller sizes, for smoke tests.
+        double minSeconds = 0.25;   ///< Minimum timed duration per configuration.
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    /*!
+     * \brief Runs body repeatedly, doubling the batch until it takes at least minSeconds.
+     * \return Mean nanoseconds per call and the number of calls in the final batch.
+     */
+    template <typename Body>
+    std::pair<double, sf::Uint64> measure(Body&& body, double minSeconds) {
+        body();
+        for (sf::Uint64 iterations = 1; ; iterations *= 2) {
+            Clock::time_point start = Clock::now();
+            for (sf::Uint64 i = 0; i < iterations; i++) {
+                body();
+            }
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if (seconds >= minSeconds || iterations >= (1ull << 30)) {
+                return { seconds * 1e9 / iterations, iterations };
+            }
+        }
+    }
+
+    /*!
+     * \brief Writes a 16-bit stereo PCM WAV with a few sines and some noise.
+     */
+    void writeTestWav(const std::string& path, unsigned int seconds, unsigned int sampleRate) {
+        sf::Uint32 frames = seconds * sampleRate;
+        sf::Uint32 dataBytes = frames * 2 * sizeof(sf::Int16);
+
+        std::ofstream file(path, std::ios::binary);
+        auto put32 = [&](sf::Uint32 v) { file.write(reinterpret_cast<const char*>(&v), 4); };
+        auto put16 = [&](sf::Uint16 v) { file.write(reinterpret_cast<const char*>(&v), 2); };
+        file.write("RIFF", 4); put32(36 + dataBytes); file.write("WAVE", 4);
+        file.write("fmt ", 4); put32(16); put16(1); put16(2); put32(sampleRate); put32(sampleRate * 4); put16(4); put16(16);
+        file.write("data", 4); put32(dataBytes);
+
+        std::mt19937 random(1);
+        std::uniform_int_distribution<int> noise(-800, 800);
+        std::vector<sf::Int16> block(2 * sampleRate);
+        for (sf::Uint32 second = 0; second < seconds; second++) {
+            for (sf::Uint32 i = 0; i < sampleRate; i++) {
+                double t = (static_cast<double>(second) * sampleRate + i) / sampleRate;
+                double value = 9000 * std::sin(2 * 3.14159265 * 110 * t) + 5000 * std::sin(2 * 3.14159265 * 1760 * t);
+                block[2 * i] = static_cast<sf::Int16>(value + noise(random));
+                block[2 * i + 1] = static_cast<sf::Int16>(value * 0.7 + noise(random));
+            }
+            file.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(sf::Int16));
+        }
+    }
+
+    /*!
+     * \brief Writes a 16-bit mono PCM WAV of decaying noise bursts on every beat, over quiet noise.
+     */
+    void writeClickTrack(const std::string& path, unsigned int seconds, unsigned int sampleRate, double bpm) {
+        sf::Uint32 frames = seconds * sampleRate;
+        sf::Uint32 dataBytes = frames * sizeof(sf::Int16);
+
+        std::ofstream file(path, std::ios::binary);
+        auto put32 = [&](sf::Uint32 v) { file.write(reinterpret_cast<const char*>(&v), 4); };
+        auto put16 = [&](sf::Uint16 v) { file.write(reinterpret_cast<const char*>(&v), 2); };
+        file.write("RIFF", 4); put32(36 + dataBytes); file.write("WAVE", 4);
+        file.write("fmt ", 4); put32(16); put16(1); put16(1); put32(sampleRate); put32(sampleRate * 2); put16(2); put16(16);
+        file.write("data", 4); put32(dataBytes);
+
+        std::mt19937 random(3);
+        std::uniform_real_distribution<double> noise(-1.0, 1.0);
+        double period = 60.0 * sampleRate / bpm;
+        std::vector<sf::Int16> samples(frames);
+        for (sf::Uint32 i = 0; i < frames; i++) {
+            double sinceBeat = std::fmod(static_cast<double>(i), period);
+            double envelope = 20000 * std::exp(-sinceBeat / (0.01 * sampleRate));
+            samples[i] = static_cast<sf::Int16>((envelope + 300) * noise(random));
+        }
+        file.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(sf::Int16));
+    }
+
+    std::vector<sf::Int16> randomSamples(std::size_t count) {
+        std::mt19937 random(7);
+        std::uniform_int_distribution<int> distribution(-32768, 32767);
+        std::vector<sf::Int16> samples(count);
+        for (sf::Int16& sample : samples) {
+            sample = static_cast<sf::Int16>(distribution(random));
+        }
+        return samples;
+    }
+
+    void benchmarkFft(const Settings& settings, std::vector<Result>& results) {
+        std::vector<sf::Int16> samples = randomSamples(16384);
+        float magnitudes[AudioBars::BARS];
+
+        for (int size = 256; size <= 16384; size *= 2) {
+            // First use of a size plans it (or reads it from wisdom); later analyzers reuse the plan.
+            long long planned = FftPlanCache::getPlanningTime();
+            std::unique_ptr<SpectrumAnalyzer> analyzer = SpectrumAnalyzer::create(size, AudioBars::BARS);
+            double planNs = (FftPlanCache::getPlanningTime() - planned) * 1000.0;
+            results.push_back({ "fft_plan", { { "fft_size", size } }, planNs, 1, planNs > 0 ? 1e9 / planNs : 0, "plans" });
+
+            std::pair<double, sf::Uint64> m = measure([&]() { analyzer->analyze(samples.data(), magnitudes); }, settings.minSeconds);
+            results.push_back({ "fft_per_hop", { { "fft_size", size }, { "bars", AudioBars::BARS },
+                { "specialized", SpectrumAnalyzer::isSpecialized(size, AudioBars::BARS) ? 1.0 : 0.0 } }, m.first, m.second, 1e9 / m.first, "hops" });
+        }
+    }
+
+    void benchmarkBandMapping(const Settings& settings, std::vector<Result>& results) {
+        std::mt19937 random(9);
+        std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+        for (int size : { 512, 4096 }) {
+            std::vector<float> power(size / 2 + 1);
+            for (float& p : power) {
+                p = distribution(random);
+            }
+            std::vector<float> levels(AudioBars::BARS);
+
+            for (BandMapping::Scale scale : { BandMapping::Linear, BandMapping::Log, BandMapping::Mel, BandMapping::ConstantQ }) {
+                BandMapping mapping;
+                mapping.configure(scale, size, AudioBars::BARS, 44100);
+                std::pair<double, sf::Uint64> m = measure([&]() { mapping.apply(power.data(), levels.data()); }, settings.minSeconds);
+                results.push_back({ std::string("band_mapping_") + BandMapping::scaleName(scale), { { "fft_size", size }, { "bars", AudioBars::BARS } },
+                    m.first, m.second, 1e9 / m.first, "frames" });
+            }
+        }
+    }
+
+    void benchmarkKernels(const Settings& settings, std::vector<Result>& results) {
+        const std::size_t frames = 1 << 20;
+        std::vector<sf::Int16> interleaved = randomSamples(2 * frames);
+        std::vector<sf::Int16> mono(frames);
+        std::vector<sf::Int16> right(frames);
+        std::vector<float> converted(2 * frames);
+
+        std::pair<double, sf::Uint64> m = measure([&]() { dsp::downmixStereo(interleaved.data(), mono.data(), frames); }, settings.minSeconds);
+        results.push_back({ std::string("downmix_") + dsp::instructionSet(), { { "frames", frames } }, m.first, m.second, 2 * frames * 1e9 / m.first, "samples" });
+
+        m = measure([&]() { dsp::scalar::downmixStereo(interleaved.data(), mono.data(), frames); }, settings.minSeconds);
+        results.push_back({ "downmix_scalar", { { "frames", frames } }, m.first, m.second, 2 * frames * 1e9 / m.first, "samples" });
+
+        m = measure([&]() { dsp::deinterleaveStereo(interleaved.data(), mono.data(), right.data(), frames); }, settings.minSeconds);
+        results.push_back({ std::string("deinterleave_") + dsp::instructionSet(), { { "frames", frames } }, m.first, m.second, 2 * frames * 1e9 / m.first, "samples" });
+
+        m = measure([&]() { dsp::convert(interleaved.data(), converted.data(), converted.size(), 1.0f / 32768.0f); }, settings.minSeconds);
+        results.push_back({ std::string("convert_") + dsp::instructionSet(), { { "samples", converted.size() } }, m.first, m.second, converted.size() * 1e9 / m.first, "samples" });
+
+        // One lag of the YIN difference function at a 4096-sample window.
+        const std::size_t span = 2048;
+        volatile float distance = 0.0f;
+        m = measure([&]() { distance = dsp::squaredDistance(converted.data(), converted.data() + 441, span); }, settings.minSeconds);
+        results.push_back({ std::string("squared_distance_") + dsp::instructionSet(), { { "samples", span } }, m.first, m.second, span * 1e9 / m.first, "samples" });
+
+        m = measure([&]() { distance = dsp::scalar::squaredDistance(converted.data(), converted.data() + 441, span); }, settings.minSeconds);
+        results.push_back({ "squared_distance_scalar", { { "samples", span } }, m.first, m.second, span * 1e9 / m.first, "samples" });
+    }
+
+    void benchmarkPeakPyramid(const Settings& settings, std::vector<Result>& results) {
+        const unsigned int sampleRate = 44100;
+        const std::size_t chunkFrames = 65536;
+        std::vector<sf::Int16> chunk = randomSamples(2 * chunkFrames);
+
+        std::vector<int> minutes = settings.quick ? std::vector<int>{ 1, 10 } : std::vector<int>{ 1, 10, 60, 120 };
+        for (int length : minutes) {
+            sf::Uint64 frames = static_cast<sf::Uint64>(length) * 60 * sampleRate;
+            PeakPyramid pyramid;
+
+            // The same chunk is appended repeatedly so hour-long inputs need no hour-long buffer.
+            Clock::time_point start = Clock::now();
+            pyramid.reset(2, frames);
+            for (sf::Uint64 done = 0; done < frames; done += chunkFrames) {
+                pyramid.append(chunk.data(), static_cast<std::size_t>(std::min<sf::Uint64>(chunkFrames, frames - done)));
+            }
+            pyramid.finish();
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+            results.push_back({ "peak_pyramid_build", { { "minutes", length }, { "memory_bytes", static_cast<double>(pyramid.getMemoryUsage()) } },
+                ns, 1, frames * 1e9 / ns, "frames" });
+
+            std::mt19937 random(3);
+            std::uniform_int_distribution<sf::Uint64> position(0, frames - 1);
+            std::pair<double, sf::Uint64> m = measure([&]() {
+                sf::Uint64 first = position(random);
+                volatile PeakPyramid::Peak peak = pyramid.query(first, first + frames / 480);
+                (void)peak;
+            }, settings.minSeconds);
+            results.push_back({ "peak_pyramid_query", { { "minutes", length }, { "span_frames", static_cast<double>(frames / 480) } },
+                m.first, m.second, 1e9 / m.first, "queries" });
+        }
+    }
+
+    void benchmarkBarGeometry(const Settings& settings, std::vector<Result>& results) {
+        for (int bars = 32; bars <= 4096; bars *= 2) {
+            std::vector<float> magnitudes(bars);
+            std::mt19937 random(5);
+            std::uniform_real_distribution<float> distribution(0.0f, 2.0f);
+            for (float& magnitude : magnitudes) {
+                magnitude = distribution(random);
+            }
+            std::vector<sf::Vertex> vertices(4 * bars);
+
+            std::pair<double, sf::Uint64> m = measure([&]() {
+                AudioBars::buildBarGeometry(magnitudes.data(), bars, 3840.0f, 2160.0f, vertices.data());
+            }, settings.minSeconds);
+            results.push_back({ "bar_geometry_build", { { "bars", bars } }, m.first, m.second, bars * 1e9 / m.first, "bars" });
+        }
+    }
+
+    void benchmarkHeadlessFrames(const Settings& settings, std::vector<Result>& results, const std::string& wavPath) {
+        const unsigned int sizes[][2] = { { 1000, 600 }, { 1920, 1080 }, { 3840, 2160 } };
+
+        for (OfflineRenderer::Mode mode : { OfflineRenderer::Bars, OfflineRenderer::Wave }) {
+            for (const unsigned int* size : sizes) {
+                OfflineRenderer::Options options;
+                options.mode = mode;
+                options.input = wavPath;
+                options.width = size[0];
+                options.height = size[1];
+
+                OfflineRenderer renderer(options);
+                OfflineRenderer::Worker worker;
+                SoftwareCanvas canvas(size[0], size[1]);
+                sf::Uint64 frameCount = renderer.getFrameCount();
+                sf::Uint64 frame = 0;
+
+                std::pair<double, sf::Uint64> m = measure([&]() {
+                    renderer.renderFrame(frame, canvas, worker);
+                    frame = (frame + 7) % frameCount;
+                }, settings.minSeconds);
+                results.push_back({ mode == OfflineRenderer::Bars ? "headless_frame_bars" : "headless_frame_wave",
+                    { { "width", size[0] }, { "height", size[1] } }, m.first, m.second, 1e9 / m.first, "frames" });
+            }
+        }
+    }
+
+    void benchmarkBeatTracker(const Settings& settings, std::vector<Result>& results) {
+        const int barCounts[] = { 64, 128, 512 };
+        for (int bars : barCounts) {
+            BeatTracker tracker;
+            tracker.configure(bars, 256, 44100);
+            // Alternating quiet and loud spectra, so onsets, tempo and beats are all exercised.
+            std::vector<float> quiet(bars, 0.1f), loud(bars, 50.0f);
+            sf::Uint64 hop = 0;
+            std::pair<double, sf::Uint64> m = measure([&]() {
+                tracker.process(hop % 86 == 0 ? loud.data() : quiet.data(), hop * 256);
+                hop++;
+            }, settings.minSeconds);
+            results.push_back({ "beat_tracker_per_hop", { { "bars", bars } }, m.first, m.second, 1e9 / m.first, "hops" });
+        }
+    }
+
+    void benchmarkPitchAnalyzer(const Settings& settings, std::vector<Result>& results) {
+        const double frameBudgetNs = 1e9 / 60.0;
+        const int windowSizes[] = { 2048, 4096, 8192 };
+        for (int windowSize : windowSizes) {
+            // A harmonic tone at 220 Hz, so YIN stops at the first dip like it would on music.
+            std::vector<sf::Int16> samples(windowSize);
+            for (int i = 0; i < windowSize; i++) {
+                double t = i / 44100.0;
+                samples[i] = static_cast<sf::Int16>(8000 * (std::sin(2 * 3.14159265 * 220 * t) + 0.5 * std::sin(2 * 3.14159265 * 440 * t)));
+            }
+            PitchAnalyzer analyzer;
+            analyzer.configure(windowSize, 44100, 1024);
+            std::pair<double, sf::Uint64> m = measure([&]() { analyzer.analyze(samples.data()); }, settings.minSeconds);
+            results.push_back({ "pitch_analyzer_per_hop", { { "window_size", windowSize }, { "frame_budget_percent", 100.0 * m.first / frameBudgetNs } },
+                m.first, m.second, 1e9 / m.first, "windows" });
+        }
+    }
+
+    void benchmarkBeatMap(const Settings& settings, std::vector<Result>& results) {
+        const double tempos[] = { 120.0, 95.0 };
+        unsigned int seconds = settings.quick ? 10 : 60;
+        std::string wavPath = (std::filesystem::temp_directory_path() / "AudioVisualizerBeats.wav").string();
+        for (double bpm : tempos) {
+            writeClickTrack(wavPath, seconds, 44100, bpm);
+            BeatMap::Options options;
+            options.input = wavPath;
+            BeatMap beatMap(options);
+            BeatMap::Result result;
+            std::pair<double, sf::Uint64> m = measure([&]() { result = beatMap.run(); }, settings.minSeconds);
+            results.push_back({ "beat_map", { { "expected_bpm", bpm }, { "detected_bpm", result.bpm }, { "beats", static_cast<double>(result.beats.size()) } },
+                m.first, m.second, seconds * 1e9 / m.first, "audio_seconds" });
+        }
+        std::filesystem::remove(wavPath);
+    }
+
+    /*!
+     * \brief Times from begin() to the end of the first update(), i.e. until the first frame is on screen.
+     */
+    double measureFirstFrame(AudioVisualizer& visualizer) {
+        Clock::time_point start = Clock::now();
+        visualizer.begin();
+        visualizer.update();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        visualizer.end();
+        return ns;
+    }
+
+    void benchmarkModeSwitch(const Settings& settings, std::vector<Result>& results, const std::string& wavPath) {
+        AudioHandler handler;
+        AnalysisBus bus(handler);
+        bus.loadFile(wavPath);
+        AudioBars bars(bus);
+        bars.loadFile();
+        WaveFormAudio wave(bus);
+        wave.loadFile();
+        const int switches = settings.quick ? 3 : 20;
+
+        std::pair<const char*, AudioVisualizer*> modes[] = {
+            { "mode_switch_first_frame_bars", &bars },
+            { "mode_switch_first_frame_wave", &wave }
+        };
+        for (const std::pair<const char*, AudioVisualizer*>& mode : modes) {
+            // The first begin() warms up: window, GL resources, worker thread and FFT plan.
+            double cold = measureFirstFrame(*mode.second);
+            results.push_back({ mode.first, { { "warm", 0 } }, cold, 1, 1e9 / cold, "switches" });
+
+            double total = 0;
+            for (int i = 0; i < switches; i++) {
+                total += measureFirstFrame(*mode.second);
+            }
+            results.push_back({ mode.first, { { "warm", 1 } }, total / switches, static_cast<sf::Uint64>(switches), switches * 1e9 / total, "switches" });
+        }
+    }
+
+    std::string toJson(const std::vector<Result>& results) {
+        std::ostringstream json;
+        json.precision(10);
+        json << "{\n  \"context\": { \"instruction_set\": \"" << dsp::instructionSet()
+             << "\", \"hardware_threads\": " << std::thread::hardware_concurrency() << " },\n  \"benchmarks\": [\n";
+        for (std::size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            json << "    { \"name\": \"" << r.name << "\", \"params\": {";
+            for (std::size_t p = 0; p < r.params.size(); p++) {
+                json << (p ? ", " : " ") << "\"" << r.params[p].first << "\": " << r.params[p].second;
+            }
+            json << " }, \"ns_per_op\": " << r.nsPerOp << ", \"iterations\": " << r.iterations
+                 << ", \"items_per_second\": " << r.itemsPerSecond << ", \"unit\": \"" << r.unit << "\" }"
+                 << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        json << "  ]\n}\n";
+        return json.str();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Settings settings;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            settings.output = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            settings.filter = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--quick") == 0) {
+            settings.quick = true;
+            settings.minSeconds = 0.02;
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--output results.json] [--filter name] [--quick]" << std::endl;
+            return 2;
+        }
+    }
+
+    auto selected = [&](const char* name) {
+        return settings.filter.empty() || std::string(name).find(settings.filter) != std::string::npos;
+    };
+
+    std::vector<Result> results;
+    FftPlanCache::loadWisdom();
+    try {
+        if (selected("fft_per_hop")) {
+            benchmarkFft(settings, results);
+        }
+        if (selected("band_mapping")) {
+            benchmarkBandMapping(settings, results);
+        }
+        if (selected("downmix") || selected("deinterleave") || selected("convert") || selected("squared_distance")) {
+            benchmarkKernels(settings, results);
+        }
+        if (selected("peak_pyramid")) {
+            benchmarkPeakPyramid(settings, results);
+        }
+        if (selected("bar_geometry_build")) {
+            benchmarkBarGeometry(settings, results);
+        }
+        if (selected("beat_tracker")) {
+            benchmarkBeatTracker(settings, results);
+        }
+        if (selected("pitch_analyzer")) {
+            benchmarkPitchAnalyzer(settings, results);
+        }
+        if (selected("beat_map")) {
+            benchmarkBeatMap(settings, results);
+        }
+        if (selected("headless_frame")) {
+            std::string wavPath = (std::filesystem::temp_directory_path() / "AudioVisualizerBench.wav").string();
+            writeTestWav(wavPath, settings.quick ? 5 : 60, 44100);
+            benchmarkHeadlessFrames(settings, results, wavPath);
+            std::filesystem::remove(wavPath);
+        }
+        if (settings.filter.find("mode_switch") != std::string::npos) {
+            std::string wavPath = (std::filesystem::temp_directory_path() / "AudioVisualizerBench.wav").string();
+            writeTestWav(wavPath, 30, 44100);
+            benchmarkModeSwitch(settings, results, wavPath);
+            std::filesystem::remove(wavPath);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::string json = toJson(results);
+    if (settings.output.empty()) {
+        std::cout << json;
+    }
+    else {
+        std::ofstream(settings.output) << json;
+    }
+    return 0;
+}
@@ -2,18 +2,298 @@
 //! \brief Entry point for the Audio Visualizer application.
 //! 
 #include "MainWindow.h"
+#include "OfflineRenderer.h"
+#include "BatchAnalyzer.h"
+#include "BeatMap.h"
+#include "FrameProfiler.h"
+#include "FftPlanCache.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
 
 /*!
- * \brief Main function that initiates and runs the Audio Visualizer.
+ * \brief Parses the arguments of the headless render mode.
  *
- * This function creates the main window of the application and runs it.
+ * Usage: --render <bars|wave> <input> <output.y4m|output-directory> [--size WxH] [--fps N] [--threads N]
  *
- * \return Returns 0 upon successful execution.
+ * \param argc Argument count.
+ * \param argv Arguments; argv[1] is "--render".
+ * \param options Receives the parsed options.
+ * \return False if the arguments are malformed.
+ */
+static bool parseRenderOptions(int argc, char* argv[], OfflineRenderer::Options& options)
+{
+    if (argc < 5) {
+        return false;
+    }
+    if (std::strcmp(argv[2], "bars") == 0) {
+        options.mode = OfflineRenderer::Bars;
+    }
+    else if (std::strcmp(argv[2], "wave") == 0) {
+        options.mode = OfflineRenderer::Wave;
+    }
+    else {
+        return false;
+    }
+    options.input = argv[3];
+    options.output = argv[4];
+
+    for (int i = 5; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--size") == 0) {
+            if (std::sscanf(argv[i + 1], "%ux%u", &options.width, &options.height) != 2) {
+                return false;
+            }
+        }
+        else if (std::strcmp(argv[i], "--fps") == 0) {
+            options.fps = static_cast<unsigned int>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0) {
+            options.threads = static_cast<unsigned int>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else {
+            return false;
+        }
+    }
+    return (argc - 5) % 2 == 0;
+}
+
+/*!
+ * \brief Parses the arguments of the headless batch analysis mode.
+ *
+ * Usage: --analyze <input-directory> <output-directory> [--threads N] [--in-flight N] [--overlap F]
+ *
+ * \param argc Argument count.
+ * \param argv Arguments; argv[1] is "--analyze".
+ * \param options Receives the parsed options.
+ * \return False if the arguments are malformed.
+ */
+static bool parseAnalyzeOptions(int argc, char* argv[], BatchAnalyzer::Options& options)
+{
+    if (argc < 4) {
+        return false;
+    }
+    options.input = argv[2];
+    options.output = argv[3];
+
+    for (int i = 4; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--threads") == 0) {
+            options.threads = static_cast<unsigned int>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--in-flight") == 0) {
+            options.filesInFlight = static_cast<unsigned int>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--overlap") == 0) {
+            options.overlap = static_cast<float>(std::atof(argv[i + 1]));
+        }
+        else {
+            return false;
+        }
+    }
+    return (argc - 4) % 2 == 0;
+}
+
+/*!
+ * \brief Parses the arguments of the headless beat map mode.
+ *
+ * Usage: --beats <input> [output.csv] [--threads N] [--overlap F]
+ *
+ * \param argc Argument count.
+ * \param argv Arguments; argv[1] is "--beats".
+ * \param options Receives the parsed options.
+ * \param output Receives the CSV path, or stays empty to print only the summary.
+ * \return False if the arguments are malformed.
+ */
+static bool parseBeatsOptions(int argc, char* argv[], BeatMap::Options& options, std::string& output)
+{
+    if (argc < 3) {
+        return false;
+    }
+    options.input = argv[2];
+    int first = 3;
+    if (argc > 3 && std::strncmp(argv[3], "--", 2) != 0) {
+        output = argv[3];
+        first = 4;
+    }
+
+    for (int i = first; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--threads") == 0) {
+            options.threads = static_cast<unsigned int>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--overlap") == 0) {
+            options.overlap = static_cast<float>(std::atof(argv[i + 1]));
+        }
+        else {
+            return false;
+        }
+    }
+    return (argc - first) % 2 == 0;
+}
+
+/*!
+ * \brief Options that apply to both the interactive application and the headless renderer.
+ *
+ * They come first on the command line:
+ * [--profile <file.csv|file.json>] [--fft-size N] [--bars N] [--scale linear|log|mel|cq]
+ */
+struct GlobalOptions {
+    std::string profilePath;            ///< Frame timing histograms are written here on exit.
+    int fftSize = AudioBars::FFT_SIZE;  ///< Samples per FFT window of the bars visualizer.
+    int bars = AudioBars::BARS;         ///< Number of bars.
+    BandMapping::Scale scale = AudioBars::DEFAULT_SCALE; ///< Spacing of the bars.
+};
+
+/*!
+ * \brief Consumes the leading global options.
+ * \param argc Argument count; reduced by the consumed arguments.
+ * \param argv Arguments; advanced past the consumed arguments, keeping argv[0].
+ * \param options Receives the parsed options.
+ * \return False if the options are malformed.
+ */
+static bool parseGlobalOptions(int& argc, char**& argv, GlobalOptions& options)
+{
+    while (argc > 2) {
+        if (std::strcmp(argv[1], "--profile") == 0) {
+            options.profilePath = argv[2];
+        }
+        else if (std::strcmp(argv[1], "--fft-size") == 0) {
+            options.fftSize = std::atoi(argv[2]);
+        }
+        else if (std::strcmp(argv[1], "--bars") == 0) {
+            options.bars = std::atoi(argv[2]);
+        }
+        else if (std::strcmp(argv[1], "--scale") == 0) {
+            if (!BandMapping::parseScale(argv[2], options.scale)) {
+                return false;
+            }
+        }
+        else {
+            break;
+        }
+        argv[2] = argv[0];
+        argc -= 2;
+        argv += 2;
+    }
+    return SpectrumAnalyzer::isValid(options.fftSize, options.bars) && options.bars <= AudioBars::MAX_BARS;
+}
+
+/*!
+ * \brief Runs the interactive application, the headless renderer, the batch analysis or the beat map.
+ * \param argc Argument count, without the global options.
+ * \param argv Arguments, without the global options.
+ * \param global Parsed global options.
+ * \return Exit status.
  */
-int main()
+static int run(int argc, char* argv[], const GlobalOptions& global)
 {
+    if (argc > 1 && std::strcmp(argv[1], "--render") == 0) {
+        OfflineRenderer::Options options;
+        options.fftSize = global.fftSize;
+        options.bars = global.bars;
+        options.scale = global.scale;
+        if (!parseRenderOptions(argc, argv, options)) {
+            std::cerr << "Usage: " << argv[0] << " [--profile file] [--fft-size N] [--bars N] [--scale S] --render <bars|wave> <input>"
+                " <output.y4m|output-directory> [--size WxH] [--fps N] [--threads N]" << std::endl;
+            return 2;
+        }
+        try {
+            OfflineRenderer renderer(options);
+            renderer.render();
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "--analyze") == 0) {
+        BatchAnalyzer::Options options;
+        options.fftSize = global.fftSize;
+        options.bars = global.bars;
+        options.scale = global.scale;
+        if (!parseAnalyzeOptions(argc, argv, options)) {
+            std::cerr << "Usage: " << argv[0] << " [--profile file] [--fft-size N] [--bars N] [--scale S] --analyze <input-directory>"
+                " <output-directory> [--threads N] [--in-flight N] [--overlap F]" << std::endl;
+            return 2;
+        }
+        try {
+            BatchAnalyzer analyzer(options);
+            BatchAnalyzer::Report report = analyzer.run();
+            std::cout << report.files << " files, " << report.failed << " failed, " << report.audioSeconds << " s of audio in "
+                << report.wallSeconds << " s" << std::endl;
+            return report.failed ? 1 : 0;
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "--beats") == 0) {
+        BeatMap::Options options;
+        options.fftSize = global.fftSize;
+        options.bars = global.bars;
+        options.scale = global.scale;
+        std::string output;
+        if (!parseBeatsOptions(argc, argv, options, output)) {
+            std::cerr << "Usage: " << argv[0] << " [--profile file] [--fft-size N] [--bars N] [--scale S] --beats <input>"
+                " [output.csv] [--threads N] [--overlap F]" << std::endl;
+            return 2;
+        }
+        try {
+            BeatMap beatMap(options);
+            BeatMap::Result result = beatMap.run();
+            std::cout << result.bpm << " BPM, " << result.beats.size() << " beats, " << result.onsets << " onsets in "
+                << result.wallSeconds << " s" << std::endl;
+            if (!output.empty() && !BeatMap::write(result, output)) {
+                std::cerr << "Failed to write " << output << std::endl;
+                return 1;
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
     MainWindow mainWindow(1000, 800, "Audio Vizualiser");
+    mainWindow.setAnalysisSize(global.fftSize, global.bars);
+    mainWindow.setBarScale(global.scale);
     mainWindow.run();
     return 0;
 }
 
+/*!
+ * \brief Main function that initiates and runs the Audio Visualizer.
+ *
+ * This function creates the main window of the application and runs it.
+ * With "--render" it instead renders a visualizer to disk without opening a window,
+ * with "--analyze" it writes spectral summaries for every WAV file under a directory,
+ * and with "--beats" it lists the tempo and beats of a file.
+ * Global options before either mode set the FFT size, bar count and bar spacing
+ * ("--fft-size", "--bars", "--scale") and write frame timing histograms to a CSV or JSON file on exit ("--profile").
+ *
+ * \return Returns 0 upon successful execution.
+ */
+int main(int argc, char* argv[])
+{
+    GlobalOptions global;
+    if (!parseGlobalOptions(argc, argv, global)) {
+        std::cerr << "Unknown scale, or unsupported FFT size or bar count; the FFT size must be a power of two from "
+            << SpectrumAnalyzer::MIN_FFT_SIZE << " to " << SpectrumAnalyzer::MAX_FFT_SIZE
+            << " with at most fft-size / 2 + 1 bars." << std::endl;
+        return 2;
+    }
+
+    // Wisdom from earlier runs lets FFT plans skip measurement; new plans are kept for the next run.
+    FftPlanCache::loadWisdom();
+    int status = run(argc, argv, global);
+    FftPlanCache::saveWisdom();
+
+    if (!global.profilePath.empty() && !FrameProfiler::dump(global.profilePath)) {
+        std::cerr << "Failed to write " << global.profilePath << std::endl;
+    }
+    return status;
+}
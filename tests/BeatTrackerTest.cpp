@@ -0,0 +1,140 @@
+//! \file BeatTrackerTest.cpp
+//! \brief Finds the beats of synthetic click tracks through BeatMap and a sequential BeatTracker.
+//!
+//! Each click track is written as a mono 16-bit WAV file and scanned by BeatMap::run() on
+//! several threads. The file is long enough to span several BeatMap segments, and the
+//! result must equal a sequential BeatTracker pass over the same samples beat for beat, so
+//! a wrong flux at a segment boundary shows up. The beats must land on the clicks, their
+//! number must match the tempo, and the tempo must be found within BPM_TOLERANCE from
+//! MIN_BPM to MAX_BPM, on both sides of the 120 BPM the tracker prefers. Silence has no
+//! beats at all.
+//!
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BeatMap.h"
+#include "BeatTracker.h"
+#include "Check.h"
+#include "SpectrumAnalyzer.h"
+
+namespace {
+
+    const unsigned int SAMPLE_RATE = 44100;
+    const unsigned int SECONDS = 30;            ///< Long enough for several BeatMap segments.
+    const double BPM_TOLERANCE = 2.0;           ///< Largest error of the tempo estimate.
+    const double CLICK_TOLERANCE = 0.03;        ///< Largest distance of a beat from its click, in seconds.
+    const double MIN_BEAT_SHARE = 0.85;         ///< Share of the clicks that must get a beat; the tempo needs a few seconds to settle.
+
+    /*!
+     * \brief Noise bursts that decay within about 10 ms, bpm times per minute, over a faint noise floor.
+     * \param bpm Tempo; 0 gives silence.
+     */
+    std::vector<sf::Int16> clickTrack(double bpm) {
+        std::vector<sf::Int16> samples(SECONDS * SAMPLE_RATE, 0);
+        if (bpm <= 0.0) {
+            return samples;
+        }
+        std::mt19937 random(3);
+        std::uniform_real_distribution<double> noise(-1.0, 1.0);
+        double period = 60.0 * SAMPLE_RATE / bpm;
+        for (std::size_t i = 0; i < samples.size(); i++) {
+            double sinceBeat = std::fmod(static_cast<double>(i), period);
+            double envelope = 20000 * std::exp(-sinceBeat / (0.01 * SAMPLE_RATE));
+            samples[i] = static_cast<sf::Int16>((envelope + 300) * noise(random));
+        }
+        return samples;
+    }
+
+    void writeWav(const std::string& path, const std::vector<sf::Int16>& samples) {
+        sf::Uint32 dataBytes = static_cast<sf::Uint32>(samples.size() * sizeof(sf::Int16));
+        std::ofstream file(path, std::ios::binary);
+        auto put32 = [&](sf::Uint32 v) { file.write(reinterpret_cast<const char*>(&v), 4); };
+        auto put16 = [&](sf::Uint16 v) { file.write(reinterpret_cast<const char*>(&v), 2); };
+        file.write("RIFF", 4); put32(36 + dataBytes); file.write("WAVE", 4);
+        file.write("fmt ", 4); put32(16); put16(1); put16(1); put32(SAMPLE_RATE); put32(SAMPLE_RATE * 2); put16(2); put16(16);
+        file.write("data", 4); put32(dataBytes);
+        file.write(reinterpret_cast<const char*>(samples.data()), dataBytes);
+    }
+
+    /*!
+     * \brief Runs one BeatTracker over every column in order, the way AnalysisBus does during playback.
+     */
+    BeatMap::Result trackSequentially(const std::vector<sf::Int16>& samples, const BeatMap::Options& options) {
+        std::size_t hop = static_cast<std::size_t>(options.fftSize * (1.0f - options.overlap));
+        std::unique_ptr<SpectrumAnalyzer> analyzer = SpectrumAnalyzer::create(options.fftSize, options.bars, options.scale, SAMPLE_RATE);
+        std::vector<float> magnitudes(options.bars);
+        BeatTracker tracker;
+        tracker.configure(options.bars, hop, SAMPLE_RATE);
+
+        BeatMap::Result result;
+        for (std::size_t first = 0; first + options.fftSize <= samples.size(); first += hop) {
+            analyzer->analyze(samples.data() + first, magnitudes.data());
+            if (tracker.process(magnitudes.data(), first + options.fftSize / 2)) {
+                result.beats.push_back({ tracker.getState().lastBeatFrame, tracker.getState().bpm, tracker.lastBeatWasOnset() });
+            }
+        }
+        result.bpm = tracker.getState().bpm;
+        result.onsets = tracker.getState().onsetCount;
+        return result;
+    }
+
+    bool sameBeats(const BeatMap::Result& a, const BeatMap::Result& b) {
+        if (a.beats.size() != b.beats.size() || a.bpm != b.bpm || a.onsets != b.onsets) {
+            return false;
+        }
+        for (std::size_t i = 0; i < a.beats.size(); i++) {
+            if (a.beats[i].frame != b.beats[i].frame || a.beats[i].bpm != b.beats[i].bpm || a.beats[i].onset != b.beats[i].onset) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void checkTrack(double bpm, const std::string& path) {
+        std::string name = bpm > 0.0 ? std::to_string(static_cast<int>(bpm)) + " BPM" : "silence";
+        std::vector<sf::Int16> samples = clickTrack(bpm);
+        writeWav(path, samples);
+
+        BeatMap::Options options;
+        options.input = path;
+        options.threads = 3;
+        BeatMap::Result result = BeatMap(options).run();
+        test::check(result.sampleRate == SAMPLE_RATE && result.frames == samples.size(), name + ": file read back");
+        test::check(sameBeats(result, trackSequentially(samples, options)), name + ": BeatMap matches a sequential pass");
+
+        if (bpm <= 0.0) {
+            test::check(result.beats.empty() && result.onsets == 0 && result.bpm == 0.0f, name + ": no beats");
+            return;
+        }
+        test::check(std::abs(result.bpm - bpm) <= BPM_TOLERANCE, name + ": tempo " + std::to_string(result.bpm));
+
+        double period = 60.0 * SAMPLE_RATE / bpm;
+        std::size_t clicks = static_cast<std::size_t>(std::ceil(samples.size() / period));
+        test::check(result.beats.size() >= MIN_BEAT_SHARE * clicks && result.beats.size() <= clicks,
+            name + ": " + std::to_string(result.beats.size()) + " beats for " + std::to_string(clicks) + " clicks");
+
+        std::size_t onClick = 0;
+        for (const BeatTracker::Beat& beat : result.beats) {
+            double fromClick = std::fmod(static_cast<double>(beat.frame) + period / 2, period) - period / 2;
+            if (std::abs(fromClick) <= CLICK_TOLERANCE * SAMPLE_RATE) {
+                onClick++;
+            }
+        }
+        test::check(onClick == result.beats.size(), name + ": " + std::to_string(result.beats.size() - onClick) + " beats off the clicks");
+    }
+}
+
+int main()
+{
+    std::string path = (std::filesystem::temp_directory_path() / "BeatTrackerTest.wav").string();
+    for (double bpm : { 120.0, 95.0, 150.0, 72.0, 180.0, 200.0, 60.0, 0.0 }) {
+        checkTrack(bpm, path);
+    }
+    std::filesystem::remove(path);
+    return test::finish("BeatTrackerTest");
+}
@@ -0,0 +1,48 @@
+//! \file Check.h
+//! \brief Minimal assertions shared by the test executables.
+//!
+//! A test is a plain executable: it runs its checks, prints each failure and returns
+//! a non-zero status if any failed, which is all ctest needs.
+//!
+#pragma once
+#include <iostream>
+#include <string>
+
+namespace test {
+
+    /*!
+     * \brief Number of failed checks so far in this executable.
+     */
+    inline int& failures() {
+        static int count = 0;
+        return count;
+    }
+
+    /*!
+     * \brief Records a failure if a condition does not hold.
+     * \param condition Condition that must hold.
+     * \param what Description printed on failure.
+     * \return The condition, so callers can stop early.
+     */
+    inline bool check(bool condition, const std::string& what) {
+        if (!condition) {
+            failures()++;
+            std::cerr << "FAILED: " << what << std::endl;
+        }
+        return condition;
+    }
+
+    /*!
+     * \brief Prints a summary and returns the exit status of the test.
+     * \param name Name of the test executable.
+     * \return 0 if every check passed, 1 otherwise.
+     */
+    inline int finish(const char* name) {
+        if (failures()) {
+            std::cerr << name << ": " << failures() << " check(s) failed" << std::endl;
+            return 1;
+        }
+        std::cout << name << ": all checks passed" << std::endl;
+        return 0;
+    }
+}
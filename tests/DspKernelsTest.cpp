@@ -0,0 +1,155 @@
+//! \file DspKernelsTest.cpp
+//! \brief Checks every SIMD dispatch level of the DSP kernels bit for bit against dsp::scalar.
+//!
+//! Each instruction set the CPU supports is forced in turn with dsp::selectInstructionSet().
+//! Lengths cover every remainder of the vector widths, buffers start at unaligned
+//! offsets, and the samples include the 16-bit extremes, which is where the integer
+//! paths saturate or round differently if they are wrong.
+//!
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "DspKernels.h"
+
+namespace {
+
+    const std::size_t MAX_OFFSET = 3;   ///< Buffers start up to this many elements past an aligned address.
+
+    std::vector<std::size_t> testLengths() {
+        std::vector<std::size_t> lengths;
+        for (std::size_t n = 0; n <= 70; n++) {
+            lengths.push_back(n);
+        }
+        for (std::size_t n : { 127, 128, 129, 255, 1000, 4095, 4099 }) {
+            lengths.push_back(n);
+        }
+        return lengths;
+    }
+
+    /*!
+     * \brief Random samples with runs of -32768 and 32767 mixed in.
+     */
+    std::vector<sf::Int16> testSamples(std::size_t count, std::mt19937& random) {
+        std::uniform_int_distribution<int> value(-32768, 32767);
+        std::uniform_int_distribution<int> pick(0, 7);
+        std::vector<sf::Int16> samples(count);
+        for (sf::Int16& sample : samples) {
+            int kind = pick(random);
+            sample = static_cast<sf::Int16>(kind == 0 ? -32768 : kind == 1 ? 32767 : kind == 2 ? -1 : value(random));
+        }
+        return samples;
+    }
+
+    std::vector<float> testFloats(std::size_t count, std::mt19937& random) {
+        std::uniform_real_distribution<float> value(-2.0f, 2.0f);
+        std::uniform_int_distribution<int> pick(0, 9);
+        std::vector<float> values(count);
+        for (float& v : values) {
+            int kind = pick(random);
+            v = kind == 0 ? 0.0f : kind == 1 ? -0.0f : kind == 2 ? 1e6f : kind == 3 ? -1.0f : value(random);
+        }
+        return values;
+    }
+
+    template <typename T>
+    bool same(const std::vector<T>& a, const std::vector<T>& b) {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+    }
+
+    void checkLevel(const std::string& level) {
+        std::mt19937 random(11);
+        for (std::size_t n : testLengths()) {
+            for (std::size_t offset = 0; offset <= MAX_OFFSET; offset++) {
+                std::string where = level + " n=" + std::to_string(n) + " offset=" + std::to_string(offset);
+                std::vector<sf::Int16> interleaved = testSamples(6 * n + offset, random);
+                const sf::Int16* src = interleaved.data() + offset;
+
+                {
+                    std::vector<float> simd(n + offset), reference(n + offset);
+                    dsp::convert(src, simd.data() + offset, n, 1.0f / 32768.0f);
+                    dsp::scalar::convert(src, reference.data() + offset, n, 1.0f / 32768.0f);
+                    test::check(same(simd, reference), "convert " + where);
+                }
+                {
+                    std::vector<float> simd = testFloats(n + offset, random), reference = simd;
+                    dsp::scale(simd.data() + offset, n, 0.37f);
+                    dsp::scalar::scale(reference.data() + offset, n, 0.37f);
+                    test::check(same(simd, reference), "scale " + where);
+                }
+                {
+                    std::vector<float> window = testFloats(n + offset, random);
+                    std::vector<float> simd = testFloats(n + offset, random), reference = simd;
+                    dsp::multiply(simd.data() + offset, window.data() + offset, n);
+                    dsp::scalar::multiply(reference.data() + offset, window.data() + offset, n);
+                    test::check(same(simd, reference), "multiply " + where);
+                }
+                {
+                    std::vector<float> a = testFloats(n + offset, random), b = testFloats(n + 2 * offset, random);
+                    float simd = dsp::squaredDistance(a.data() + offset, b.data() + 2 * offset, n);
+                    float reference = dsp::scalar::squaredDistance(a.data() + offset, b.data() + 2 * offset, n);
+                    test::check(std::memcmp(&simd, &reference, sizeof(float)) == 0, "squaredDistance " + where);
+                }
+                {
+                    std::vector<sf::Int16> simd(n + offset), reference(n + offset);
+                    dsp::downmixStereo(src, simd.data() + offset, n);
+                    dsp::scalar::downmixStereo(src, reference.data() + offset, n);
+                    test::check(same(simd, reference), "downmixStereo " + where);
+                }
+                {
+                    std::vector<sf::Int16> left(n + offset), right(n + offset), referenceLeft(n + offset), referenceRight(n + offset);
+                    dsp::deinterleaveStereo(src, left.data() + offset, right.data() + offset, n);
+                    dsp::scalar::deinterleaveStereo(src, referenceLeft.data() + offset, referenceRight.data() + offset, n);
+                    test::check(same(left, referenceLeft) && same(right, referenceRight), "deinterleaveStereo " + where);
+                }
+                for (unsigned int channels : { 1u, 2u, 3u, 6u }) {
+                    // downmix() picks its own path per channel count; the reference is the plain average.
+                    std::vector<sf::Int16> simd(n + offset), reference(n + offset);
+                    dsp::downmix(src, simd.data() + offset, n, channels);
+                    for (std::size_t i = 0; i < n; i++) {
+                        int sum = 0;
+                        for (unsigned int c = 0; c < channels; c++) {
+                            sum += src[i * channels + c];
+                        }
+                        reference[offset + i] = static_cast<sf::Int16>(sum / static_cast<int>(channels));
+                    }
+                    test::check(same(simd, reference), "downmix channels=" + std::to_string(channels) + " " + where);
+                }
+            }
+        }
+
+        // Both channels at the extremes: the sum leaves 16 bits before it is halved.
+        const sf::Int16 extremes[] = { -32768, -32768, 32767, 32767, -32768, 32767, 32767, -32768, -1, 0, 1, -1 };
+        std::vector<sf::Int16> interleaved;
+        for (int repeat = 0; repeat < 8; repeat++) {
+            interleaved.insert(interleaved.end(), std::begin(extremes), std::end(extremes));
+        }
+        std::size_t frames = interleaved.size() / 2;
+        std::vector<sf::Int16> simd(frames), reference(frames);
+        dsp::downmixStereo(interleaved.data(), simd.data(), frames);
+        dsp::scalar::downmixStereo(interleaved.data(), reference.data(), frames);
+        test::check(same(simd, reference), "downmixStereo extremes " + level);
+        test::check(simd[0] == -32768 && simd[1] == 32767 && simd[2] == 0 && simd[3] == 0 && simd[4] == 0, "downmixStereo extreme values " + level);
+
+        std::vector<float> converted(interleaved.size());
+        dsp::convert(interleaved.data(), converted.data(), converted.size(), 1.0f / 32768.0f);
+        test::check(converted[0] == -1.0f && converted[2] == 32767.0f / 32768.0f, "convert extreme values " + level);
+    }
+}
+
+int main()
+{
+    const char* levels[] = { "scalar", "sse2", "avx2" };
+    for (const char* level : levels) {
+        if (!dsp::selectInstructionSet(level)) {
+            std::cout << "DspKernelsTest: " << level << " not supported here, skipped" << std::endl;
+            continue;
+        }
+        test::check(std::string(dsp::instructionSet()) == level, std::string("selected ") + level);
+        checkLevel(level);
+    }
+    test::check(!dsp::selectInstructionSet("neon"), "unknown instruction set rejected");
+    return test::finish("DspKernelsTest");
+}
@@ -0,0 +1,155 @@
+//! \file PitchAnalyzerTest.cpp
+//! \brief Checks the fundamental, chroma, chord and key of synthetic tones and triads.
+//!
+//! Harmonic tones across the whole pitch range, up to just below MAX_FREQUENCY, must
+//! give their fundamental within FREQUENCY_TOLERANCE. Major and minor triads must give
+//! their chord and their notes as the strongest pitch classes, and a I-IV-V-I
+//! progression must settle on its key. Silence has no pitch, no chroma and no chord.
+//!
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "PitchAnalyzer.h"
+
+namespace {
+
+    const unsigned int SAMPLE_RATE = 44100;
+    const int WINDOW_SIZE = PitchAnalyzer::WINDOW_SIZE;
+    const std::size_t HOP_FRAMES = 1024;
+    const double FREQUENCY_TOLERANCE = 0.005;   ///< Largest relative error of the fundamental.
+    const double PI = 3.14159265358979323846;
+
+    double noteFrequency(int midiNote) {
+        return 440.0 * std::pow(2.0, (midiNote - 69) / 12.0);
+    }
+
+    /*!
+     * \brief Sum of tones with a few harmonics each, falling off as 1 / harmonic.
+     * \param frequencies Fundamentals in Hz.
+     * \param harmonics Partials per tone, including the fundamental.
+     */
+    std::vector<sf::Int16> tones(const std::vector<double>& frequencies, int harmonics) {
+        std::vector<double> signal(WINDOW_SIZE, 0.0);
+        for (double frequency : frequencies) {
+            for (int h = 1; h <= harmonics && h * frequency < SAMPLE_RATE / 2; h++) {
+                for (int i = 0; i < WINDOW_SIZE; i++) {
+                    signal[i] += std::sin(2.0 * PI * frequency * h * i / SAMPLE_RATE + h) / h;
+                }
+            }
+        }
+        double peak = 1e-9;
+        for (double value : signal) {
+            peak = std::max(peak, std::abs(value));
+        }
+        std::vector<sf::Int16> samples(WINDOW_SIZE);
+        for (int i = 0; i < WINDOW_SIZE; i++) {
+            samples[i] = static_cast<sf::Int16>(std::lround(16000.0 * signal[i] / peak));
+        }
+        return samples;
+    }
+
+    std::vector<sf::Int16> triad(int root, int third, int fifth) {
+        return tones({ noteFrequency(root), noteFrequency(third), noteFrequency(fifth) }, 3);
+    }
+
+    /*!
+     * \brief Checks that the pitch classes of the notes hold the most chroma energy.
+     */
+    bool notesLead(const std::array<float, 12>& chroma, std::initializer_list<int> notes) {
+        float weakestNote = 1.0f, strongestOther = 0.0f;
+        for (int pitchClass = 0; pitchClass < 12; pitchClass++) {
+            bool isNote = std::find_if(notes.begin(), notes.end(), [pitchClass](int note) { return note % 12 == pitchClass; }) != notes.end();
+            if (isNote) {
+                weakestNote = std::min(weakestNote, chroma[pitchClass]);
+            }
+            else {
+                strongestOther = std::max(strongestOther, chroma[pitchClass]);
+            }
+        }
+        return weakestNote > strongestOther;
+    }
+
+    void checkFrequencies() {
+        PitchAnalyzer analyzer;
+        analyzer.configure(WINDOW_SIZE, SAMPLE_RATE, HOP_FRAMES);
+        for (double frequency : { 55.0, 82.41, 110.0, 196.0, 261.63, 440.0, 880.0, 1500.0, 1990.0 }) {
+            analyzer.analyze(tones({ frequency }, 5).data());
+            const PitchAnalyzer::Features& features = analyzer.getFeatures();
+            test::check(std::abs(features.frequency - frequency) <= FREQUENCY_TOLERANCE * frequency,
+                "f0 " + std::to_string(frequency) + " Hz read as " + std::to_string(features.frequency));
+            test::check(features.periodicity > 0.8f, "periodicity of " + std::to_string(frequency) + " Hz");
+        }
+    }
+
+    void checkChords() {
+        struct Chord {
+            const char* name;
+            int notes[3];
+        };
+        const Chord chords[] = {
+            { "C", { 60, 64, 67 } },
+            { "Am", { 57, 60, 64 } },
+            { "F#", { 54, 58, 61 } },
+            { "D#m", { 63, 66, 70 } },
+            { "G", { 55, 59, 62 } }
+        };
+        PitchAnalyzer analyzer;
+        analyzer.configure(WINDOW_SIZE, SAMPLE_RATE, HOP_FRAMES);
+        for (const Chord& chord : chords) {
+            analyzer.analyze(triad(chord.notes[0], chord.notes[1], chord.notes[2]).data());
+            const PitchAnalyzer::Features& features = analyzer.getFeatures();
+            test::check(std::string(PitchAnalyzer::chordName(features.chord)) == chord.name,
+                std::string("chord ") + chord.name + " read as " + PitchAnalyzer::chordName(features.chord));
+            test::check(notesLead(features.chroma, { chord.notes[0], chord.notes[1], chord.notes[2] }), std::string("chroma of ") + chord.name);
+            test::check(*std::max_element(features.chroma.begin(), features.chroma.end()) == 1.0f, std::string("chroma scale of ") + chord.name);
+        }
+    }
+
+    /*!
+     * \brief Plays I-IV-V-I through a fresh analyzer and checks the key it settles on.
+     */
+    void checkKey(const char* name, const int progression[4][3]) {
+        PitchAnalyzer analyzer;
+        analyzer.configure(WINDOW_SIZE, SAMPLE_RATE, HOP_FRAMES);
+        for (int repeat = 0; repeat < 20; repeat++) {
+            for (int chord = 0; chord < 4; chord++) {
+                std::vector<sf::Int16> samples = triad(progression[chord][0], progression[chord][1], progression[chord][2]);
+                for (int window = 0; window < 4; window++) {
+                    analyzer.analyze(samples.data());
+                }
+            }
+        }
+        test::check(std::string(PitchAnalyzer::chordName(analyzer.getFeatures().key)) == name,
+            std::string("key ") + name + " read as " + PitchAnalyzer::chordName(analyzer.getFeatures().key));
+    }
+
+    void checkSilence() {
+        PitchAnalyzer analyzer;
+        analyzer.configure(WINDOW_SIZE, SAMPLE_RATE, HOP_FRAMES);
+        std::vector<sf::Int16> silence(WINDOW_SIZE, 0);
+        analyzer.analyze(silence.data());
+        const PitchAnalyzer::Features& features = analyzer.getFeatures();
+        test::check(features.frequency == 0.0f && features.periodicity == 0.0f, "silence has no pitch");
+        test::check(features.chord == -1 && features.key == -1, "silence has no chord or key");
+        test::check(std::all_of(features.chroma.begin(), features.chroma.end(), [](float value) { return value == 0.0f; }), "silence has no chroma");
+    }
+}
+
+int main()
+{
+    checkFrequencies();
+    checkChords();
+
+    const int cMajor[4][3] = { { 60, 64, 67 }, { 65, 69, 72 }, { 67, 71, 74 }, { 60, 64, 67 } };
+    const int aMinor[4][3] = { { 57, 60, 64 }, { 62, 65, 69 }, { 64, 68, 71 }, { 57, 60, 64 } };
+    checkKey("C", cMajor);
+    checkKey("Am", aMinor);
+
+    checkSilence();
+    return test::finish("PitchAnalyzerTest");
+}
@@ -0,0 +1,81 @@
+//! \file TripleBufferTest.cpp
+//! \brief Stress test of the TripleBuffer hand-off between the FFT thread and a view.
+//!
+//! One thread publishes sequence-stamped SpectrumFrames as fast as it can while another
+//! reads them. Every value of a frame is its sequence number, so a frame mixed from two
+//! publishes shows up as torn; sequence numbers must only ever grow, and the last frame
+//! published must always reach the reader.
+//!
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "AnalysisBus.h"
+#include "Check.h"
+#include "TripleBuffer.h"
+
+namespace {
+
+    typedef AnalysisBus::SpectrumFrame Frame;
+
+    const int BARS = 512;                   ///< Values written and checked per frame.
+    const sf::Uint64 FRAMES = 200000;       ///< Frames published per round.
+    const int ROUNDS = 5;                   ///< Rounds, each with a fresh buffer.
+
+    void runRound(int round) {
+        // Frames are large; keep the buffer off the stack.
+        std::unique_ptr<TripleBuffer<Frame>> buffer(new TripleBuffer<Frame>());
+        std::atomic<bool> done{ false };
+
+        std::thread producer([&]() {
+            for (sf::Uint64 sequence = 1; sequence <= FRAMES; sequence++) {
+                Frame& frame = buffer->writeBuffer();
+                frame.sequence = sequence;
+                for (int i = 0; i < BARS; i++) {
+                    frame.magnitudes[i] = static_cast<float>(sequence);
+                }
+                buffer->publish();
+            }
+            done = true;
+        });
+
+        sf::Uint64 last = 0, received = 0, torn = 0, reordered = 0;
+        while (true) {
+            bool finished = done;
+            while (buffer->update()) {
+                const Frame& frame = buffer->readBuffer();
+                received++;
+                if (frame.sequence <= last) {
+                    reordered++;
+                }
+                last = frame.sequence;
+                for (int i = 0; i < BARS; i++) {
+                    if (frame.magnitudes[i] != static_cast<float>(frame.sequence)) {
+                        torn++;
+                        break;
+                    }
+                }
+            }
+            // Everything published before done was set is visible after the last update().
+            if (finished) {
+                break;
+            }
+        }
+        producer.join();
+
+        std::string label = "round " + std::to_string(round) + ": ";
+        test::check(torn == 0, label + std::to_string(torn) + " torn frames");
+        test::check(reordered == 0, label + std::to_string(reordered) + " frames out of order");
+        test::check(last == FRAMES, label + "last frame seen was " + std::to_string(last) + ", not " + std::to_string(FRAMES));
+        test::check(received > 0, label + "no frames received");
+    }
+}
+
+int main()
+{
+    for (int round = 0; round < ROUNDS; round++) {
+        runRound(round);
+    }
+    return test::finish("TripleBufferTest");
+}